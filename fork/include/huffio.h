@@ -7,21 +7,107 @@
 
 #include "common.h"
 
+/* HFA1 guarda el árbol serializado por entrada; HFA2 solo las longitudes canónicas; HFA3 es HFA2
+   con una sección de tablas compartidas después del header */
+#define HFA_MAGIC_V1 "HFA1"
+#define HFA_MAGIC_V2 "HFA2"
+#define HFA_MAGIC_V3 "HFA3"
+
+/* Método de codificación por entrada (HFA2) */
+#define HFA_METHOD_HUFFMAN         0   /* Un solo flujo de bits */
+#define HFA_METHOD_HUFFMAN_STREAMS 1   /* Sub-flujos intercalados con tabla de saltos */
+#define HFA_METHOD_HUFFMAN_BLOCKS  2   /* Bloques de tamaño fijo, cada uno con su propia tabla */
+#define HFA_METHOD_HUFFMAN_CONTEXT 3   /* Contexto de orden 1: la tabla se elige por el byte anterior */
+#define HFA_METHOD_HUFFMAN_WORDS   4   /* Alfabeto extendido: bytes más palabras y bigramas de un diccionario */
+#define HFA_METHOD_ANS             5   /* rANS de orden 0 con frecuencias normalizadas en lugar de Huffman */
+#define HFA_METHOD_STORED          6   /* Almacenado: el payload son los bytes originales (la codificación no achica) */
+#define HFA_METHOD_LZ77            7   /* LZ77 con literales/largos y distancias codificados con Huffman */
+#define HFA_METHOD_TRAINED         8   /* Tabla entrenada (.hft) o compartida (HFA3): la cabecera es solo su id */
+
+#define HFA_BLOCK_SIZE_DEFAULT (1u << 20)
+
+/* Bandera en el byte de método: la entrada trae tabla de puntos de sincronía */
+#define HFA_FLAG_SYNC   0x80
+#define HFA_METHOD_MASK 0x7F
+#define HFA_SYNC_INTERVAL_DEFAULT (256u << 10)
+
+/* Trozo de lectura de la compresión por flujo (memoria acotada por tarea) */
+#define HFA_STREAM_CHUNK (64u << 10)
+
+/* Memoria máxima de entradas terminadas que esperan a una anterior (escritura posicional) */
+#define HFA_PARKED_MEM_MAX (64u << 20)
+
+/* Codificador de entropía: siempre Huffman, siempre ANS o el que estime menor tamaño */
+#define HFA_CODEC_HUFFMAN 0
+#define HFA_CODEC_ANS     1
+#define HFA_CODEC_AUTO    2
+
+/* Tabla entrenada (.hft) o compartida por entradas de un HFA3: código estático referenciado por id */
+#define HFA_TABLE_MAGIC "HFT1"
+#define HFA_TABLES_MAX  128
+#define HFA_SHARED_MAX  64   /* Tablas compartidas por archivo (hfa_cluster_tables) */
+typedef struct {
+    uint32_t id;                          /* FNV-1a de las longitudes */
+    unsigned char code_len[TAM_MAX];      /* Longitudes canónicas: todos los bytes tienen código */
+    struct TablaCodigos codes;            /* Códigos para comprimir */
+    struct TablaDecodificacion *decode;   /* Tabla de decodificación, armada una vez al cargar */
+} hfa_table_t;
+
+/* Opciones de codificación de una entrada o bloque */
+typedef struct {
+    int max_bits;   /* Longitud máxima de código (0 = sin límite) */
+    int streams;    /* Sub-flujos intercalados (1 = flujo único) */
+    int contexts;   /* Contextos del modo de orden 1 (0 = sin contexto) */
+    int words;      /* Palabras del alfabeto extendido (0 = solo bytes) */
+    int codec;      /* HFA_CODEC_*: codificador de entropía de cada entrada o bloque */
+    int level;      /* Nivel de LZ77 (0 = sin LZ77, 1 rápido .. LZ_NIVEL_MAX mejor relación) */
+    int window;     /* Bits de la ventana de LZ77 (0 = LZ_VENTANA_DEFECTO) */
+    const hfa_table_t *table; /* Tabla entrenada que pueden referenciar las entradas (NULL = ninguna) */
+} hfa_opts_t;
+
+/* Bloque codificado: método (0, 1 o 3 a 8), longitudes, bits y payload en un solo buffer */
+typedef struct {
+    uint8_t     *data;
+    size_t       len;
+    uint64_t     bit_count;
+} hfa_block_t;
+
 typedef struct __attribute__((packed)) {
     char     magic[4];
     uint32_t nfiles;
 } hfa_header_t;
 
+/* Directorio central al final de un HFA2/HFA3: por entrada u64 offset de la entrada, u64 offset del
+   payload y una copia de su cabecera; cierra un trailer de tamaño fijo. Los lectores que recorren las
+   entradas no lo ven porque se detienen después de nfiles */
+#define HFA_DIR_MAGIC "HFAD"
+typedef struct __attribute__((packed)) {
+    uint64_t dir_off;     /* Offset del directorio */
+    uint64_t dir_len;     /* Bytes del directorio */
+    uint32_t nfiles;      /* Entradas (igual que el header) */
+    uint32_t checksum;    /* FNV-1a del directorio */
+    char     magic[4];    /* HFA_DIR_MAGIC */
+} hfa_trailer_t;
+
 typedef struct {
     char        *name;
-    char        *txt;
     size_t       txt_len;
-    struct Nodo *raiz;
-    char       **tabla;
-    char        *bitstr;
+    unsigned char code_len[TAM_MAX];
     uint64_t     bit_count;
     uint8_t     *packed;
     size_t       packed_len;
+    uint8_t      method;
+    uint32_t     block_size;     /* Modo bloques: bytes originales por bloque */
+    uint32_t     nblocks;
+    hfa_block_t *blocks;         /* Modo bloques: reemplazan a 'packed' */
+    uint32_t     sync_interval;  /* Sincronía: bytes originales entre puntos */
+    uint32_t     nsync;
+    uint64_t    *sync_bits;      /* Sincronía: bit donde empieza cada posición k*sync_interval */
+    const struct ModeloContexto *model;   /* Modo contexto: tablas de cada contexto */
+    const struct AlfabetoPalabras *alphabet;   /* Modo palabras: diccionario y códigos */
+    const struct ModeloANS *ans;               /* Modo ANS: frecuencias normalizadas */
+    const struct ModeloLZ *lz;                 /* Modo LZ77: códigos de literales/largos y distancias */
+    const hfa_table_t *table;                  /* Modo entrenado: tabla referenciada */
 } hfa_entry_t;
 
 typedef struct {
@@ -32,17 +118,118 @@ typedef struct {
     long      payload_off;
     uint8_t  *tree_blob;
     size_t    tree_len;
+    uint8_t   version;
+    uint8_t   method;
+    uint32_t  block_size;
+    uint32_t  nblocks;
+    uint64_t *block_off;      /* Modo bloques: nblocks+1 offsets relativos a payload_off */
+    uint32_t  sync_interval;
+    uint32_t  nsync;
+    uint64_t *sync_bits;      /* Sincronía: nsync offsets en bits dentro del payload */
 } hfa_meta_t;
 
-void  pack_bits_from_bitstr(const char *bitstr,
-                            uint8_t **out, size_t *out_len, uint64_t *out_bit_count);
-
-char* unpack_bits_to_bitstr(const uint8_t *buf, size_t len, uint64_t bit_count);
+/* Estimación desde el histograma (modo --analyze): sin pasada de codificación */
+typedef struct {
+    uint64_t orig_len;                /* Bytes de la entrada */
+    struct EstimacionHuffman huffman; /* Código único para toda la entrada */
+    uint64_t block_bytes;             /* Modo bloques: cabeceras, tabla y payloads (0 = no pedido) */
+} hfa_estimate_t;
 
+int   hfa_write_entry(FILE *f, const hfa_entry_t *entry);
+int   hfa_write_entry_header(FILE *f, const hfa_entry_t *entry);
+int   hfa_compress_stream(FILE *f, const char *path, const char *name, const hfa_opts_t *opts,
+                          uint32_t sync_interval, uint64_t *bit_count, uint64_t *penalty);
 int   hfa_write(const char *archive_path, hfa_entry_t *entries, uint32_t nfiles);
+int   hfa_write_directory(FILE *f, const uint64_t *entry_off, uint32_t n);   /* Con f en "w+b", después de las entradas */
+int   hfa_append_open(const char *archive_path, uint32_t extra, FILE **f, uint64_t **entry_off, uint32_t *nfiles);
+int   hfa_append_close(FILE *f, const uint64_t *entry_off, uint32_t nfiles);   /* Directorio y cantidad del header */
 int   hfa_read_and_extract(const char *archive_path, const char *dir);
 
 int   hfa_index(const char *archive_path, hfa_meta_t **out_meta, uint32_t *out_nfiles);
 void  hfa_free_index(hfa_meta_t *meta, uint32_t nfiles);
+unsigned char* hfa_decode_payload(const hfa_meta_t *meta, const uint8_t *payload);
+
+/* Búsqueda de entradas por nombre: tabla hash sobre el índice (extracción de miembros sueltos) */
+typedef struct {
+    uint32_t *slots;
+    uint32_t  mask;
+} hfa_lookup_t;
+
+int      hfa_lookup_build(const hfa_meta_t *meta, uint32_t nfiles, hfa_lookup_t *h);
+uint32_t hfa_lookup(const hfa_lookup_t *h, const hfa_meta_t *meta, const char *name);   /* UINT32_MAX si no está */
+void     hfa_lookup_free(hfa_lookup_t *h);
+
+int   hfa_train_table(char **paths, size_t n, int max_bits, const char *out_path);
+const hfa_table_t *hfa_load_table(const char *path);   /* Antes de lanzar procesos: los hijos la heredan */
+int   hfa_cluster_tables(const uint64_t (*hist)[TAM_MAX], size_t n, int k, int max_bits,
+                         hfa_table_t **out, uint32_t *ntables, uint32_t *assign);
+int   hfa_write_tables(FILE *f, const hfa_table_t *tables, uint32_t n);   /* Sección de tablas de un HFA3 */
+
+int   hfa_estimate_file(const char *path, int max_bits, uint32_t block_size, uint64_t *freq_sum,
+                        hfa_estimate_t *est);
+int   hfa_analyze(char **paths, size_t n, int max_bits, uint32_t block_size);   /* Imprime, no comprime */
+
+int   hfa_encode_block(const unsigned char *data, size_t len, const hfa_opts_t *opts,
+                       hfa_block_t *out, uint64_t *penalty);
+int   hfa_decode_block(const uint8_t *block, size_t block_len, unsigned char *out, size_t out_len);
+
+/* Segmentos: tramos de una entrada decodificables por separado (bloques o puntos de sincronía) */
+uint32_t hfa_segment_count(const hfa_meta_t *meta);
+void  hfa_segment_range(const hfa_meta_t *meta, uint32_t first, uint32_t end,
+                        uint64_t *out_off, uint64_t *out_len, uint64_t *pay_off, uint64_t *pay_len);
+int   hfa_decode_segments(const hfa_meta_t *meta, uint32_t first, uint32_t end,
+                          const uint8_t *part, unsigned char *out);
+
+/* Lector del .hfa: el archivo se proyecta una vez y los extractores leen los payloads desde la
+   proyección (con pread si mmap falló). Los hijos de un fork heredan la misma proyección */
+typedef struct {
+    int            fd;
+    const uint8_t *map;
+    uint64_t       size;
+} hfa_archive_t;
+
+int   hfa_archive_open(const char *path, hfa_archive_t *a);
+void  hfa_archive_close(hfa_archive_t *a);
+
+/* Extracción por flujo: lee el payload y escribe la salida de a HFA_STREAM_CHUNK (memoria constante) */
+int   hfa_extract_segments(const hfa_archive_t *a, const hfa_meta_t *meta, uint32_t first, uint32_t end, int out_fd);
+int   hfa_extract_entry(const hfa_archive_t *a, const hfa_meta_t *meta, const char *out_path);
+
+/* Escritura posicional: cada hijo entrega su entrada al terminarla sin esperar a los demás; las
+   regiones del .hfa se asignan en el orden de las entradas. El turno y los offsets viven en una
+   página MAP_SHARED que heredan los hijos */
+struct hfa_writer_shared;
+
+typedef struct {
+    FILE     *f;
+    bool      mem;          /* Si f escribe en buf; si no, en el último archivo parcial */
+    char     *buf;
+    size_t    len;
+    uint32_t  nparts;
+    char    **parts;
+    uint64_t *part_len;
+} hfa_slot_t;
+
+typedef struct {
+    FILE     *f;
+    int       fd;
+    struct hfa_writer_shared *shared;
+    size_t    shared_len;
+    hfa_slot_t *parked;     /* Sin 'procs': entradas listas antes que alguna anterior */
+    uint32_t  base;
+    uint32_t  extra;
+    uint64_t  start;
+    bool      append;
+    bool      procs;        /* Escriben procesos hijos: lo estacionado va a <path>.<k>.park */
+    char      path[PATH_MAX];
+    char      tmp[PATH_MAX];
+} hfa_writer_t;
+
+int   hfa_writer_open(hfa_writer_t *w, const char *path, uint32_t extra, bool append, bool procs,
+                      const hfa_table_t *tables, uint32_t ntables);
+int   hfa_writer_close(hfa_writer_t *w, bool ok);   /* Sin ok, el .hfa queda como estaba */
+FILE *hfa_slot_open(hfa_slot_t *s, const char *part, uint64_t src_len);
+int   hfa_slot_add_part(hfa_slot_t *s, const char *path, uint64_t len);
+int   hfa_slot_commit(hfa_writer_t *w, uint32_t k, hfa_slot_t *s, int rc);   /* Nunca espera a otras entradas */
 
 #endif /* FORK_HUFFIO_H */
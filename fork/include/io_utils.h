@@ -19,6 +19,9 @@ void sv_free(strvec_t *v);
 
 int  read_file_text(const char *path, char **out_buf, size_t *out_len);
 int  write_file_text(const char *path, const char *buf, size_t len);
+int  read_file_range(const char *path, uint64_t off, char *buf, size_t len);
+int  create_file_sized(const char *path, uint64_t len);
+int  write_file_range(const char *path, uint64_t off, const char *buf, size_t len);
 
 int  list_files_with_suffix(const char *dir, const char *suffix, strvec_t *out);
 
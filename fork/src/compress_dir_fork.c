@@ -7,100 +7,41 @@
 #include "../include/huffio.h"
 #include "../include/io_utils.h"
 
-/* Límite de procesos concurrentes */
-static void wait_until_slots(int *running, int max_procs){
+/* Límite de procesos concurrentes; un hijo que terminó mal marca *any_fail */
+static void wait_until_slots(int *running, int max_procs, int *any_fail){
     while (*running >= max_procs){
         int status;
-        if (waitpid(-1, &status, 0) > 0) (*running)--;
-    }
-}
-
-/* Empaqueta y escribe una entrada .hfa (sin header global) en un FILE* */
-static int write_hfa_entry(FILE *out,
-                           const char *name,
-                           const char *texto, size_t texto_len,
-                           struct Nodo *raiz,
-                           const char *bitstr)
-{
-    uint8_t *packed = NULL;
-    size_t   packed_len = 0;
-    uint64_t bit_count  = 0;
-    pack_bits_from_bitstr(bitstr, &packed, &packed_len, &bit_count);
-    (void)texto;
-    size_t name_len = strlen(name);
-    if (name_len > UINT16_MAX){ free(packed); return -1; }
-    uint16_t n16 = (uint16_t)name_len;
-    if (fwrite(&n16, sizeof(n16), 1, out) != 1){ free(packed); return -1; }
-    if (fwrite(name, 1, name_len, out) != name_len){ free(packed); return -1; }
-
-    uint64_t orig = (uint64_t)texto_len;
-    if (fwrite(&orig, sizeof(orig), 1, out) != 1){ free(packed); return -1; }
-
-    if (!serializar_arbol(raiz, out)){ free(packed); return -1; }
-
-    if (fwrite(&bit_count, sizeof(bit_count), 1, out) != 1){ free(packed); return -1; }
-    uint64_t bcount = (uint64_t)packed_len;
-    if (fwrite(&bcount, sizeof(bcount), 1, out) != 1){ free(packed); return -1; }
-    if (packed_len){
-        if (fwrite(packed, 1, packed_len, out) != packed_len){ free(packed); return -1; }
+        if (waitpid(-1, &status, 0) > 0){
+            (*running)--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) *any_fail = 1;
+        }
     }
-
-    free(packed);
-    return 0;
 }
 
-/* Trabajo del proceso hijo: comprimir un archivo y dejar la entrada en <dir>/.hfp.<pid>.part */
-static int child_compress_to_part(const char *dir, const char *fullpath)
+/* Trabajo del proceso hijo: comprimir un archivo y escribir la entrada directo en el .hfa heredado.
+   La entrada se codifica por flujo (dos pasadas por trozos) en memoria, o en <dir>/.hfp.<pid>.part
+   si el archivo es grande; después la entrega al .hfa sin esperar a las anteriores: si todavía no le
+   toca queda estacionada y la escribe el hijo que avance el turno */
+static int child_compress(hfa_writer_t *out, uint32_t index, const char *dir, const char *fullpath, int max_bits,
+                          const hfa_table_t *table)
 {
-    char *texto = NULL;
-    size_t tlen = 0;
-    if (read_file_text(fullpath, &texto, &tlen) != 0) return 2;
-
-    int freq[TAM_MAX] = {0};
-    contar_frecuencias(texto, freq);
-    struct ListaNodos L = crear_lista_nodos(freq);
-    struct Nodo *raiz = construir_arbol_huffman(L);
-
-    char *tabla[TAM_MAX] = {0};
-    char  cod[TAM_MAX];
-    generar_codigos_huffman(raiz, cod, 0, tabla);
-
-    char *bitstr = comprimir_texto(texto, tabla);
-
     char part_path[PATH_MAX];
     snprintf(part_path, sizeof(part_path), "%s/.hfp.%d.part", dir, (int)getpid());
-    FILE *pf = fopen(part_path, "wb");
-    if (!pf){
-        free(texto);
-        for (int i=0;i<TAM_MAX;i++) free(tabla[i]);
-        liberar_arbol(raiz);
-        free(bitstr);
-        return 3;
-    }
-
-    int rc = write_hfa_entry(pf, base_name(fullpath), texto, tlen, raiz, bitstr);
-    fclose(pf);
-
-    free(texto);
-    for (int i=0;i<TAM_MAX;i++) free(tabla[i]);
-    liberar_arbol(raiz);
-    free(bitstr);
-
-    return (rc==0)? 0 : 4;
-}
-
-/* Copia el contenido de un archivo en un FILE* destino */
-static int copy_file_into(FILE *dst, const char *path){
-    FILE *f = fopen(path, "rb");
-    if (!f) return -1;
-    char buf[1<<15];
-    size_t n;
-    while ((n = fread(buf,1,sizeof buf,f)) > 0){
-        if (fwrite(buf,1,n,dst) != n){ fclose(f); return -1; }
-    }
-    int rc = ferror(f) ? -1 : 0;
-    fclose(f);
-    return rc;
+    struct stat st;
+    hfa_slot_t slot;
+    FILE *pf = hfa_slot_open(&slot, part_path, stat(fullpath, &st) == 0 ? (uint64_t)st.st_size : UINT64_MAX);
+    if (!pf) return 3;
+
+    uint64_t penalty = 0;
+    hfa_opts_t opts = {.max_bits = max_bits, .streams = 1, .contexts = 0, .words = 0, .table = table};
+    int rc = hfa_compress_stream(pf, fullpath, base_name(fullpath), &opts, HFA_SYNC_INTERVAL_DEFAULT,
+                                 NULL, &penalty);
+    if (hfa_slot_commit(out, index, &slot, rc) != 0) return 4;
+
+    if (penalty)
+        printf("[INFO] %s: límite de %d bits agrega %llu bits\n",
+               base_name(fullpath), max_bits, (unsigned long long)penalty);
+    return 0;
 }
 
 /* Orden determinista por nombre base */
@@ -110,19 +51,66 @@ static int cmp_strptr(const void *a, const void *b){
     return strcmp(base_name(sa), base_name(sb));
 }
 
+/* --append: deja en 'files' solo los .txt que el .hfa no tiene o que cambiaron (otro tamaño o
+   modificados después del .hfa). Devuelve cuántos quedaron sin tocar o -1 si no se pudo indexar */
+static long select_changed(const char *arch_path, strvec_t *files){
+    struct stat ast;
+    hfa_meta_t *meta = NULL; uint32_t n = 0;
+    hfa_lookup_t lookup;
+    if (stat(arch_path, &ast) != 0 || hfa_index(arch_path, &meta, &n) != 0) return -1;
+    if (hfa_lookup_build(meta, n, &lookup) != 0){ hfa_free_index(meta, n); return -1; }
+
+    size_t kept = 0;
+    long skipped = 0;
+    for (size_t i=0;i<files->len;i++){
+        uint32_t k = hfa_lookup(&lookup, meta, base_name(files->paths[i]));
+        struct stat st;
+        if (k != UINT32_MAX && stat(files->paths[i], &st) == 0 && (uint64_t)st.st_size == meta[k].orig_len &&
+            st.st_mtime <= ast.st_mtime){
+            free(files->paths[i]);
+            skipped++;
+        } else {
+            files->paths[kept++] = files->paths[i];
+        }
+    }
+    files->len = kept;
+    hfa_lookup_free(&lookup);
+    hfa_free_index(meta, n);
+    return skipped;
+}
+
 static void usage(const char *a){
-    fprintf(stderr, "Uso: %s <dir> [nprocs] [archivo_salida.hfa]\n", a);
+    fprintf(stderr, "Uso: %s <dir> [nprocs] [archivo_salida.hfa] [--max-bits N] [--table T.hft] [--train T.hft] [--append] [--analyze]\n", a);
 }
 
 int main(int argc, char **argv){
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0);
 
-    if (argc < 2){ usage(argv[0]); return 1; }
-    const char *dir      = argv[1];
-    int         maxproc  = (argc >= 3)? atoi(argv[2]) : num_cpus();
+    /* Opciones y argumentos posicionales */
+    const char *pos[3] = {0};
+    int npos = 0, max_bits = HUF_LIMITE_DEFECTO, analyze = 0, append = 0;
+    const char *table_path = NULL, *train_path = NULL;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--max-bits") == 0 && i + 1 < argc) max_bits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc) table_path = argv[++i];
+        else if (strcmp(argv[i], "--train") == 0 && i + 1 < argc) train_path = argv[++i];
+        else if (strcmp(argv[i], "--analyze") == 0) analyze = 1;
+        else if (strcmp(argv[i], "--append") == 0) append = 1;
+        else if (argv[i][0] == '-' || npos == 3){ usage(argv[0]); return 1; }
+        else pos[npos++] = argv[i];
+    }
+    if (npos < 1){ usage(argv[0]); return 1; }
+    if (max_bits != 0 && (max_bits < 8 || max_bits > 30))
+        DIE("--max-bits debe ser 0 (sin límite) o estar entre 8 y 30");
+    /* La tabla se carga una vez en el padre; los hijos la heredan con el fork */
+    const hfa_table_t *table = NULL;
+    if (table_path && !(table = hfa_load_table(table_path))) DIE("No se pudo cargar la tabla %s", table_path);
+
+    const char *dir      = pos[0];
+    int         maxproc  = (npos >= 2)? atoi(pos[1]) : num_cpus();
     if (maxproc <= 0) maxproc = 2;
-    const char *outname  = (argc >= 4)? argv[3] : "archive.hfa";
+    const char *outname  = (npos >= 3)? pos[2] : "archive.hfa";
 
     strvec_t files; sv_init(&files);
     if (list_files_with_suffix(dir, ".txt", &files)!=0){ DIE("No se pudo abrir %s", dir); }
@@ -130,20 +118,52 @@ int main(int argc, char **argv){
 
     qsort(files.paths, files.len, sizeof(char*), cmp_strptr);
 
-    pid_t *pids = calloc(files.len, sizeof(pid_t));
+    /* --analyze: estimaciones desde el histograma, sin lanzar hijos ni escribir el .hfa */
+    if (analyze){
+        int rc = hfa_analyze(files.paths, files.len, max_bits, 0);
+        if (rc != 0) WARN("No se pudo analizar %s", dir);
+        sv_free(&files);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("Tiempo de análisis: %ld ms\n", elapsed_ms(t0,t1));
+        return rc != 0;
+    }
+    if (train_path){
+        int rc = hfa_train_table(files.paths, files.len, max_bits, train_path);
+        if (rc != 0) WARN("No se pudo entrenar %s", train_path);
+        sv_free(&files);
+        return rc != 0;
+    }
+
+    /* --append sobre un .hfa existente: solo se comprimen los .txt nuevos o cambiados */
+    char out_path[PATH_MAX]; join_path(dir, outname, out_path);
+    if (append && access(out_path, F_OK) != 0) append = 0;
+    if (append){
+        long skipped = select_changed(out_path, &files);
+        if (skipped < 0){ sv_free(&files); DIE("No se pudo indexar %s para agregar", out_path); }
+        printf("[INFO] %ld archivos sin cambios en %s\n", skipped, out_path);
+        if (!files.len){ sv_free(&files); return 0; }
+    }
+
+    /* El .hfa se abre antes del fork: los hijos heredan el descriptor y la página del turno */
+    hfa_writer_t out;
+    if (hfa_writer_open(&out, out_path, (uint32_t)files.len, append, true, NULL, 0) != 0){
+        sv_free(&files); DIE("No se pudo abrir %s", out_path);
+    }
+    fflush(stdout);   /* Si no, cada hijo repite lo que quedó en el buffer */
+
     int running = 0, any_fail = 0;
 
     for (size_t i=0;i<files.len;i++){
-        wait_until_slots(&running, maxproc);
+        wait_until_slots(&running, maxproc, &any_fail);
 
         pid_t pid = fork();
         if (pid < 0){ any_fail = 1; break; }
 
         if (pid == 0){
-            int rc = child_compress_to_part(dir, files.paths[i]);
+            int rc = child_compress(&out, (uint32_t)i, dir, files.paths[i], max_bits, table);
+            fflush(stdout);
             _exit(rc);
         } else {
-            pids[i] = pid;
             running++;
         }
     }
@@ -155,32 +175,22 @@ int main(int argc, char **argv){
             if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) any_fail = 1;
         }
     }
-    if (any_fail){ sv_free(&files); free(pids); return 1; }
-
-    char out_path[PATH_MAX]; join_path(dir, outname, out_path);
-    FILE *out = fopen(out_path, "wb");
-    if (!out){ sv_free(&files); free(pids); DIE("No se pudo crear %s", out_path); }
-
-    hfa_header_t hdr; memcpy(hdr.magic,"HFA1",4); hdr.nfiles = (uint32_t)files.len;
-    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1){ fclose(out); sv_free(&files); free(pids); DIE("No se pudo escribir header"); }
-
-    for (size_t i=0;i<files.len;i++){
-        char part[PATH_MAX];
-        snprintf(part, sizeof(part), "%s/.hfp.%d.part", dir, (int)pids[i]);
-        if (copy_file_into(out, part)!=0){
-            fclose(out); sv_free(&files); free(pids); DIE("No se pudo copiar %s", part);
-        }
-        /*remove(part);*/ 
+    /* Directorio central al final: el índice se carga con una lectura. Si un hijo falló, el .hfa
+       queda como estaba */
+    uint32_t base = out.base, total = base + (uint32_t)files.len;
+    if (hfa_writer_close(&out, !any_fail) != 0){
+        sv_free(&files);
+        if (any_fail) return 1;
+        DIE("No se pudo escribir el directorio de %s", out_path);
     }
-    fclose(out);
 
     /*for (size_t i=0;i<files.len;i++) remove(files.paths[i]);*/
 
     sv_free(&files);
-    free(pids);
 
     clock_gettime(CLOCK_MONOTONIC, &t1);
-    printf("[OK] Escribí %s con %u archivos\n", out_path, hdr.nfiles);
+    if (append) printf("[OK] Agregué %u archivos a %s (total: %u)\n", total - base, out_path, total);
+    else        printf("[OK] Escribí %s con %u archivos\n", out_path, total);
     printf("Tiempo de compresión: %ld ms\n", elapsed_ms(t0,t1));
     return 0;
 }
@@ -6,108 +6,207 @@
 #include "../include/common.h"
 #include "../include/huffio.h"
 #include "../include/io_utils.h"
+#include <fcntl.h>
 
 static void usage(const char *a){
-    fprintf(stderr, "Uso: %s <dir> [archivo.hfa] [nprocs]\n", a);
+    fprintf(stderr, "Uso: %s <dir> [archivo.hfa] [nprocs] [--table T.hft]\n"
+                    "     %s extract <archivo.hfa> <nombre...> [--out DIR] [--table T.hft]\n", a, a);
 }
 
-/* Trabajo del proceso hijo: extraer una entrada por índice */
-static int child_extract_one(const char *archive_path, const char *dir, uint32_t index){
-    hfa_meta_t *meta = NULL; uint32_t n = 0;
-    if (hfa_index(archive_path, &meta, &n)!=0) return 2;
-    if (index >= n){ hfa_free_index(meta,n); return 3; }
-
-    const hfa_meta_t *m = &meta[index];
-
-    FILE *ftree = fmemopen((void*)m->tree_blob, m->tree_len, "rb");
-    if (!ftree){ hfa_free_index(meta,n); return 4; }
-    struct Nodo *raiz = deserializar_arbol(ftree);
-    fclose(ftree);
-    if (!raiz){ hfa_free_index(meta,n); return 5; }
-
-    FILE *f = fopen(archive_path, "rb");
-    if (!f){ liberar_arbol(raiz); hfa_free_index(meta,n); return 6; }
-    if (fseek(f, m->payload_off, SEEK_SET)!=0){ fclose(f); liberar_arbol(raiz); hfa_free_index(meta,n); return 7; }
-
-    uint8_t *payload = NULL;
-    if (m->byte_count){
-        payload = (uint8_t*)malloc((size_t)m->byte_count);
-        if (!payload){ fclose(f); liberar_arbol(raiz); hfa_free_index(meta,n); return 8; }
-        if (fread(payload,1,(size_t)m->byte_count,f)!=(size_t)m->byte_count){
-            free(payload); fclose(f); liberar_arbol(raiz); hfa_free_index(meta,n); return 9;
-        }
-    }
-    fclose(f);
-
-    char *bitstr = unpack_bits_to_bitstr(payload, (size_t)m->byte_count, m->bit_count);
-    char *texto  = descomprimir_texto(raiz, bitstr, (long)m->orig_len);
-
-    if (!texto){
-        free(bitstr); free(payload); liberar_arbol(raiz); hfa_free_index(meta,n); return 10;
-    }
+/* Trabajo del proceso hijo: extraer una entrada con el índice y la proyección que heredó del padre,
+   escribiendo la salida por trozos (memoria constante) */
+static int child_extract_one(const hfa_archive_t *archive, const char *dir, const hfa_meta_t *m){
+    char out_path[PATH_MAX];
+    join_path(dir, m->name, out_path);
+    int rc = hfa_extract_entry(archive, m, out_path);
+    return (rc==0)? 0 : 10;
+}
 
+/* Trabajo del proceso hijo: decodificar los segmentos [first, end) de una entrada y escribirlos
+   con pwrite en su región del archivo de salida, que el padre ya creó con el tamaño final */
+static int child_extract_slice(const hfa_archive_t *archive, const char *dir, const hfa_meta_t *m,
+                               uint32_t first, uint32_t end){
     char out_path[PATH_MAX];
     join_path(dir, m->name, out_path);
-    int wrc = write_file_text(out_path, texto, (size_t)m->orig_len);
+    int out_fd = open(out_path, O_WRONLY);
+    if (out_fd < 0) return 11;
 
-    free(texto);
-    free(bitstr);
-    free(payload);
-    liberar_arbol(raiz);
-    hfa_free_index(meta, n);
+    int rc = hfa_extract_segments(archive, m, first, end, out_fd);
+    if (close(out_fd)!=0) rc = -1;
+    return (rc==0)? 0 : 10;
+}
+
+/* Hijos en curso: pid y posición en la selección de la entrada que restaura cada uno */
+typedef struct {
+    pid_t    *pid;       /* 0 = lugar libre */
+    uint32_t *entry;
+    int       max, running;
+} children_t;
+
+/* Espera un hijo; si terminó mal marca su entrada en failed */
+static void reap_child(children_t *c, bool *failed){
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid <= 0) return;
+    for (int s=0;s<c->max;s++){
+        if (c->pid[s] != pid) continue;
+        if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) failed[c->entry[s]] = true;
+        c->pid[s] = 0;
+        c->running--;
+        break;
+    }
+}
+
+/* Espera hijos hasta que haya un lugar libre y lo devuelve */
+static int wait_until_slots(children_t *c, bool *failed){
+    while (c->running >= c->max) reap_child(c, failed);
+    int s = 0;
+    while (c->pid[s]) s++;
+    return s;
+}
 
-    return (wrc==0)? 0 : 11;
+/* Lanza un hijo para la entrada k en el lugar s; devuelve el pid como fork() */
+static pid_t spawn_child(children_t *c, int s, uint32_t k){
+    pid_t pid = fork();
+    if (pid > 0){
+        c->pid[s] = pid;
+        c->entry[s] = k;
+        c->running++;
+    }
+    return pid;
 }
 
 int main(int argc, char **argv){
     struct timespec t0, t1; clock_gettime(CLOCK_MONOTONIC, &t0);
-    if (argc < 2){ usage(argv[0]); return 1; }
 
-    const char *dir = argv[1];
-
-    char archive_path[PATH_MAX];
-    if (argc >= 3) strncpy(archive_path, argv[2], PATH_MAX-1);
-    else           join_path(dir, "archive.hfa", archive_path);
+    /* Opciones y argumentos posicionales; las tablas entrenadas se cargan en el padre y los hijos
+       las heredan ya armadas. Con "extract" se restauran solo las entradas nombradas y el .hfa queda */
+    int extract = (argc >= 2 && strcmp(argv[1], "extract") == 0);
+    const char *pos[3] = {0};
+    const char **names = calloc((size_t)argc, sizeof(char*));
+    const char *out_dir = NULL;
+    int npos = 0, nnames = 0;
+    for (int i = extract ? 2 : 1; i < argc; i++){
+        if (strcmp(argv[i], "--table") == 0 && i + 1 < argc){
+            if (!hfa_load_table(argv[++i])){ WARN("No se pudo cargar la tabla %s", argv[i]); free(names); return 1; }
+        }
+        else if (extract && strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_dir = argv[++i];
+        else if (argv[i][0] == '-' || (!extract && npos == 3)){ usage(argv[0]); free(names); return 1; }
+        else if (extract && npos == 1) names[nnames++] = argv[i];
+        else pos[npos++] = argv[i];
+    }
+    if (npos < 1 || (extract && nnames == 0)){ usage(argv[0]); free(names); return 1; }
+
+    char archive_path[PATH_MAX], dir_buf[PATH_MAX];
+    const char *dir = pos[0];
+    if (extract){
+        /* Extract: pos[0] es el .hfa y, sin --out, se restaura en su directorio */
+        strncpy(archive_path, pos[0], PATH_MAX-1);
+        archive_path[PATH_MAX-1] = '\0';
+        if (!out_dir){
+            strcpy(dir_buf, archive_path);
+            char *slash = strrchr(dir_buf, '/');
+            if (slash) *(slash == dir_buf ? slash + 1 : slash) = '\0';
+            else strcpy(dir_buf, ".");
+            out_dir = dir_buf;
+        }
+        dir = out_dir;
+    }
+    else if (npos >= 2) strncpy(archive_path, pos[1], PATH_MAX-1);
+    else                join_path(dir, "archive.hfa", archive_path);
 
-    int maxproc = (argc >= 4)? atoi(argv[3]) : num_cpus();
+    int maxproc = (!extract && npos >= 3)? atoi(pos[2]) : num_cpus();
     if (maxproc <= 0) maxproc = 2;
 
     hfa_meta_t *meta = NULL; uint32_t n = 0;
-    if (hfa_index(archive_path, &meta, &n)!=0){ WARN("No se pudo indexar %s", archive_path); return 1; }
-    hfa_free_index(meta, n);
-    if (n == 0){ WARN("Archivo vacío: %s", archive_path); return 0; }
-
-    int running = 0, any_fail = 0;
-    for (uint32_t i=0;i<n;i++){
-        while (running >= maxproc){
-            int status;
-            if (waitpid(-1, &status, 0) > 0){
-                running--;
-                if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) any_fail = 1;
+    if (hfa_index(archive_path, &meta, &n)!=0){ WARN("No se pudo indexar %s", archive_path); free(names); return 1; }
+    if (n == 0 && !extract){ WARN("Archivo vacío: %s", archive_path); hfa_free_index(meta, n); free(names); return 0; }
+
+    /* Extract: los nombres se resuelven con la tabla hash del índice, sin recorrer las entradas */
+    uint32_t *sel = NULL, nsel = n;
+    int any_fail = 0;
+    if (extract){
+        hfa_lookup_t lookup;
+        sel = malloc((size_t)nnames * sizeof(uint32_t));
+        if (!sel || hfa_lookup_build(meta, n, &lookup)!=0){ WARN("Sin memoria"); free(sel); hfa_free_index(meta, n); free(names); return 1; }
+        nsel = 0;
+        for (int k=0;k<nnames;k++){
+            uint32_t i = hfa_lookup(&lookup, meta, names[k]);
+            if (i == UINT32_MAX){ WARN("%s no está en %s", names[k], archive_path); any_fail = 1; }
+            else sel[nsel++] = i;
+        }
+        hfa_lookup_free(&lookup);
+    }
+    free(names);
+
+    /* El .hfa se proyecta una vez en el padre: los hijos comparten las páginas y el índice */
+    hfa_archive_t archive;
+    if (hfa_archive_open(archive_path, &archive)!=0){ WARN("No se pudo abrir %s", archive_path); free(sel); hfa_free_index(meta, n); return 1; }
+
+    /* Una marca por entrada seleccionada: algún hijo que la restauraba falló */
+    bool *failed = calloc(nsel ? nsel : 1, sizeof(bool));
+    children_t kids = {calloc((size_t)maxproc, sizeof(pid_t)), calloc((size_t)maxproc, sizeof(uint32_t)), maxproc, 0};
+    if (!failed || !kids.pid || !kids.entry){
+        WARN("Sin memoria");
+        free(failed); free(kids.pid); free(kids.entry);
+        hfa_archive_close(&archive); free(sel); hfa_free_index(meta, n);
+        return 1;
+    }
+
+    uint32_t launched = 0;
+    int fork_fail = 0;
+    for (uint32_t k=0;k<nsel && !fork_fail;k++, launched++){
+        uint32_t i = sel ? sel[k] : k;
+        /* Entradas con bloques o puntos de sincronía: un hijo por tramo sobre el mismo archivo */
+        uint32_t nseg = hfa_segment_count(&meta[i]);
+        uint32_t parts = (nseg < (uint32_t)maxproc) ? nseg : (uint32_t)maxproc;
+        char out_path[PATH_MAX];
+        join_path(dir, meta[i].name, out_path);
+        if (parts > 1 && meta[i].method != HFA_METHOD_HUFFMAN_STREAMS){
+            if (create_file_sized(out_path, meta[i].orig_len)!=0){ failed[k] = true; continue; }
+            for (uint32_t p=0;p<parts;p++){
+                int slot = wait_until_slots(&kids, failed);
+                uint32_t first = (uint32_t)((uint64_t)nseg * p / parts);
+                uint32_t end   = (uint32_t)((uint64_t)nseg * (p + 1) / parts);
+                pid_t pid = spawn_child(&kids, slot, k);
+                if (pid < 0){ failed[k] = true; fork_fail = 1; break; }
+                if (pid == 0){
+                    /* El hijo hereda el índice del padre: no hace falta reindexar */
+                    int rc = child_extract_slice(&archive, dir, &meta[i], first, end);
+                    _exit(rc);
+                }
             }
+            continue;
         }
-        pid_t pid = fork();
-        if (pid < 0){ any_fail=1; break; }
+
+        int slot = wait_until_slots(&kids, failed);
+        pid_t pid = spawn_child(&kids, slot, k);
+        if (pid < 0){ fork_fail = 1; break; }
         if (pid == 0){
-            int rc = child_extract_one(archive_path, dir, i);
+            int rc = child_extract_one(&archive, dir, &meta[i]);
             _exit(rc);
-        } else {
-            running++;
         }
     }
 
-    while (running > 0){
-        int status;
-        if (waitpid(-1, &status, 0) > 0){
-            running--;
-            if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) any_fail = 1;
-        }
-    }
+    while (kids.running > 0) reap_child(&kids, failed);
+
+    /* Restauradas: las que se lanzaron y ningún hijo suyo falló */
+    uint32_t restored = 0;
+    for (uint32_t k=0;k<launched;k++) if (!failed[k]) restored++;
+    if (restored < nsel) any_fail = 1;
+    free(failed); free(kids.pid); free(kids.entry);
+
+    hfa_archive_close(&archive);
+    free(sel);
+    hfa_free_index(meta, n);
 
     /* if (!any_fail) remove(archive_path);*/
 
     clock_gettime(CLOCK_MONOTONIC, &t1);
-    printf("[OK] Restauración %s (archivos: %u)%s\n", dir, n, any_fail? " con advertencias": "");
+    if (extract)
+        printf("[%s] Extracción de %u de %u archivos de %s en %s\n", any_fail? "WARN": "OK", restored, n, archive_path, dir);
+    else
+        printf("[%s] Restauración %s (archivos: %u de %u)\n", any_fail? "WARN": "OK", dir, restored, n);
     printf("Tiempo de descompresión: %ld ms\n", elapsed_ms(t0,t1));
     return any_fail ? 1 : 0;
 }
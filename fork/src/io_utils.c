@@ -7,6 +7,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
 
 /* Inicializa el vector dinámico de rutas. */
 void sv_init(strvec_t *v) { memset(v, 0, sizeof(*v)); }
@@ -79,6 +80,57 @@ int write_file_text(const char *path, const char *buf, size_t len)
     return wr == len ? 0 : -1;
 }
 
+/* Lee exactamente 'len' bytes desde el offset 'off' con pread. */
+int read_file_range(const char *path, uint64_t off, char *buf, size_t len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t rd = pread(fd, buf + done, len - done, (off_t)(off + done));
+        if (rd < 0 && errno == EINTR)
+            continue;
+        if (rd <= 0)
+            break;
+        done += (size_t)rd;
+    }
+    close(fd);
+    return done == len ? 0 : -1;
+}
+
+/* Crea (o trunca) el archivo destino con 'len' bytes antes de que los hijos escriban sus rangos. */
+int create_file_sized(const char *path, uint64_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int rc = ftruncate(fd, (off_t)len);
+    if (close(fd) != 0)
+        rc = -1;
+    return rc == 0 ? 0 : -1;
+}
+
+/* Escribe exactamente 'len' bytes en el offset 'off' con pwrite, sin tocar el resto del archivo. */
+int write_file_range(const char *path, uint64_t off, const char *buf, size_t len)
+{
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return -1;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t wr = pwrite(fd, buf + done, len - done, (off_t)(off + done));
+        if (wr < 0 && errno == EINTR)
+            continue;
+        if (wr <= 0)
+            break;
+        done += (size_t)wr;
+    }
+    if (close(fd) != 0)
+        return -1;
+    return done == len ? 0 : -1;
+}
+
 /* Lista archivos regulares con el sufijo dado; ignora subdirectorios. */
 int list_files_with_suffix(const char *dir, const char *suffix, strvec_t *out)
 {
@@ -0,0 +1,40 @@
+#ifndef ANS_H
+#define ANS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+
+// Codificador rANS de orden 0, alternativa a Huffman: las frecuencias se normalizan a ANS_TOTAL,
+// así un símbolo cuesta log2(ANS_TOTAL / frecuencia) bits en lugar de un número entero de bits
+#define ANS_BITS_ESCALA 12
+#define ANS_TOTAL       (1u << ANS_BITS_ESCALA)
+
+// Estados intercalados (el símbolo i usa el estado i % ANS_ESTADOS) y cota inferior de cada estado;
+// la renormalización mueve 16 bits de una vez, a lo sumo una por símbolo
+#define ANS_ESTADOS    4
+#define ANS_ESTADO_MIN (1u << 16)
+
+// Cabecera: mapa de bits de los símbolos presentes y la frecuencia de cada uno en u16
+#define HUF_CABECERA_ANS_MAX (TAM_MAX / 8 + 2 * TAM_MAX)
+
+struct ModeloANS {
+    uint16_t frecuencia[TAM_MAX];   // 0 = símbolo ausente; la suma es ANS_TOTAL
+    uint16_t acumulada[TAM_MAX];
+};
+
+// Tabla de decodificación: entrada = símbolo | (frecuencia - 1) << 8 | (ranura - acumulada) << 20
+struct TablaANS {
+    uint32_t entrada[ANS_TOTAL];
+};
+
+int normalizar_modelo_ans(const uint64_t* frecuencias, struct ModeloANS* modelo);
+uint64_t estimar_bits_ans(const uint64_t* frecuencias, const struct ModeloANS* modelo);
+uint8_t* codificar_ans(const unsigned char* datos, size_t n, const struct ModeloANS* modelo, size_t* out_len);
+size_t escribir_modelo_ans(const struct ModeloANS* modelo, uint8_t* buffer);
+int leer_modelo_ans(const uint8_t* buffer, size_t n, struct ModeloANS* modelo);
+void construir_tabla_ans(const struct ModeloANS* modelo, struct TablaANS* tabla);
+int descomprimir_ans_en(const struct ModeloANS* modelo, const uint8_t* datos, size_t n_bytes,
+                        unsigned char* salida, size_t n_salida);
+
+#endif
@@ -3,14 +3,18 @@
 
 #include "huffman.h"
 
-void encontrar_dos_minimos(struct ListaNodos lista, int* min1, int* min2);
+void arena_reiniciar(struct ArenaNodos* arena);
+int arena_nuevo_nodo(struct ArenaNodos* arena, unsigned char caracter, uint64_t frecuencia);
+int arena_construir_arbol(struct ArenaNodos* arena, const uint64_t* frecuencias);
 struct Nodo* construir_arbol_huffman(struct ListaNodos lista_inicial);
+int limitar_longitudes(const uint64_t* frecuencias, unsigned char* longitudes, int limite);
+int limitar_longitudes_n(const uint64_t* frecuencias, int n_simbolos, unsigned char* longitudes, int limite);
 void imprimir_arbol(struct Nodo* raiz, int nivel);
 void liberar_arbol(struct Nodo* nodo);
 void generar_codigos_huffman(struct Nodo* raiz, char* codigo, int profundidad, char** tabla);
 char* comprimir_texto(const char* texto, char** tabla);
 char* descomprimir_texto(struct Nodo* raiz, const char* texto_comprimido, long tamaño_esperado);
-int serializar_arbol(struct Nodo* raiz, FILE* archivo);
-struct Nodo* deserializar_arbol(FILE* archivo);
+int serializar_arbol(const struct ArenaNodos* arena, int raiz, FILE* archivo);
+int deserializar_arbol(struct ArenaNodos* arena, FILE* archivo);
 
 #endif
\ No newline at end of file
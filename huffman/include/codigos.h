@@ -0,0 +1,103 @@
+#ifndef CODIGOS_H
+#define CODIGOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+
+// Longitud máxima de código que admite el acumulador de 64 bits
+#define HUF_BITS_MAX 56
+
+// Límite de longitud por defecto de los compresores: coincide con HUF_BITS_TABLA_MAX,
+// así toda entrada se decodifica con una sola búsqueda en tabla por símbolo
+#define HUF_LIMITE_DEFECTO 15
+
+// Tamaño máximo de la cabecera de longitudes: longitud máxima + mapa de bits + una longitud por símbolo
+#define HUF_CABECERA_MAX (1 + TAM_MAX / 8 + TAM_MAX)
+
+// Sub-flujos intercalados: máximo admitido, valor por defecto y tamaño de la tabla de saltos
+// (un byte con la cantidad de flujos y los bits de cada uno en u64)
+#define HUF_FLUJOS_MAX 16
+#define HUF_FLUJOS_DEFECTO 4
+#define HUF_TABLA_SALTOS(n_flujos) (1 + 8 * (size_t)(n_flujos))
+
+// Buffer de salida del codificador incremental: la memoria no depende del tamaño de la entrada
+#define HUF_BUFFER_FLUJO (64 * 1024)
+
+// Tabla de códigos empaquetados: bits alineados a la derecha y su longitud
+struct TablaCodigos {
+    uint64_t codigo[TAM_MAX];
+    unsigned char longitud[TAM_MAX];   // 0 = símbolo sin código
+};
+
+// Modo de contexto de orden 1: la tabla de códigos se elige por el byte anterior. Los 256 bytes
+// previos se agrupan en a lo sumo HUF_CONTEXTOS_MAX contextos, cada uno con su código canónico
+#define HUF_CONTEXTOS_MAX 16
+#define HUF_CABECERA_CONTEXTO_MAX (1 + TAM_MAX / 2 + HUF_CONTEXTOS_MAX * HUF_CABECERA_MAX)
+
+struct ModeloContexto {
+    int n_contextos;
+    unsigned char mapa[TAM_MAX];                          // contexto de cada byte anterior
+    unsigned char longitudes[HUF_CONTEXTOS_MAX][TAM_MAX];
+    struct TablaCodigos tablas[HUF_CONTEXTOS_MAX];
+};
+
+// Tamaño de una entrada calculado solo desde el histograma, sin pasada de codificación
+struct EstimacionHuffman {
+    uint64_t simbolos;         // bytes de entrada (suma del histograma)
+    int distintos;             // símbolos con frecuencia > 0
+    uint64_t bits_entropia;    // cota de Shannon del payload
+    uint64_t bits_huffman;     // payload exacto: suma de frecuencia × longitud de código
+    uint64_t penalizacion;     // bits que agrega el límite de longitud
+    size_t bytes_cabecera;     // cabecera de longitudes del código canónico
+};
+
+// Destino de los bytes del codificador incremental: devuelve 0 si pudo escribir los n bytes
+typedef int (*funcion_escribir)(void* contexto, const uint8_t* datos, size_t n);
+
+// Codificador incremental de flujo único (iniciar / actualizar / terminar)
+struct CodificadorFlujo {
+    const struct TablaCodigos* tabla;
+    funcion_escribir escribir;
+    void* contexto;
+    uint64_t acumulador;
+    int pendientes;          // bits válidos en el acumulador
+    uint64_t entregados;     // bytes ya entregados a 'escribir'
+    uint64_t posicion;       // símbolos codificados
+    uint64_t bits;           // total de bits, válido después de codificador_terminar
+    uint64_t intervalo;      // puntos de sincronía cada 'intervalo' símbolos
+    uint64_t* puntos;
+    uint32_t n_puntos, max_puntos;
+    const struct ModeloContexto* modelo;   // modo de contexto (NULL = una sola tabla)
+    unsigned char previo;                  // último byte codificado en modo de contexto
+    int error;
+    size_t usados;           // bytes ocupados del buffer
+    uint8_t buffer[HUF_BUFFER_FLUJO];
+};
+
+int generar_tabla_codigos(const struct ArenaNodos* arena, int raiz, struct TablaCodigos* tabla);
+int asignar_codigos_canonicos(const unsigned char* longitudes, struct TablaCodigos* tabla);
+int asignar_codigos_canonicos_n(const unsigned char* longitudes, int n_simbolos, uint64_t* codigos);
+int generar_codigos_canonicos(const uint64_t* frecuencias, int limite, unsigned char* longitudes,
+                              struct TablaCodigos* tabla, uint64_t* penalizacion);
+int estimar_huffman(const uint64_t* frecuencias, int limite, struct EstimacionHuffman* estimacion);
+size_t escribir_longitudes(const unsigned char* longitudes, uint8_t* buffer);
+int leer_longitudes(const uint8_t* buffer, size_t n, unsigned char* longitudes);
+uint64_t contar_bits_codificados(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla);
+uint64_t* calcular_puntos_sincronia(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                                    size_t intervalo, uint32_t* n_puntos);
+uint8_t* codificar_bits(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                        size_t* out_len, uint64_t* out_bits);
+uint64_t contar_bits_contexto(const uint64_t* frecuencias1, const struct ModeloContexto* modelo);
+uint8_t* codificar_contexto(const unsigned char* datos, size_t n, const struct ModeloContexto* modelo,
+                            size_t* out_len, uint64_t* out_bits);
+uint8_t* codificar_flujos(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                          int n_flujos, size_t* out_len, uint64_t* out_bits);
+void codificador_iniciar(struct CodificadorFlujo* c, const struct TablaCodigos* tabla,
+                         funcion_escribir escribir, void* contexto);
+void codificador_contexto(struct CodificadorFlujo* c, const struct ModeloContexto* modelo);
+void codificador_sincronia(struct CodificadorFlujo* c, uint64_t intervalo, uint64_t* puntos, uint32_t max_puntos);
+int codificador_actualizar(struct CodificadorFlujo* c, const unsigned char* datos, size_t n);
+int codificador_terminar(struct CodificadorFlujo* c);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CONTEXTO_H
+#define CONTEXTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "codigos.h"
+
+// Rondas de reasignación del agrupamiento de contextos
+#define CONTEXTO_RONDAS 8
+
+// Costo en bits que se asume para un símbolo sin código en un grupo al reasignar contextos
+#define CONTEXTO_COSTO_AUSENTE 24
+
+int construir_modelo_contexto(const uint64_t* frecuencias1, int n_contextos, int limite,
+                              struct ModeloContexto* modelo, uint64_t* bits);
+size_t escribir_modelo_contexto(const struct ModeloContexto* modelo, uint8_t* buffer);
+int leer_modelo_contexto(const uint8_t* buffer, size_t n, struct ModeloContexto* modelo);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef DECODIFICADOR_H
+#define DECODIFICADOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "codigos.h"
+#include "palabras.h"
+#include "lz77.h"
+
+// Bits de la tabla de búsqueda: si todos los códigos caben en HUF_BITS_TABLA_MAX
+// se indexa con la longitud máxima (una sola búsqueda por símbolo); si no, con HUF_BITS_TABLA
+#define HUF_BITS_TABLA     11
+#define HUF_BITS_TABLA_MAX 15
+
+// Tabla de decodificación: entrada = (longitud << 8) | símbolo, 0 = código largo o inválido
+struct TablaDecodificacion {
+    uint16_t entrada[1 << HUF_BITS_TABLA_MAX];
+    int bits_tabla;
+    int longitud_max;
+
+    // Códigos más largos que bits_tabla, ordenados por (longitud, código)
+    int n_largos;
+    int inicio_longitud[HUF_BITS_MAX + 2];
+    uint64_t codigo_largo[TAM_MAX];
+    unsigned char simbolo_largo[TAM_MAX];
+};
+
+// Tablas del modo de contexto de orden 1: la tabla, su índice y su desplazamiento se eligen
+// directamente por el byte anterior
+struct TablasContexto {
+    int longitud_max;                                       // máxima entre todos los contextos
+    const struct TablaDecodificacion* tabla_de[TAM_MAX];
+    const uint16_t* entrada_de[TAM_MAX];
+    unsigned char desplazamiento_de[TAM_MAX];
+    struct TablaDecodificacion tablas[HUF_CONTEXTOS_MAX];
+};
+
+// Tabla del alfabeto extendido: entrada = (símbolo << 8) | (bytes << 4) | longitud, 0 = código
+// inválido. Todos los códigos caben en la tabla (a lo sumo HUF_BITS_TABLA_MAX bits)
+struct TablaPalabras {
+    uint32_t entrada[1 << HUF_BITS_TABLA_MAX];
+    int bits_tabla;
+    uint64_t bytes[HUF_SIMBOLOS_MAX];
+};
+
+// Tablas de LZ77: entrada = (símbolo << 4) | longitud, 0 = código inválido. Los dos alfabetos
+// tienen códigos de a lo sumo LZ_BITS_CODIGO bits, así cada símbolo sale de una sola búsqueda
+struct TablaLZ {
+    uint16_t literal[1 << LZ_BITS_CODIGO];
+    uint16_t distancia[1 << LZ_BITS_CODIGO];
+    int bits_literal;
+    int bits_distancia;
+};
+
+// Fuente del decodificador incremental: copia hasta n bytes en destino y devuelve cuántos
+// copió (0 = fin del payload)
+typedef size_t (*funcion_leer)(void* contexto, uint8_t* destino, size_t n);
+
+// Decodificador incremental de flujo único (iniciar / leer / terminar)
+struct DecodificadorFlujo {
+    const struct TablaDecodificacion* tabla;
+    funcion_leer leer;
+    void* contexto;
+    uint64_t bits;           // estado del lector de bits
+    int disponibles;
+    size_t relleno;          // bytes en cero agregados al terminar la fuente
+    size_t pos, lleno;       // bytes sin leer: buffer[pos, lleno)
+    uint64_t descartados;    // bytes de la fuente que ya salieron del buffer
+    int fin_fuente;
+    int salto;               // bits descartados al inicio (punto de sincronía)
+    const struct TablasContexto* tablas_contexto;   // modo de contexto (NULL = una sola tabla)
+    unsigned char previo;                           // último byte decodificado en modo de contexto
+    uint8_t buffer[HUF_BUFFER_FLUJO];
+};
+
+int construir_tabla_decodificacion(const struct TablaCodigos* codigos, struct TablaDecodificacion* tabla);
+int construir_tablas_contexto(const struct ModeloContexto* modelo, struct TablasContexto* tablas);
+int construir_tabla_palabras(const struct AlfabetoPalabras* alfabeto, struct TablaPalabras* tabla);
+int construir_tabla_lz(const struct ModeloLZ* modelo, struct TablaLZ* tabla);
+int decodificar_bits(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                     uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int decodificar_bits_desde(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                           uint64_t bit_inicio, uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int decodificar_flujos(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                       uint64_t n_bits, unsigned char* salida, size_t n_salida);
+unsigned char* descomprimir_empaquetado(const struct ArenaNodos* arena, int raiz, const uint8_t* datos,
+                                        size_t n_bytes, uint64_t n_bits, size_t n_salida);
+unsigned char* descomprimir_canonico(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                     uint64_t n_bits, size_t n_salida);
+unsigned char* descomprimir_canonico_flujos(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                            uint64_t n_bits, size_t n_salida);
+int descomprimir_canonico_en(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int descomprimir_canonico_flujos_en(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                    uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int descomprimir_canonico_desde(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                uint64_t bit_inicio, uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int descomprimir_contexto_en(const struct ModeloContexto* modelo, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int descomprimir_palabras_en(const struct AlfabetoPalabras* alfabeto, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int descomprimir_lz77_en(const struct ModeloLZ* modelo, const uint8_t* datos, size_t n_bytes,
+                         uint64_t n_bits, unsigned char* salida, size_t n_salida);
+int decodificador_iniciar(struct DecodificadorFlujo* d, const struct TablaDecodificacion* tabla,
+                          funcion_leer leer, void* contexto, int salto);
+void decodificador_contexto(struct DecodificadorFlujo* d, const struct TablasContexto* tablas);
+int decodificador_leer(struct DecodificadorFlujo* d, unsigned char* salida, size_t n);
+int decodificador_terminar(const struct DecodificadorFlujo* d, uint64_t n_bits);
+
+#endif
@@ -1,8 +1,20 @@
 #ifndef FRECUENCIAS_H
 #define FRECUENCIAS_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "huffman.h"
 
+// Tablas de conteo intercaladas que usa acumular_histograma
+#define HISTOGRAMA_TABLAS 4
+
+// Bits fraccionarios de los logaritmos en punto fijo (log2_fijo)
+#define LOG_FRACCION 16
+
+void acumular_histograma(const unsigned char* datos, size_t n, uint64_t* frecuencias);
+void acumular_histograma_orden1(const unsigned char* datos, size_t n, unsigned char* previo, uint64_t* frecuencias);
+uint32_t log2_fijo(uint64_t x);
+uint64_t bits_entropia(const uint64_t* frecuencias);
 void contar_frecuencias(const char* texto, int* frecuencias);
 struct Nodo* nuevo_nodo(unsigned char caracter, int frecuencia);
 int contar_caracteres_con_frecuencia(int* frecuencias);
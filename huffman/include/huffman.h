@@ -1,6 +1,8 @@
 #ifndef HUFFMAN_H
 #define HUFFMAN_H
 
+#include <stdint.h>
+
 #define TAM_MAX 256
 
 // Nodo del árbol de Huffman
@@ -16,4 +18,21 @@ struct ListaNodos {
     int cantidad;
 };
 
-#endif
\ No newline at end of file
+// Un árbol con TAM_MAX hojas tiene a lo sumo 2*TAM_MAX-1 nodos
+#define ARENA_MAX_NODOS (2 * TAM_MAX - 1)
+#define ARENA_NULO 0xFFFF
+
+// Nodo del árbol en arreglo plano: los hijos son índices de 16 bits dentro de la arena
+struct NodoPlano {
+    uint64_t frecuencia;
+    uint16_t izquierda, derecha;   // ARENA_NULO en las hojas
+    unsigned char caracter;
+};
+
+// Arena de nodos contigua: se reserva una vez por tarea o hilo y se reinicia en O(1)
+struct ArenaNodos {
+    struct NodoPlano nodos[ARENA_MAX_NODOS];
+    int cantidad;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef LZ77_H
+#define LZ77_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+
+// Etapa LZ77 previa a Huffman: la entrada se parte en literales y coincidencias (largo, distancia)
+// dentro de una ventana. Literales y códigos de largo comparten un alfabeto y las distancias usan
+// otro; ambos se codifican con códigos canónicos de a lo sumo LZ_BITS_CODIGO bits
+#define LZ_LARGO_MIN 4
+#define LZ_LARGO_MAX (LZ_LARGO_MIN + 65535)
+
+// Ventana en bits (la distancia máxima es 2^ventana - 1) y niveles de búsqueda
+#define LZ_VENTANA_MIN     10
+#define LZ_VENTANA_MAX     22
+#define LZ_VENTANA_DEFECTO 16
+#define LZ_NIVEL_MAX       9
+
+// Códigos de valor (largo - LZ_LARGO_MIN o distancia - 1): los valores menores a 8 tienen código
+// propio; después hay 4 códigos por potencia de dos, con (h - 2) bits extra para el valor exacto
+#define LZ_CODIGOS_LARGO      60
+#define LZ_CODIGOS_DISTANCIA  84
+#define LZ_SIMBOLOS_LITERAL   (TAM_MAX + LZ_CODIGOS_LARGO)
+#define LZ_BITS_CODIGO        15
+
+// Cabecera: una longitud por símbolo en nibbles, literales/largos primero y distancias después
+#define HUF_CABECERA_LZ_MAX ((LZ_SIMBOLOS_LITERAL + LZ_CODIGOS_DISTANCIA + 1) / 2)
+
+struct ModeloLZ {
+    unsigned char longitudes_literal[LZ_SIMBOLOS_LITERAL];     // 0 = símbolo sin código
+    unsigned char longitudes_distancia[LZ_CODIGOS_DISTANCIA];
+    uint64_t codigo_literal[LZ_SIMBOLOS_LITERAL];
+    uint64_t codigo_distancia[LZ_CODIGOS_DISTANCIA];
+};
+
+// Código de un valor y sus bits extra
+static inline int codigo_valor_lz(uint32_t valor, int* extra) {
+    if (valor < 8) {
+        *extra = 0;
+        return (int)valor;
+    }
+    int h = 3;
+    while ((valor >> (h + 1)) != 0) h++;
+    *extra = h - 2;
+    return 8 + (h - 3) * 4 + (int)((valor >> (h - 2)) & 3);
+}
+
+// Primer valor de un código y sus bits extra (inversa de codigo_valor_lz)
+static inline uint32_t base_valor_lz(int codigo, int* extra) {
+    if (codigo < 8) {
+        *extra = 0;
+        return (uint32_t)codigo;
+    }
+    int h = (codigo - 8) / 4 + 3;
+    *extra = h - 2;
+    return (uint32_t)(4 | ((codigo - 8) % 4)) << (h - 2);
+}
+
+uint8_t* comprimir_lz77(const unsigned char* datos, size_t n, int nivel, int ventana,
+                        struct ModeloLZ* modelo, size_t* out_len, uint64_t* out_bits);
+size_t escribir_modelo_lz(const struct ModeloLZ* modelo, uint8_t* buffer);
+int leer_modelo_lz(const uint8_t* buffer, size_t n, struct ModeloLZ* modelo);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef PALABRAS_H
+#define PALABRAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "codigos.h"
+
+// Alfabeto extendido: los TAM_MAX bytes más un diccionario propio de palabras y bigramas.
+// El símbolo TAM_MAX + i representa la palabra i del diccionario
+#define HUF_PALABRAS_MAX      3840
+#define HUF_PALABRAS_DEFECTO  1024
+#define HUF_SIMBOLOS_MAX      (TAM_MAX + HUF_PALABRAS_MAX)
+
+// Bytes por palabra: el decodificador copia HUF_PALABRA_LARGO_MAX bytes por símbolo de una vez
+#define HUF_PALABRA_LARGO_MAX 8
+
+// Cabecera: cantidad de palabras (u16), cada palabra (largo + bytes), longitud máxima de código
+// y una longitud por símbolo en nibbles (los códigos del alfabeto extendido tienen a lo sumo 15 bits)
+#define HUF_CABECERA_PALABRAS_MAX (2 + HUF_PALABRAS_MAX * (1 + HUF_PALABRA_LARGO_MAX) + 1 + (HUF_SIMBOLOS_MAX + 1) / 2)
+
+struct AlfabetoPalabras {
+    int n_palabras;
+    unsigned char largo[HUF_SIMBOLOS_MAX];        // bytes que representa cada símbolo (1 para los bytes)
+    uint64_t bytes[HUF_SIMBOLOS_MAX];             // esos bytes en orden de memoria, completados con ceros
+    unsigned char longitudes[HUF_SIMBOLOS_MAX];   // longitud del código de cada símbolo (0 = sin código)
+    uint64_t codigo[HUF_SIMBOLOS_MAX];
+};
+
+int construir_alfabeto_palabras(const unsigned char* datos, size_t n, int max_palabras, int limite,
+                                struct AlfabetoPalabras* alfabeto, uint64_t* bits);
+uint8_t* codificar_palabras(const unsigned char* datos, size_t n, const struct AlfabetoPalabras* alfabeto,
+                            size_t* out_len, uint64_t* out_bits);
+size_t escribir_alfabeto_palabras(const struct AlfabetoPalabras* alfabeto, uint8_t* buffer);
+int leer_alfabeto_palabras(const uint8_t* buffer, size_t n, struct AlfabetoPalabras* alfabeto);
+
+#endif
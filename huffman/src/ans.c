@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/ans.h"
+#include "../include/frecuencias.h"
+
+/**
+ * Normaliza el histograma a frecuencias que suman ANS_TOTAL, con al menos 1 por símbolo presente.
+ * Redondea cada frecuencia y corrige la diferencia de a una unidad en el símbolo donde cuesta
+ * menos bits (o ahorra más), así el modelo queda lo más cerca posible de la entropía.
+ */
+int normalizar_modelo_ans(const uint64_t* frecuencias, struct ModeloANS* modelo) {
+    uint64_t total = 0;
+    for (int c = 0; c < TAM_MAX; c++) total += frecuencias[c];
+    if (total == 0) return -1;
+
+    int suma = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        uint64_t q = 0;
+        if (frecuencias[c]) {
+            q = (frecuencias[c] * ANS_TOTAL + total / 2) / total;
+            if (q < 1) q = 1;
+        }
+        modelo->frecuencia[c] = (uint16_t)q;
+        suma += (int)q;
+    }
+
+    while (suma != (int)ANS_TOTAL) {
+        int mejor = -1;
+        uint64_t mejor_delta = 0;
+        for (int c = 0; c < TAM_MAX; c++) {
+            uint32_t q = modelo->frecuencia[c];
+            if (q == 0 || (suma > (int)ANS_TOTAL && q == 1)) continue;
+            uint64_t delta = (suma > (int)ANS_TOTAL)
+                                 ? frecuencias[c] * (log2_fijo(q) - log2_fijo(q - 1))
+                                 : frecuencias[c] * (log2_fijo(q + 1) - log2_fijo(q));
+            if (mejor < 0 || (suma > (int)ANS_TOTAL ? delta < mejor_delta : delta > mejor_delta)) {
+                mejor = c;
+                mejor_delta = delta;
+            }
+        }
+        if (suma > (int)ANS_TOTAL) {
+            modelo->frecuencia[mejor]--;
+            suma--;
+        } else {
+            modelo->frecuencia[mejor]++;
+            suma++;
+        }
+    }
+
+    uint32_t acumulada = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        modelo->acumulada[c] = (uint16_t)acumulada;
+        acumulada += modelo->frecuencia[c];
+    }
+    return 0;
+}
+
+// Bits que ocupa el payload ANS de un histograma: log2(ANS_TOTAL / frecuencia) por símbolo
+// más los estados finales
+uint64_t estimar_bits_ans(const uint64_t* frecuencias, const struct ModeloANS* modelo) {
+    uint64_t bits = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (frecuencias[c] == 0) continue;
+        uint32_t costo = (ANS_BITS_ESCALA << LOG_FRACCION) - log2_fijo(modelo->frecuencia[c]);
+        bits += frecuencias[c] * costo;
+    }
+    return ((bits + (1u << LOG_FRACCION) - 1) >> LOG_FRACCION) + (uint64_t)ANS_ESTADOS * 32;
+}
+
+/**
+ * Codifica 'datos' con rANS. Se recorre la entrada de atrás hacia adelante escribiendo el buffer
+ * desde el final, así el decodificador lee hacia adelante. Al terminar se vuelcan los estados
+ * (el primero queda al principio del payload) y el resultado se mueve al inicio del buffer.
+ */
+uint8_t* codificar_ans(const unsigned char* datos, size_t n, const struct ModeloANS* modelo, size_t* out_len) {
+    // Cada símbolo cuesta a lo sumo ANS_BITS_ESCALA bits
+    size_t capacidad = n / 8 * ANS_BITS_ESCALA + 2 * ANS_BITS_ESCALA + (size_t)ANS_ESTADOS * 8;
+    uint8_t* buffer = (uint8_t*)malloc(capacidad);
+    if (!buffer) {
+        printf("Error de memoria para el payload ANS\n");
+        return NULL;
+    }
+
+    // Un estado no debe llegar a limite[s] antes de codificar s, o se pasaría de 32 bits
+    uint64_t limite[TAM_MAX];
+    for (int c = 0; c < TAM_MAX; c++) {
+        limite[c] = ((uint64_t)(ANS_ESTADO_MIN >> ANS_BITS_ESCALA) << 16) * modelo->frecuencia[c];
+    }
+
+    uint32_t estado[ANS_ESTADOS];
+    for (int j = 0; j < ANS_ESTADOS; j++) estado[j] = ANS_ESTADO_MIN;
+
+    uint8_t* p = buffer + capacidad;
+    for (size_t i = n; i-- > 0;) {
+        unsigned char s = datos[i];
+        uint32_t f = modelo->frecuencia[s];
+        if (f == 0) {
+            printf("Error: símbolo %d sin frecuencia en el modelo ANS\n", s);
+            free(buffer);
+            return NULL;
+        }
+        uint32_t x = estado[i % ANS_ESTADOS];
+        if (x >= limite[s]) {
+            p -= 2;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)(x >> 8);
+            x >>= 16;
+        }
+        estado[i % ANS_ESTADOS] = ((x / f) << ANS_BITS_ESCALA) + (x % f) + modelo->acumulada[s];
+    }
+    for (int j = ANS_ESTADOS - 1; j >= 0; j--) {
+        p -= 4;
+        for (int k = 0; k < 4; k++) p[k] = (uint8_t)(estado[j] >> (8 * k));
+    }
+
+    size_t largo = (size_t)(buffer + capacidad - p);
+    memmove(buffer, p, largo);
+    uint8_t* ajustado = (uint8_t*)realloc(buffer, largo);
+    *out_len = largo;
+    return ajustado ? ajustado : buffer;
+}
+
+// Cabecera: mapa de bits de presentes y la frecuencia de cada presente en u16 little-endian
+size_t escribir_modelo_ans(const struct ModeloANS* modelo, uint8_t* buffer) {
+    memset(buffer, 0, TAM_MAX / 8);
+    size_t pos = TAM_MAX / 8;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (modelo->frecuencia[c] == 0) continue;
+        buffer[c / 8] |= (uint8_t)(1u << (c % 8));
+        buffer[pos++] = (uint8_t)modelo->frecuencia[c];
+        buffer[pos++] = (uint8_t)(modelo->frecuencia[c] >> 8);
+    }
+    return pos;
+}
+
+// Lee una cabecera escrita por escribir_modelo_ans; devuelve los bytes consumidos o -1
+int leer_modelo_ans(const uint8_t* buffer, size_t n, struct ModeloANS* modelo) {
+    if (n < TAM_MAX / 8) return -1;
+    size_t pos = TAM_MAX / 8;
+    uint32_t acumulada = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        modelo->acumulada[c] = (uint16_t)acumulada;
+        modelo->frecuencia[c] = 0;
+        if (!(buffer[c / 8] & (1u << (c % 8)))) continue;
+        if (n - pos < 2) return -1;
+        uint32_t f = (uint32_t)buffer[pos] | ((uint32_t)buffer[pos + 1] << 8);
+        pos += 2;
+        if (f == 0 || f > ANS_TOTAL - acumulada) return -1;
+        modelo->frecuencia[c] = (uint16_t)f;
+        acumulada += f;
+    }
+    return (acumulada == ANS_TOTAL) ? (int)pos : -1;
+}
+
+// Una entrada por ranura: el símbolo, su frecuencia y la distancia al inicio de su intervalo
+void construir_tabla_ans(const struct ModeloANS* modelo, struct TablaANS* tabla) {
+    for (int c = 0; c < TAM_MAX; c++) {
+        uint32_t f = modelo->frecuencia[c];
+        for (uint32_t k = 0; k < f; k++) {
+            tabla->entrada[modelo->acumulada[c] + k] = (uint32_t)c | ((f - 1) << 8) | (k << 20);
+        }
+    }
+}
+
+// Un paso de decodificación del estado x: símbolo de la ranura y nuevo estado antes de renormalizar
+static inline uint32_t paso_ans(const struct TablaANS* tabla, uint32_t x, unsigned char* simbolo) {
+    uint32_t e = tabla->entrada[x & (ANS_TOTAL - 1)];
+    *simbolo = (unsigned char)e;
+    return (((e >> 8) & (ANS_TOTAL - 1)) + 1) * (x >> ANS_BITS_ESCALA) + (e >> 20);
+}
+
+// Completa un estado por debajo de ANS_ESTADO_MIN con los 16 bits siguientes del payload
+static inline uint32_t renormalizar(uint32_t x, const uint8_t* p) {
+    return (x << 16) | (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+/**
+ * Decodifica exactamente n_salida bytes de un payload escrito por codificar_ans. El ciclo rápido
+ * decodifica ANS_ESTADOS símbolos por vuelta sin revisar el final (cada estado lee a lo sumo 16 bits);
+ * la cola revisa cada byte. Al final todo el payload debe estar consumido y cada estado debe volver
+ * a ANS_ESTADO_MIN, que es donde empezó el codificador.
+ */
+int descomprimir_ans_en(const struct ModeloANS* modelo, const uint8_t* datos, size_t n_bytes,
+                        unsigned char* salida, size_t n_salida) {
+    if (n_bytes < (size_t)ANS_ESTADOS * 4) {
+        printf("Error: payload ANS truncado\n");
+        return -1;
+    }
+    struct TablaANS* tabla = (struct TablaANS*)malloc(sizeof(struct TablaANS));
+    if (!tabla) {
+        printf("Error de memoria para la tabla ANS\n");
+        return -1;
+    }
+    construir_tabla_ans(modelo, tabla);
+
+    uint32_t x[ANS_ESTADOS];
+    const uint8_t* p = datos;
+    const uint8_t* fin = datos + n_bytes;
+    for (int j = 0; j < ANS_ESTADOS; j++, p += 4) {
+        x[j] = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    size_t i = 0;
+    while (n_salida - i >= ANS_ESTADOS && fin - p >= 2 * ANS_ESTADOS) {
+        for (int j = 0; j < ANS_ESTADOS; j++) {
+            x[j] = paso_ans(tabla, x[j], &salida[i + j]);
+            if (x[j] < ANS_ESTADO_MIN) {
+                x[j] = renormalizar(x[j], p);
+                p += 2;
+            }
+        }
+        i += ANS_ESTADOS;
+    }
+    int rc = 0;
+    for (; i < n_salida && rc == 0; i++) {
+        uint32_t* xj = &x[i % ANS_ESTADOS];
+        *xj = paso_ans(tabla, *xj, &salida[i]);
+        if (*xj < ANS_ESTADO_MIN) {
+            if (fin - p < 2) {
+                rc = -1;
+                break;
+            }
+            *xj = renormalizar(*xj, p);
+            p += 2;
+        }
+    }
+    free(tabla);
+
+    for (int j = 0; j < ANS_ESTADOS && rc == 0; j++) {
+        if (x[j] != ANS_ESTADO_MIN) rc = -1;
+    }
+    if (rc != 0 || p != fin) {
+        printf("Error: payload ANS inconsistente\n");
+        return -1;
+    }
+    return 0;
+}
@@ -5,61 +5,211 @@
 #include "../include/frecuencias.h"
 
 /**
- * Encuentra los dos nodos con las frecuencias más bajas en una lista.
+ * Vacía la arena en O(1); los nodos anteriores quedan inválidos.
  */
-void encontrar_dos_minimos(struct ListaNodos lista, int* min1, int* min2) {
-    *min1 = 0;
-    *min2 = 1;
-    if (lista.nodos[0]->frecuencia > lista.nodos[1]->frecuencia) {
-        *min1 = 1;
-        *min2 = 0;
+void arena_reiniciar(struct ArenaNodos* arena) {
+    arena->cantidad = 0;
+}
+
+/**
+ * Agrega un nodo sin hijos a la arena. Devuelve su índice o -1 si la arena está llena.
+ */
+int arena_nuevo_nodo(struct ArenaNodos* arena, unsigned char caracter, uint64_t frecuencia) {
+    if (arena->cantidad >= ARENA_MAX_NODOS) {
+        printf("Error: arena de nodos llena (%d)\n", ARENA_MAX_NODOS);
+        return -1;
+    }
+    struct NodoPlano* nodo = &arena->nodos[arena->cantidad];
+    nodo->frecuencia = frecuencia;
+    nodo->izquierda = nodo->derecha = ARENA_NULO;
+    nodo->caracter = caracter;
+    return arena->cantidad++;
+}
+
+// Orden total para las hojas: frecuencia ascendente y, en empate, carácter ascendente
+static int comparar_hojas(const void* a, const void* b) {
+    const struct NodoPlano* na = (const struct NodoPlano*)a;
+    const struct NodoPlano* nb = (const struct NodoPlano*)b;
+    if (na->frecuencia != nb->frecuencia) return (na->frecuencia < nb->frecuencia) ? -1 : 1;
+    return (int)na->caracter - (int)nb->caracter;
+}
+
+/**
+ * Construye el árbol de Huffman en la arena en O(n log n) y devuelve el índice de la raíz
+ * (-1 si no hay símbolos). Las hojas se ordenan una vez en [0, n) y los nodos internos se
+ * agregan a continuación en orden no decreciente de frecuencia, así la misma arena sirve de
+ * dos colas. Los empates se resuelven siempre igual (hoja antes que interno, luego por
+ * carácter), así el árbol es reproducible.
+ */
+int arena_construir_arbol(struct ArenaNodos* arena, const uint64_t* frecuencias) {
+    arena_reiniciar(arena);
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (frecuencias[c] > 0) arena_nuevo_nodo(arena, (unsigned char)c, frecuencias[c]);
     }
-    for (int i = 2; i < lista.cantidad; i++) {
-        if (lista.nodos[i]->frecuencia < lista.nodos[*min1]->frecuencia) {
-            *min2 = *min1;
-            *min1 = i;
-        } else if (lista.nodos[i]->frecuencia < lista.nodos[*min2]->frecuencia) {
-            *min2 = i;
+    int n = arena->cantidad;
+    if (n == 0) return -1;
+
+    struct NodoPlano* nodos = arena->nodos;
+    qsort(nodos, (size_t)n, sizeof(struct NodoPlano), comparar_hojas);
+
+    int h = 0, k = n;   // frentes de la cola de hojas y de la de internos
+    while (arena->cantidad < 2 * n - 1) {
+        int hijos[2];
+        for (int j = 0; j < 2; j++) {
+            if (h < n && (k >= arena->cantidad || nodos[h].frecuencia <= nodos[k].frecuencia)) {
+                hijos[j] = h++;
+            } else {
+                hijos[j] = k++;
+            }
         }
+
+        int nuevo = arena_nuevo_nodo(arena, 0, nodos[hijos[0]].frecuencia + nodos[hijos[1]].frecuencia);
+        nodos[nuevo].izquierda = (uint16_t)hijos[0];
+        nodos[nuevo].derecha = (uint16_t)hijos[1];
     }
+    return arena->cantidad - 1;
+}
+
+// Copia un subárbol de la arena a nodos enlazados, reutilizando las hojas de la lista
+static struct Nodo* materializar_arbol(const struct ArenaNodos* arena, int indice, struct Nodo** hojas) {
+    const struct NodoPlano* plano = &arena->nodos[indice];
+    if (plano->izquierda == ARENA_NULO) return hojas[plano->caracter];
+
+    struct Nodo* nodo = nuevo_nodo(0, (int)plano->frecuencia);
+    nodo->izquierda = materializar_arbol(arena, plano->izquierda, hojas);
+    nodo->derecha = materializar_arbol(arena, plano->derecha, hojas);
+    return nodo;
 }
 
 /**
- * Construye el árbol de Huffman a partir de una lista de nodos.
+ * Construye el árbol de Huffman enlazado a partir de una lista de nodos, con la misma forma
+ * que arena_construir_arbol. Toma posesión del arreglo de la lista.
  */
 struct Nodo* construir_arbol_huffman(struct ListaNodos lista_inicial) {
-    struct ListaNodos lista_actual = lista_inicial;
-    while (lista_actual.cantidad > 1) {
-        int min1, min2;
-        encontrar_dos_minimos(lista_actual, &min1, &min2);
-        
-        struct Nodo* nuevo = nuevo_nodo(0, 
-            lista_actual.nodos[min1]->frecuencia + lista_actual.nodos[min2]->frecuencia);
-        nuevo->izquierda = lista_actual.nodos[min1];
-        nuevo->derecha = lista_actual.nodos[min2];
-        
-        // Crear nueva lista sin los dos mínimos y con el nuevo nodo
-        struct ListaNodos nueva_lista;
-        nueva_lista.cantidad = lista_actual.cantidad - 1;
-        nueva_lista.nodos = (struct Nodo**)malloc(nueva_lista.cantidad * sizeof(struct Nodo*));
-        
-        int j = 0;
-        for (int i = 0; i < lista_actual.cantidad; i++) {
-            if (i != min1 && i != min2) {
-                nueva_lista.nodos[j] = lista_actual.nodos[i];
-                j++;
+    uint64_t frecuencias[TAM_MAX] = {0};
+    struct Nodo* hojas[TAM_MAX] = {0};
+    for (int i = 0; i < lista_inicial.cantidad; i++) {
+        struct Nodo* hoja = lista_inicial.nodos[i];
+        frecuencias[hoja->caracter] = (uint64_t)hoja->frecuencia;
+        hojas[hoja->caracter] = hoja;
+    }
+    free(lista_inicial.nodos); // Liberar el arreglo (los nodos se conservan en el árbol)
+
+    struct ArenaNodos arena;
+    int raiz = arena_construir_arbol(&arena, frecuencias);
+    if (raiz < 0) return NULL;
+    return materializar_arbol(&arena, raiz, hojas);
+}
+
+// Elemento de una lista del package-merge: hoja (símbolo) o paquete de dos elementos del nivel siguiente
+struct ElementoPaquete {
+    unsigned long long peso;
+    int simbolo;                // -1 si es un paquete
+};
+
+// Orden de las hojas: peso ascendente y, en empate, símbolo ascendente
+static int comparar_elementos(const void* a, const void* b) {
+    const struct ElementoPaquete* ea = (const struct ElementoPaquete*)a;
+    const struct ElementoPaquete* eb = (const struct ElementoPaquete*)b;
+    if (ea->peso != eb->peso) return (ea->peso < eb->peso) ? -1 : 1;
+    return ea->simbolo - eb->simbolo;
+}
+
+/**
+ * Calcula longitudes de código óptimas con longitud máxima 'limite' usando package-merge.
+ * Los empates se resuelven por símbolo y las hojas preceden a los paquetes, así el
+ * resultado es determinista. Devuelve 0 si tuvo éxito, -1 si el límite no alcanza.
+ */
+int limitar_longitudes(const uint64_t* frecuencias, unsigned char* longitudes, int limite) {
+    return limitar_longitudes_n(frecuencias, TAM_MAX, longitudes, limite);
+}
+
+/**
+ * Igual que limitar_longitudes para un alfabeto de n_simbolos (por ejemplo, bytes más palabras).
+ */
+int limitar_longitudes_n(const uint64_t* frecuencias, int n_simbolos, unsigned char* longitudes, int limite) {
+    memset(longitudes, 0, (size_t)n_simbolos);
+
+    // Hojas ordenadas por (frecuencia, símbolo)
+    int n = 0;
+    for (int c = 0; c < n_simbolos; c++) {
+        if (frecuencias[c]) n++;
+    }
+    if (n == 0) return 0;
+
+    struct ElementoPaquete* hojas = (struct ElementoPaquete*)malloc((size_t)n * sizeof(struct ElementoPaquete));
+    if (!hojas) return -1;
+    n = 0;
+    for (int c = 0; c < n_simbolos; c++) {
+        if (frecuencias[c] == 0) continue;
+        hojas[n].peso = (unsigned long long)frecuencias[c];
+        hojas[n].simbolo = c;
+        n++;
+    }
+    qsort(hojas, (size_t)n, sizeof(struct ElementoPaquete), comparar_elementos);
+
+    if (n == 1) {
+        longitudes[hojas[0].simbolo] = 1;
+        free(hojas);
+        return 0;
+    }
+    if (limite < 1 || limite > 30 || (1 << limite) < n) {
+        printf("Error: límite de %d bits insuficiente para %d símbolos\n", limite, n);
+        free(hojas);
+        return -1;
+    }
+
+    // listas[j] para j = 0 (nivel más superficial) .. limite-1 (solo hojas); cada una tiene a lo sumo 2n elementos
+    size_t ancho = 2 * (size_t)n;
+    struct ElementoPaquete* listas = (struct ElementoPaquete*)malloc((size_t)limite * ancho * sizeof(struct ElementoPaquete));
+    int* largo = (int*)malloc((size_t)limite * sizeof(int));
+    if (!listas || !largo) {
+        free(listas);
+        free(largo);
+        free(hojas);
+        return -1;
+    }
+
+    struct ElementoPaquete* ultima = listas + (size_t)(limite - 1) * ancho;
+    memcpy(ultima, hojas, (size_t)n * sizeof(hojas[0]));
+    largo[limite - 1] = n;
+
+    for (int j = limite - 2; j >= 0; j--) {
+        const struct ElementoPaquete* siguiente = listas + (size_t)(j + 1) * ancho;
+        struct ElementoPaquete* actual = listas + (size_t)j * ancho;
+        int paquetes = largo[j + 1] / 2;
+        int h = 0, p = 0, k = 0;
+        while (h < n || p < paquetes) {
+            unsigned long long peso_paquete = 0;
+            if (p < paquetes) peso_paquete = siguiente[2 * p].peso + siguiente[2 * p + 1].peso;
+            if (h < n && (p >= paquetes || hojas[h].peso <= peso_paquete)) {
+                actual[k++] = hojas[h++];
+            } else {
+                actual[k].peso = peso_paquete;
+                actual[k].simbolo = -1;
+                k++;
+                p++;
             }
         }
-        nueva_lista.nodos[j] = nuevo;
-        
-        // Liberar solo el arreglo de la lista actual (los nodos se conservan en el árbol)
-        free(lista_actual.nodos);
-        lista_actual = nueva_lista;
+        largo[j] = k;
     }
-    
-    struct Nodo* raiz = lista_actual.nodos[0];
-    free(lista_actual.nodos); // Liberar el arreglo final
-    return raiz;
+
+    // Se eligen los 2n-2 primeros del nivel 0; cada paquete elegido arrastra dos elementos del nivel siguiente
+    int elegidos = 2 * n - 2;
+    for (int j = 0; j < limite && elegidos > 0; j++) {
+        const struct ElementoPaquete* actual = listas + (size_t)j * ancho;
+        int paquetes = 0;
+        for (int i = 0; i < elegidos && i < largo[j]; i++) {
+            if (actual[i].simbolo >= 0) longitudes[actual[i].simbolo]++;
+            else paquetes++;
+        }
+        elegidos = 2 * paquetes;
+    }
+
+    free(listas);
+    free(largo);
+    free(hojas);
+    return 0;
 }
 
 /**
@@ -147,15 +297,18 @@ char* comprimir_texto(const char* texto, char** tabla) {
     
     // Asignar memoria para el texto comprimido
     char* texto_comprimido = (char*)malloc(longitud_comprimida + 1);
-    texto_comprimido[0] = '\0';
     
-    // Construir texto comprimido
+    // Construir texto comprimido avanzando un puntero de escritura (sin strcat cuadrático)
+    char* escritura = texto_comprimido;
     for (int i = 0; i < longitud_original; i++) {
         unsigned char c = texto[i];
         if (tabla[c] != NULL) {
-            strcat(texto_comprimido, tabla[c]);
+            size_t longitud_codigo = strlen(tabla[c]);
+            memcpy(escritura, tabla[c], longitud_codigo);
+            escritura += longitud_codigo;
         }
     }
+    *escritura = '\0';
     
     return texto_comprimido;
 }
@@ -231,72 +384,62 @@ char* descomprimir_texto(struct Nodo* raiz, const char* texto_comprimido, long t
 }
 
 // Función auxiliar para serializar el árbol recursivamente
-void serializar_arbol_recursivo(struct Nodo* raiz, FILE* archivo) {
-    if (raiz == NULL) {
-        unsigned char marcador = 0;
-        fwrite(&marcador, sizeof(unsigned char), 1, archivo);
-        return;
-    }
-    
-    if (raiz->izquierda == NULL && raiz->derecha == NULL) {
+static void serializar_arbol_recursivo(const struct ArenaNodos* arena, int indice, FILE* archivo) {
+    const struct NodoPlano* nodo = &arena->nodos[indice];
+    if (nodo->izquierda == ARENA_NULO) {
         // Nodo hoja
         unsigned char marcador = 1;
         fwrite(&marcador, sizeof(unsigned char), 1, archivo);
-        fwrite(&raiz->caracter, sizeof(unsigned char), 1, archivo);
+        fwrite(&nodo->caracter, sizeof(unsigned char), 1, archivo);
     } else {
         // Nodo interno
         unsigned char marcador = 2;
         fwrite(&marcador, sizeof(unsigned char), 1, archivo);
-        serializar_arbol_recursivo(raiz->izquierda, archivo);
-        serializar_arbol_recursivo(raiz->derecha, archivo);
+        serializar_arbol_recursivo(arena, nodo->izquierda, archivo);
+        serializar_arbol_recursivo(arena, nodo->derecha, archivo);
     }
 }
 
-// Función auxiliar para deserializar el árbol recursivamente
-struct Nodo* deserializar_arbol_recursivo(FILE* archivo) {
+// Función auxiliar para deserializar el árbol recursivamente; devuelve el índice o -1
+static int deserializar_arbol_recursivo(struct ArenaNodos* arena, FILE* archivo) {
     unsigned char marcador;
     if (fread(&marcador, sizeof(unsigned char), 1, archivo) != 1) {
         printf("Error leyendo marcador del árbol\n");
-        return NULL;
+        return -1;
     }
     
-    if (marcador == 0) {
-        return NULL;
-    } else if (marcador == 1) {
+    if (marcador == 1) {
         // Nodo hoja
         unsigned char caracter;
         if (fread(&caracter, sizeof(unsigned char), 1, archivo) != 1) {
             printf("Error leyendo caracter del árbol\n");
-            return NULL;
+            return -1;
         }
-        return nuevo_nodo(caracter, 0);
+        return arena_nuevo_nodo(arena, caracter, 0);
     } else if (marcador == 2) {
-        // Nodo interno
-        struct Nodo* nodo = nuevo_nodo(0, 0);
-        nodo->izquierda = deserializar_arbol_recursivo(archivo);
-        nodo->derecha = deserializar_arbol_recursivo(archivo);
-        
-        // Verificar que ambos hijos se crearon correctamente
-        if (!nodo->izquierda || !nodo->derecha) {
-            printf("Error al crear nodos hijos\n");
-            liberar_arbol(nodo);
-            return NULL;
-        }
-        
+        // Nodo interno: la arena acota la profundidad de un árbol corrupto
+        int nodo = arena_nuevo_nodo(arena, 0, 0);
+        if (nodo < 0) return -1;
+        int izquierda = deserializar_arbol_recursivo(arena, archivo);
+        if (izquierda < 0) return -1;
+        int derecha = deserializar_arbol_recursivo(arena, archivo);
+        if (derecha < 0) return -1;
+        arena->nodos[nodo].izquierda = (uint16_t)izquierda;
+        arena->nodos[nodo].derecha = (uint16_t)derecha;
         return nodo;
     } else {
         printf("Marcador inválido: %d\n", marcador);
-        return NULL;
+        return -1;
     }
 }
 
-// Serializar el árbol de Huffman
-int serializar_arbol(struct Nodo* raiz, FILE* archivo) {
-    if (!raiz || !archivo) {
+// Serializar el árbol de Huffman guardado en la arena
+int serializar_arbol(const struct ArenaNodos* arena, int raiz, FILE* archivo) {
+    if (!arena || raiz < 0 || raiz >= arena->cantidad || !archivo) {
         printf("Error: parámetros inválidos para serializar_arbol\n");
         return 0;
     }
-    serializar_arbol_recursivo(raiz, archivo);
+    serializar_arbol_recursivo(arena, raiz, archivo);
     
     // Escribir marcador de finalización
     unsigned char marcador_fin = 255;
@@ -308,22 +451,23 @@ int serializar_arbol(struct Nodo* raiz, FILE* archivo) {
     return 1;
 }
 
-// Deserializar el árbol de Huffman
-struct Nodo* deserializar_arbol(FILE* archivo) {
+// Deserializar el árbol de Huffman en la arena (que se reinicia); devuelve la raíz o -1
+int deserializar_arbol(struct ArenaNodos* arena, FILE* archivo) {
     if (!archivo) {
         printf("Error: archivo inválido para deserializar_arbol\n");
-        return NULL;
+        return -1;
     }
     
-    struct Nodo* raiz = deserializar_arbol_recursivo(archivo);
+    arena_reiniciar(arena);
+    int raiz = deserializar_arbol_recursivo(arena, archivo);
+    if (raiz < 0) return -1;
     
     // Verificar marcador de finalización
     unsigned char marcador_fin;
     if (fread(&marcador_fin, sizeof(unsigned char), 1, archivo) != 1 || marcador_fin != 255) {
         printf("Error: marcador de finalización no encontrado\n");
-        liberar_arbol(raiz);
-        return NULL;
+        return -1;
     }
     
     return raiz;
-}
\ No newline at end of file
+}
@@ -0,0 +1,615 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/codigos.h"
+#include "../include/arbol.h"
+#include "../include/frecuencias.h"
+
+// Recorre el árbol acumulando el código como entero (izquierda = 0, derecha = 1)
+static int generar_tabla_recursivo(const struct ArenaNodos* arena, int indice, uint64_t codigo,
+                                   int profundidad, struct TablaCodigos* tabla) {
+    const struct NodoPlano* nodo = &arena->nodos[indice];
+    if (nodo->izquierda == ARENA_NULO) {
+        tabla->codigo[nodo->caracter] = codigo;
+        tabla->longitud[nodo->caracter] = (unsigned char)profundidad;
+        return 0;
+    }
+
+    if (profundidad >= HUF_BITS_MAX) {
+        printf("Error: código de Huffman excede %d bits\n", HUF_BITS_MAX);
+        return -1;
+    }
+
+    if (generar_tabla_recursivo(arena, nodo->izquierda, codigo << 1, profundidad + 1, tabla) != 0) return -1;
+    return generar_tabla_recursivo(arena, nodo->derecha, (codigo << 1) | 1u, profundidad + 1, tabla);
+}
+
+/**
+ * Genera la tabla de códigos empaquetados (código + longitud) a partir del árbol de la arena.
+ * Los códigos coinciden bit a bit con los de generar_codigos_huffman. Con raiz < 0 la tabla queda vacía.
+ */
+int generar_tabla_codigos(const struct ArenaNodos* arena, int raiz, struct TablaCodigos* tabla) {
+    memset(tabla, 0, sizeof(*tabla));
+    if (raiz < 0) return 0;
+    return generar_tabla_recursivo(arena, raiz, 0, 0, tabla);
+}
+
+/**
+ * Asigna códigos canónicos a partir de las longitudes: los códigos de igual longitud son
+ * consecutivos y se ordenan por símbolo. Falla si las longitudes no forman un código prefijo.
+ */
+int asignar_codigos_canonicos(const unsigned char* longitudes, struct TablaCodigos* tabla) {
+    memset(tabla, 0, sizeof(*tabla));
+    if (asignar_codigos_canonicos_n(longitudes, TAM_MAX, tabla->codigo) != 0) return -1;
+    memcpy(tabla->longitud, longitudes, TAM_MAX);
+    return 0;
+}
+
+/**
+ * Igual que asignar_codigos_canonicos para un alfabeto de n_simbolos: deja el código de cada
+ * símbolo en codigos (0 para los que no tienen código).
+ */
+int asignar_codigos_canonicos_n(const unsigned char* longitudes, int n_simbolos, uint64_t* codigos) {
+    int cantidad[HUF_BITS_MAX + 1] = {0};
+    for (int c = 0; c < n_simbolos; c++) {
+        if (longitudes[c] > HUF_BITS_MAX) {
+            printf("Error: longitud de código inválida (%d)\n", longitudes[c]);
+            return -1;
+        }
+        if (longitudes[c]) cantidad[longitudes[c]]++;
+    }
+
+    // Primer código de cada longitud, verificando la desigualdad de Kraft
+    uint64_t siguiente[HUF_BITS_MAX + 1];
+    uint64_t codigo = 0;
+    for (int longitud = 1; longitud <= HUF_BITS_MAX; longitud++) {
+        codigo = (codigo + (uint64_t)cantidad[longitud - 1]) << 1;
+        siguiente[longitud] = codigo;
+        if (codigo + (uint64_t)cantidad[longitud] > ((uint64_t)1 << longitud)) {
+            printf("Error: longitudes de código sobresuscritas\n");
+            return -1;
+        }
+    }
+
+    for (int c = 0; c < n_simbolos; c++) {
+        codigos[c] = longitudes[c] ? siguiente[longitudes[c]]++ : 0;
+    }
+    return 0;
+}
+
+/**
+ * Calcula las longitudes de Huffman para las frecuencias dadas y asigna códigos canónicos.
+ * Si 'limite' > 0 y algún código lo excede, las longitudes se recalculan con package-merge
+ * y en 'penalizacion' (opcional) se informan los bits extra respecto de Huffman sin límite.
+ * Un único símbolo recibe un código de 1 bit; sin símbolos la tabla queda vacía.
+ */
+int generar_codigos_canonicos(const uint64_t* frecuencias, int limite, unsigned char* longitudes,
+                              struct TablaCodigos* tabla, uint64_t* penalizacion) {
+    memset(longitudes, 0, TAM_MAX);
+    if (penalizacion) *penalizacion = 0;
+
+    int presentes = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (frecuencias[c] > 0) presentes++;
+    }
+    if (presentes == 1) {
+        for (int c = 0; c < TAM_MAX; c++) {
+            if (frecuencias[c] > 0) longitudes[c] = 1;
+        }
+    } else if (presentes > 1) {
+        struct ArenaNodos arena;
+        int raiz = arena_construir_arbol(&arena, frecuencias);
+        struct TablaCodigos arbol;
+        int rc = generar_tabla_codigos(&arena, raiz, &arbol);
+        if (rc != 0 && limite <= 0) return -1;
+        memcpy(longitudes, arbol.longitud, TAM_MAX);
+
+        int longitud_max = 0;
+        for (int c = 0; c < TAM_MAX; c++) {
+            if (longitudes[c] > longitud_max) longitud_max = longitudes[c];
+        }
+
+        if (limite > 0 && (rc != 0 || longitud_max > limite)) {
+            uint64_t bits_huffman = 0, bits_limitados = 0;
+            for (int c = 0; c < TAM_MAX; c++) bits_huffman += frecuencias[c] * longitudes[c];
+            if (limitar_longitudes(frecuencias, longitudes, limite) != 0) return -1;
+            for (int c = 0; c < TAM_MAX; c++) bits_limitados += frecuencias[c] * longitudes[c];
+            if (penalizacion && rc == 0) *penalizacion = bits_limitados - bits_huffman;
+        }
+    }
+
+    return asignar_codigos_canonicos(longitudes, tabla);
+}
+
+/**
+ * Estima el tamaño comprimido desde el histograma: arma el mismo código canónico que usaría el
+ * compresor (con el límite de longitud) y suma frecuencia × longitud, así los bits de Huffman son
+ * exactos. Agrega la cota de Shannon y el tamaño de la cabecera de longitudes.
+ */
+int estimar_huffman(const uint64_t* frecuencias, int limite, struct EstimacionHuffman* estimacion) {
+    unsigned char longitudes[TAM_MAX];
+    struct TablaCodigos tabla;
+    uint8_t cabecera[HUF_CABECERA_MAX];
+    memset(estimacion, 0, sizeof(*estimacion));
+    if (generar_codigos_canonicos(frecuencias, limite, longitudes, &tabla, &estimacion->penalizacion) != 0) {
+        return -1;
+    }
+
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (frecuencias[c] == 0) continue;
+        estimacion->simbolos += frecuencias[c];
+        estimacion->distintos++;
+        estimacion->bits_huffman += frecuencias[c] * longitudes[c];
+    }
+    estimacion->bits_entropia = bits_entropia(frecuencias);
+    estimacion->bytes_cabecera = escribir_longitudes(longitudes, cabecera);
+    return 0;
+}
+
+/**
+ * Escribe las longitudes de código en forma compacta: longitud máxima, mapa de bits de
+ * símbolos presentes y una longitud por símbolo presente (nibbles si todas caben en 4 bits).
+ * Devuelve los bytes escritos (como máximo HUF_CABECERA_MAX).
+ */
+size_t escribir_longitudes(const unsigned char* longitudes, uint8_t* buffer) {
+    int longitud_max = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (longitudes[c] > longitud_max) longitud_max = longitudes[c];
+    }
+
+    size_t n = 0;
+    buffer[n++] = (uint8_t)longitud_max;
+    if (longitud_max == 0) return n;
+
+    memset(buffer + n, 0, TAM_MAX / 8);
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (longitudes[c]) buffer[n + c / 8] |= (uint8_t)(0x80u >> (c % 8));
+    }
+    n += TAM_MAX / 8;
+
+    int medio_byte = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (!longitudes[c]) continue;
+        if (longitud_max > 15) {
+            buffer[n++] = longitudes[c];
+        } else if (!medio_byte) {
+            buffer[n] = (uint8_t)(longitudes[c] << 4);
+            medio_byte = 1;
+        } else {
+            buffer[n++] |= longitudes[c];
+            medio_byte = 0;
+        }
+    }
+    if (medio_byte) n++;
+    return n;
+}
+
+/**
+ * Lee la cabecera escrita por escribir_longitudes. Devuelve los bytes consumidos o -1.
+ */
+int leer_longitudes(const uint8_t* buffer, size_t n, unsigned char* longitudes) {
+    memset(longitudes, 0, TAM_MAX);
+    if (n < 1) return -1;
+
+    int longitud_max = buffer[0];
+    if (longitud_max > HUF_BITS_MAX) return -1;
+    if (longitud_max == 0) return 1;
+    if (n < 1 + TAM_MAX / 8) return -1;
+
+    const uint8_t* mapa = buffer + 1;
+    size_t pos = 1 + TAM_MAX / 8;
+    int medio_byte = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (!(mapa[c / 8] & (0x80u >> (c % 8)))) continue;
+        if (pos >= n) return -1;
+        if (longitud_max > 15) {
+            longitudes[c] = buffer[pos++];
+        } else if (!medio_byte) {
+            longitudes[c] = buffer[pos] >> 4;
+            medio_byte = 1;
+        } else {
+            longitudes[c] = buffer[pos++] & 0x0F;
+            medio_byte = 0;
+        }
+        if (longitudes[c] == 0 || longitudes[c] > longitud_max) return -1;
+    }
+    if (medio_byte) pos++;
+    return (int)pos;
+}
+
+/**
+ * Cuenta los bits que ocupará el buffer una vez codificado.
+ */
+uint64_t contar_bits_codificados(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        bits += tabla->longitud[datos[i]];
+    }
+    return bits;
+}
+
+// Bits del sub-flujo formado por datos[0], datos[paso], datos[2*paso], ...
+static uint64_t contar_bits_paso(const unsigned char* datos, size_t n, size_t paso, const struct TablaCodigos* tabla) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; i += paso) {
+        bits += tabla->longitud[datos[i]];
+    }
+    return bits;
+}
+
+/**
+ * Calcula puntos de sincronía: el bit donde empieza el símbolo de cada posición múltiplo de
+ * 'intervalo' (intervalo, 2*intervalo, ... < n). Desde cada punto se puede decodificar sin
+ * leer lo anterior. Devuelve un arreglo de *n_puntos offsets (NULL si no hay ninguno).
+ */
+uint64_t* calcular_puntos_sincronia(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                                    size_t intervalo, uint32_t* n_puntos) {
+    *n_puntos = 0;
+    if (intervalo == 0 || n <= intervalo) return NULL;
+
+    uint32_t cantidad = (uint32_t)((n - 1) / intervalo);
+    uint64_t* puntos = (uint64_t*)malloc((size_t)cantidad * sizeof(uint64_t));
+    if (!puntos) return NULL;
+
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (uint32_t k = 0; k < cantidad; k++) {
+        size_t fin = (size_t)(k + 1) * intervalo;
+        for (; i < fin; i++) bits += tabla->longitud[datos[i]];
+        puntos[k] = bits;
+    }
+    *n_puntos = cantidad;
+    return puntos;
+}
+
+/**
+ * Agrega los códigos de datos[0], datos[paso], ... al acumulador (MSB primero) y vuelca las
+ * palabras completas en p. Los bits que no llegan a una palabra quedan en el acumulador.
+ * Devuelve el puntero al final de lo escrito.
+ */
+static inline uint8_t* codificar_parcial(const unsigned char* datos, size_t n, size_t paso,
+                                         const struct TablaCodigos* tabla, uint8_t* p,
+                                         uint64_t* acumulador_io, int* pendientes_io) {
+    uint64_t acumulador = *acumulador_io;
+    int pendientes = *pendientes_io;   // bits válidos en el acumulador, siempre < 32 al entrar al ciclo
+
+    for (size_t i = 0; i < n; i += paso) {
+        unsigned char c = datos[i];
+        int longitud = tabla->longitud[c];
+        uint64_t codigo = tabla->codigo[c];
+
+        // Códigos largos: volcar primero la parte alta para no desbordar el acumulador
+        if (longitud > 32) {
+            int alta = longitud - 32;
+            acumulador = (acumulador << alta) | (codigo >> 32);
+            pendientes += alta;
+            while (pendientes >= 8) {
+                pendientes -= 8;
+                *p++ = (uint8_t)(acumulador >> pendientes);
+            }
+            codigo &= 0xFFFFFFFFu;
+            longitud = 32;
+        }
+
+        acumulador = (acumulador << longitud) | codigo;
+        pendientes += longitud;
+
+        if (pendientes >= 32) {
+            pendientes -= 32;
+            uint32_t palabra = (uint32_t)(acumulador >> pendientes);
+            p[0] = (uint8_t)(palabra >> 24);
+            p[1] = (uint8_t)(palabra >> 16);
+            p[2] = (uint8_t)(palabra >> 8);
+            p[3] = (uint8_t)palabra;
+            p += 4;
+        }
+    }
+
+    *acumulador_io = acumulador;
+    *pendientes_io = pendientes;
+    return p;
+}
+
+/**
+ * Igual que codificar_parcial con paso 1, pero cada símbolo usa la tabla del contexto de su
+ * byte anterior (*previo_io, que se actualiza al último byte codificado).
+ */
+static inline uint8_t* codificar_parcial_contexto(const unsigned char* datos, size_t n,
+                                                  const struct ModeloContexto* modelo, uint8_t* p,
+                                                  uint64_t* acumulador_io, int* pendientes_io,
+                                                  unsigned char* previo_io) {
+    const struct TablaCodigos* tabla_de[TAM_MAX];
+    for (int c = 0; c < TAM_MAX; c++) tabla_de[c] = &modelo->tablas[modelo->mapa[c]];
+
+    uint64_t acumulador = *acumulador_io;
+    int pendientes = *pendientes_io;
+    unsigned char previo = *previo_io;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = datos[i];
+        const struct TablaCodigos* tabla = tabla_de[previo];
+        int longitud = tabla->longitud[c];
+        uint64_t codigo = tabla->codigo[c];
+        previo = c;
+
+        if (longitud > 32) {
+            int alta = longitud - 32;
+            acumulador = (acumulador << alta) | (codigo >> 32);
+            pendientes += alta;
+            while (pendientes >= 8) {
+                pendientes -= 8;
+                *p++ = (uint8_t)(acumulador >> pendientes);
+            }
+            codigo &= 0xFFFFFFFFu;
+            longitud = 32;
+        }
+
+        acumulador = (acumulador << longitud) | codigo;
+        pendientes += longitud;
+
+        if (pendientes >= 32) {
+            pendientes -= 32;
+            uint32_t palabra = (uint32_t)(acumulador >> pendientes);
+            p[0] = (uint8_t)(palabra >> 24);
+            p[1] = (uint8_t)(palabra >> 16);
+            p[2] = (uint8_t)(palabra >> 8);
+            p[3] = (uint8_t)palabra;
+            p += 4;
+        }
+    }
+
+    *acumulador_io = acumulador;
+    *pendientes_io = pendientes;
+    *previo_io = previo;
+    return p;
+}
+
+/**
+ * Codifica datos[0], datos[paso], ... en p (MSB primero) con un acumulador de 64 bits y
+ * rellena con ceros el último byte parcial. Devuelve el puntero al final de lo escrito.
+ */
+static inline uint8_t* codificar_en(const unsigned char* datos, size_t n, size_t paso,
+                                    const struct TablaCodigos* tabla, uint8_t* p) {
+    uint64_t acumulador = 0;
+    int pendientes = 0;
+    p = codificar_parcial(datos, n, paso, tabla, p, &acumulador, &pendientes);
+
+    // Vaciar los bytes completos restantes y el último byte parcial con relleno de ceros
+    while (pendientes >= 8) {
+        pendientes -= 8;
+        *p++ = (uint8_t)(acumulador >> pendientes);
+    }
+    if (pendientes > 0) {
+        *p++ = (uint8_t)(acumulador << (8 - pendientes));
+    }
+    return p;
+}
+
+/**
+ * Codifica un buffer de bytes directamente a bits empaquetados (MSB primero)
+ * usando un acumulador de 64 bits. Devuelve el buffer empaquetado o NULL si falla.
+ */
+uint8_t* codificar_bits(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                        size_t* out_len, uint64_t* out_bits) {
+    uint64_t bits = contar_bits_codificados(datos, n, tabla);
+    size_t bytes = (size_t)((bits + 7) / 8);
+
+    uint8_t* salida = (uint8_t*)malloc(bytes ? bytes : 1);
+    if (!salida) {
+        printf("Error de memoria para texto codificado (bits: %llu)\n", (unsigned long long)bits);
+        return NULL;
+    }
+
+    codificar_en(datos, n, 1, tabla, salida);
+
+    *out_len = bytes;
+    *out_bits = bits;
+    return salida;
+}
+
+/**
+ * Bits que ocupa una entrada en modo de contexto, calculados desde su histograma de orden 1.
+ */
+uint64_t contar_bits_contexto(const uint64_t* frecuencias1, const struct ModeloContexto* modelo) {
+    uint64_t bits = 0;
+    for (int previo = 0; previo < TAM_MAX; previo++) {
+        const unsigned char* longitudes = modelo->longitudes[modelo->mapa[previo]];
+        const uint64_t* fila = frecuencias1 + (size_t)previo * TAM_MAX;
+        for (int c = 0; c < TAM_MAX; c++) bits += fila[c] * longitudes[c];
+    }
+    return bits;
+}
+
+/**
+ * Codifica un buffer en modo de contexto de orden 1 (el byte anterior al primero es 0).
+ * Devuelve el buffer empaquetado o NULL si falla.
+ */
+uint8_t* codificar_contexto(const unsigned char* datos, size_t n, const struct ModeloContexto* modelo,
+                            size_t* out_len, uint64_t* out_bits) {
+    uint64_t bits = 0;
+    unsigned char previo = 0;
+    for (size_t i = 0; i < n; i++) {
+        bits += modelo->longitudes[modelo->mapa[previo]][datos[i]];
+        previo = datos[i];
+    }
+    size_t bytes = (size_t)((bits + 7) / 8);
+
+    uint8_t* salida = (uint8_t*)malloc(bytes ? bytes : 1);
+    if (!salida) {
+        printf("Error de memoria para texto codificado (bits: %llu)\n", (unsigned long long)bits);
+        return NULL;
+    }
+
+    uint64_t acumulador = 0;
+    int pendientes = 0;
+    previo = 0;
+    uint8_t* p = codificar_parcial_contexto(datos, n, modelo, salida, &acumulador, &pendientes, &previo);
+    while (pendientes >= 8) {
+        pendientes -= 8;
+        *p++ = (uint8_t)(acumulador >> pendientes);
+    }
+    if (pendientes > 0) {
+        *p++ = (uint8_t)(acumulador << (8 - pendientes));
+    }
+
+    *out_len = bytes;
+    *out_bits = bits;
+    return salida;
+}
+
+/**
+ * Codifica el buffer en n_flujos sub-flujos intercalados: el símbolo i va al flujo i % n_flujos.
+ * El resultado empieza con una tabla de saltos (n_flujos y los bits de cada flujo, u64
+ * little-endian) seguida de cada flujo alineado a byte, para que el decodificador avance
+ * por todos a la vez. En out_bits se informa la suma de bits de los flujos.
+ */
+uint8_t* codificar_flujos(const unsigned char* datos, size_t n, const struct TablaCodigos* tabla,
+                          int n_flujos, size_t* out_len, uint64_t* out_bits) {
+    if (n_flujos < 1 || n_flujos > HUF_FLUJOS_MAX) {
+        printf("Error: cantidad de flujos inválida (%d)\n", n_flujos);
+        return NULL;
+    }
+
+    uint64_t bits[HUF_FLUJOS_MAX];
+    uint64_t total_bits = 0;
+    size_t bytes = HUF_TABLA_SALTOS(n_flujos);
+    for (int f = 0; f < n_flujos; f++) {
+        bits[f] = ((size_t)f < n) ? contar_bits_paso(datos + f, n - (size_t)f, (size_t)n_flujos, tabla) : 0;
+        total_bits += bits[f];
+        bytes += (size_t)((bits[f] + 7) / 8);
+    }
+
+    uint8_t* salida = (uint8_t*)malloc(bytes);
+    if (!salida) {
+        printf("Error de memoria para texto codificado (bits: %llu)\n", (unsigned long long)total_bits);
+        return NULL;
+    }
+
+    uint8_t* p = salida;
+    *p++ = (uint8_t)n_flujos;
+    for (int f = 0; f < n_flujos; f++) {
+        for (int b = 0; b < 8; b++) *p++ = (uint8_t)(bits[f] >> (8 * b));
+    }
+    for (int f = 0; f < n_flujos; f++) {
+        if ((size_t)f < n) p = codificar_en(datos + f, n - (size_t)f, (size_t)n_flujos, tabla, p);
+    }
+
+    *out_len = bytes;
+    *out_bits = total_bits;
+    return salida;
+}
+
+/**
+ * Prepara un codificador incremental de flujo único. Los bytes empaquetados se acumulan en
+ * un buffer fijo y se entregan a 'escribir' cada vez que se llena.
+ */
+void codificador_iniciar(struct CodificadorFlujo* c, const struct TablaCodigos* tabla,
+                         funcion_escribir escribir, void* contexto) {
+    c->tabla = tabla;
+    c->escribir = escribir;
+    c->contexto = contexto;
+    c->acumulador = 0;
+    c->pendientes = 0;
+    c->entregados = 0;
+    c->posicion = 0;
+    c->bits = 0;
+    c->intervalo = 0;
+    c->puntos = NULL;
+    c->n_puntos = 0;
+    c->max_puntos = 0;
+    c->modelo = NULL;
+    c->previo = 0;
+    c->usados = 0;
+    c->error = 0;
+}
+
+/**
+ * Pasa el codificador al modo de contexto: cada símbolo se codifica con la tabla del contexto
+ * de su byte anterior. Debe llamarse antes del primer codificador_actualizar.
+ */
+void codificador_contexto(struct CodificadorFlujo* c, const struct ModeloContexto* modelo) {
+    c->modelo = modelo;
+    c->previo = 0;
+}
+
+/**
+ * Pide al codificador que registre, en 'puntos', el bit donde empieza cada posición múltiplo
+ * de 'intervalo' (hasta max_puntos). Debe llamarse antes del primer codificador_actualizar.
+ */
+void codificador_sincronia(struct CodificadorFlujo* c, uint64_t intervalo, uint64_t* puntos, uint32_t max_puntos) {
+    c->intervalo = intervalo;
+    c->puntos = puntos;
+    c->max_puntos = puntos ? max_puntos : 0;
+}
+
+// Bits emitidos hasta ahora: entregados + en el buffer + pendientes en el acumulador
+static inline uint64_t bits_emitidos(const struct CodificadorFlujo* c) {
+    return (c->entregados + c->usados) * 8 + (uint64_t)c->pendientes;
+}
+
+static int vaciar_buffer(struct CodificadorFlujo* c) {
+    if (c->usados == 0) return 0;
+    if (c->escribir(c->contexto, c->buffer, c->usados) != 0) {
+        c->error = 1;
+        return -1;
+    }
+    c->entregados += c->usados;
+    c->usados = 0;
+    return 0;
+}
+
+/**
+ * Codifica n bytes más de la entrada. Procesa de a tramos que entran en el buffer y,
+ * si se pidieron puntos de sincronía, corta los tramos en cada múltiplo del intervalo.
+ */
+int codificador_actualizar(struct CodificadorFlujo* c, const unsigned char* datos, size_t n) {
+    if (c->error) return -1;
+
+    // Cada símbolo ocupa a lo sumo HUF_BITS_MAX bits: un tramo de 'max_tramo' símbolos nunca desborda
+    const size_t por_simbolo = (HUF_BITS_MAX + 7) / 8;
+    while (n > 0) {
+        if (c->n_puntos < c->max_puntos && c->posicion == ((uint64_t)c->n_puntos + 1) * c->intervalo) {
+            c->puntos[c->n_puntos++] = bits_emitidos(c);
+        }
+
+        size_t libre = HUF_BUFFER_FLUJO - c->usados;
+        if (libre < 4 + por_simbolo * 64) {
+            if (vaciar_buffer(c) != 0) return -1;
+            libre = HUF_BUFFER_FLUJO;
+        }
+        size_t tramo = (libre - 4) / por_simbolo;
+        if (tramo > n) tramo = n;
+        if (c->n_puntos < c->max_puntos) {
+            uint64_t hasta_punto = ((uint64_t)c->n_puntos + 1) * c->intervalo - c->posicion;
+            if (hasta_punto < tramo) tramo = (size_t)hasta_punto;
+        }
+
+        uint8_t* fin = c->modelo
+                           ? codificar_parcial_contexto(datos, tramo, c->modelo, c->buffer + c->usados,
+                                                        &c->acumulador, &c->pendientes, &c->previo)
+                           : codificar_parcial(datos, tramo, 1, c->tabla, c->buffer + c->usados,
+                                               &c->acumulador, &c->pendientes);
+        c->usados = (size_t)(fin - c->buffer);
+        c->posicion += tramo;
+        datos += tramo;
+        n -= tramo;
+    }
+    return 0;
+}
+
+/**
+ * Vacía el acumulador (rellenando con ceros el último byte) y entrega lo que queda en el buffer.
+ */
+int codificador_terminar(struct CodificadorFlujo* c) {
+    if (c->error) return -1;
+    c->bits = bits_emitidos(c);
+    while (c->pendientes >= 8) {
+        c->pendientes -= 8;
+        c->buffer[c->usados++] = (uint8_t)(c->acumulador >> c->pendientes);
+    }
+    if (c->pendientes > 0) {
+        c->buffer[c->usados++] = (uint8_t)(c->acumulador << (8 - c->pendientes));
+        c->pendientes = 0;
+    }
+    return vaciar_buffer(c);
+}
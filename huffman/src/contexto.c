@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/contexto.h"
+
+// Bits que costaría codificar la fila de un contexto con las longitudes de un grupo
+static uint64_t costo_fila(const uint64_t* fila, const unsigned char* longitudes) {
+    uint64_t bits = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (fila[c]) bits += fila[c] * (longitudes[c] ? longitudes[c] : CONTEXTO_COSTO_AUSENTE);
+    }
+    return bits;
+}
+
+/**
+ * Agrupa los contextos (byte anterior) del histograma de orden 1 en a lo sumo n_contextos grupos
+ * y arma un código canónico por grupo. Empieza con los contextos más frecuentes como semillas y
+ * reasigna cada contexto al grupo cuyo código lo codifica en menos bits, hasta que no cambia
+ * ninguno o se cumplen CONTEXTO_RONDAS rondas. En *bits devuelve el tamaño del payload.
+ */
+int construir_modelo_contexto(const uint64_t* frecuencias1, int n_contextos, int limite,
+                              struct ModeloContexto* modelo, uint64_t* bits) {
+    if (n_contextos < 1 || n_contextos > HUF_CONTEXTOS_MAX) return -1;
+
+    // Contextos presentes, de mayor a menor cantidad de símbolos
+    uint64_t total[TAM_MAX];
+    int orden[TAM_MAX], n_activos = 0;
+    for (int p = 0; p < TAM_MAX; p++) {
+        total[p] = 0;
+        for (int c = 0; c < TAM_MAX; c++) total[p] += frecuencias1[(size_t)p * TAM_MAX + c];
+        if (total[p] == 0) continue;
+        int i = n_activos++;
+        while (i > 0 && total[orden[i - 1]] < total[p]) {
+            orden[i] = orden[i - 1];
+            i--;
+        }
+        orden[i] = p;
+    }
+    if (n_activos == 0) return -1;
+
+    int k = (n_activos < n_contextos) ? n_activos : n_contextos;
+    int grupo[TAM_MAX];
+    for (int p = 0; p < TAM_MAX; p++) grupo[p] = -1;
+    for (int g = 0; g < k; g++) grupo[orden[g]] = g;
+
+    uint64_t suma[HUF_CONTEXTOS_MAX][TAM_MAX];
+    unsigned char longitudes[HUF_CONTEXTOS_MAX][TAM_MAX];
+    struct TablaCodigos tabla;
+    for (int ronda = 0; ronda < CONTEXTO_RONDAS; ronda++) {
+        // Histograma y longitudes de cada grupo con su asignación actual
+        memset(suma, 0, sizeof(suma));
+        for (int i = 0; i < n_activos; i++) {
+            int p = orden[i];
+            if (grupo[p] < 0) continue;
+            for (int c = 0; c < TAM_MAX; c++) suma[grupo[p]][c] += frecuencias1[(size_t)p * TAM_MAX + c];
+        }
+        for (int g = 0; g < k; g++) {
+            if (generar_codigos_canonicos(suma[g], limite, longitudes[g], &tabla, NULL) != 0) return -1;
+        }
+
+        // Reasignar cada contexto al grupo que lo codifica más barato
+        int cambios = 0;
+        for (int i = 0; i < n_activos; i++) {
+            int p = orden[i];
+            const uint64_t* fila = frecuencias1 + (size_t)p * TAM_MAX;
+            int mejor = 0;
+            uint64_t mejor_costo = costo_fila(fila, longitudes[0]);
+            for (int g = 1; g < k; g++) {
+                uint64_t costo = costo_fila(fila, longitudes[g]);
+                if (costo < mejor_costo) {
+                    mejor = g;
+                    mejor_costo = costo;
+                }
+            }
+            if (grupo[p] != mejor) {
+                grupo[p] = mejor;
+                cambios++;
+            }
+        }
+        if (cambios == 0) break;
+    }
+
+    // Compactar los grupos que quedaron vacíos y armar el código final de cada uno
+    int nuevo[HUF_CONTEXTOS_MAX];
+    for (int g = 0; g < k; g++) nuevo[g] = -1;
+    modelo->n_contextos = 0;
+    for (int i = 0; i < n_activos; i++) {
+        int g = grupo[orden[i]];
+        if (nuevo[g] < 0) nuevo[g] = modelo->n_contextos++;
+    }
+    memset(suma, 0, sizeof(suma));
+    memset(modelo->mapa, 0, sizeof(modelo->mapa));
+    for (int i = 0; i < n_activos; i++) {
+        int p = orden[i];
+        int g = nuevo[grupo[p]];
+        modelo->mapa[p] = (unsigned char)g;
+        for (int c = 0; c < TAM_MAX; c++) suma[g][c] += frecuencias1[(size_t)p * TAM_MAX + c];
+    }
+    for (int g = 0; g < modelo->n_contextos; g++) {
+        if (generar_codigos_canonicos(suma[g], limite, modelo->longitudes[g], &modelo->tablas[g], NULL) != 0) return -1;
+    }
+
+    if (bits) *bits = contar_bits_contexto(frecuencias1, modelo);
+    return 0;
+}
+
+/**
+ * Escribe el modelo en forma compacta: cantidad de contextos, el mapa de contextos en nibbles
+ * (dos bytes anteriores por byte) y las longitudes de cada contexto como en escribir_longitudes.
+ * Devuelve los bytes escritos (como máximo HUF_CABECERA_CONTEXTO_MAX).
+ */
+size_t escribir_modelo_contexto(const struct ModeloContexto* modelo, uint8_t* buffer) {
+    size_t n = 0;
+    buffer[n++] = (uint8_t)modelo->n_contextos;
+    for (int p = 0; p < TAM_MAX; p += 2) {
+        buffer[n++] = (uint8_t)((modelo->mapa[p] << 4) | modelo->mapa[p + 1]);
+    }
+    for (int g = 0; g < modelo->n_contextos; g++) {
+        n += escribir_longitudes(modelo->longitudes[g], buffer + n);
+    }
+    return n;
+}
+
+/**
+ * Lee un modelo escrito por escribir_modelo_contexto y reconstruye el código de cada contexto.
+ * Devuelve los bytes consumidos o -1 si la cabecera es inválida.
+ */
+int leer_modelo_contexto(const uint8_t* buffer, size_t n, struct ModeloContexto* modelo) {
+    if (n < 1 + TAM_MAX / 2) return -1;
+    modelo->n_contextos = buffer[0];
+    if (modelo->n_contextos < 1 || modelo->n_contextos > HUF_CONTEXTOS_MAX) return -1;
+
+    size_t pos = 1;
+    for (int p = 0; p < TAM_MAX; p += 2) {
+        modelo->mapa[p] = buffer[pos] >> 4;
+        modelo->mapa[p + 1] = buffer[pos] & 0x0F;
+        pos++;
+        if (modelo->mapa[p] >= modelo->n_contextos || modelo->mapa[p + 1] >= modelo->n_contextos) return -1;
+    }
+    for (int g = 0; g < modelo->n_contextos; g++) {
+        int leidos = leer_longitudes(buffer + pos, n - pos, modelo->longitudes[g]);
+        if (leidos < 0) return -1;
+        pos += (size_t)leidos;
+        if (asignar_codigos_canonicos(modelo->longitudes[g], &modelo->tablas[g]) != 0) return -1;
+    }
+    return (int)pos;
+}
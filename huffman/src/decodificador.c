@@ -0,0 +1,900 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/decodificador.h"
+
+// Lector de bits MSB primero: 'bits' guarda 'disponibles' bits alineados a la izquierda
+struct LectorBits {
+    uint64_t bits;
+    int disponibles;
+    const uint8_t* p;
+    const uint8_t* fin;
+    size_t relleno;          // bytes en cero agregados después del final del buffer
+};
+
+static inline uint64_t leer_be64(const uint8_t* p) {
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) |
+           ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+           ((uint64_t)p[6] << 8)  |  (uint64_t)p[7];
+}
+
+// Deja al menos 56 bits disponibles; pasado el final se rellena con ceros
+static inline void recargar(struct LectorBits* r) {
+    if (r->fin - r->p >= 8) {
+        r->bits |= leer_be64(r->p) >> r->disponibles;
+        int consumir = (63 - r->disponibles) >> 3;
+        r->p += consumir;
+        r->disponibles += consumir << 3;
+        return;
+    }
+    while (r->disponibles <= 56) {
+        uint64_t byte = 0;
+        if (r->p < r->fin) byte = *r->p++;
+        else r->relleno++;
+        r->bits |= byte << (56 - r->disponibles);
+        r->disponibles += 8;
+    }
+}
+
+/**
+ * Construye la tabla de búsqueda de K bits a partir de una tabla de códigos prefijos.
+ * Los códigos de hasta K bits se resuelven con una búsqueda; los más largos quedan
+ * ordenados por (longitud, código) para el camino lento.
+ */
+int construir_tabla_decodificacion(const struct TablaCodigos* codigos, struct TablaDecodificacion* tabla) {
+    int longitud_max = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (codigos->longitud[c] > longitud_max) longitud_max = codigos->longitud[c];
+    }
+    if (longitud_max > HUF_BITS_MAX) {
+        printf("Error: código de %d bits excede el máximo (%d)\n", longitud_max, HUF_BITS_MAX);
+        return -1;
+    }
+
+    int k = (longitud_max <= HUF_BITS_TABLA_MAX) ? longitud_max : HUF_BITS_TABLA;
+    tabla->bits_tabla = k;
+    tabla->longitud_max = longitud_max;
+    tabla->n_largos = 0;
+    memset(tabla->entrada, 0, ((size_t)1 << k) * sizeof(tabla->entrada[0]));
+
+    for (int c = 0; c < TAM_MAX; c++) {
+        int longitud = codigos->longitud[c];
+        if (longitud == 0) continue;
+        uint64_t codigo = codigos->codigo[c];
+
+        if (longitud <= k) {
+            size_t base = (size_t)codigo << (k - longitud);
+            size_t repeticiones = (size_t)1 << (k - longitud);
+            uint16_t valor = (uint16_t)((longitud << 8) | c);
+            for (size_t j = 0; j < repeticiones; j++) {
+                tabla->entrada[base + j] = valor;
+            }
+        } else {
+            // Inserción ordenada por (longitud, código)
+            int i = tabla->n_largos++;
+            while (i > 0) {
+                int previa = codigos->longitud[tabla->simbolo_largo[i - 1]];
+                if (previa < longitud || (previa == longitud && tabla->codigo_largo[i - 1] < codigo)) break;
+                tabla->codigo_largo[i] = tabla->codigo_largo[i - 1];
+                tabla->simbolo_largo[i] = tabla->simbolo_largo[i - 1];
+                i--;
+            }
+            tabla->codigo_largo[i] = codigo;
+            tabla->simbolo_largo[i] = (unsigned char)c;
+        }
+    }
+
+    // inicio_longitud[L] = primer código largo con longitud >= L
+    int indice = 0;
+    for (int longitud = 0; longitud <= HUF_BITS_MAX + 1; longitud++) {
+        while (indice < tabla->n_largos && codigos->longitud[tabla->simbolo_largo[indice]] < longitud) {
+            indice++;
+        }
+        tabla->inicio_longitud[longitud] = indice;
+    }
+    return 0;
+}
+
+// Camino lento: busca un código más largo que la tabla probando cada longitud
+static int decodificar_largo(const struct TablaDecodificacion* tabla, struct LectorBits* r, unsigned char* simbolo) {
+    for (int longitud = tabla->bits_tabla + 1; longitud <= tabla->longitud_max; longitud++) {
+        uint64_t valor = r->bits >> (64 - longitud);
+        int bajo = tabla->inicio_longitud[longitud];
+        int alto = tabla->inicio_longitud[longitud + 1] - 1;
+        while (bajo <= alto) {
+            int medio = (bajo + alto) / 2;
+            if (tabla->codigo_largo[medio] == valor) {
+                *simbolo = tabla->simbolo_largo[medio];
+                r->bits <<= longitud;
+                r->disponibles -= longitud;
+                return 0;
+            }
+            if (tabla->codigo_largo[medio] < valor) bajo = medio + 1;
+            else alto = medio - 1;
+        }
+    }
+    return -1;
+}
+
+static int decodificar_lector(const struct TablaDecodificacion* tabla, struct LectorBits* lector,
+                              unsigned char* salida, size_t n_salida);
+
+/**
+ * Arma la tabla de búsqueda de cada contexto del modelo y el índice por byte anterior.
+ */
+int construir_tablas_contexto(const struct ModeloContexto* modelo, struct TablasContexto* tablas) {
+    tablas->longitud_max = 0;
+    for (int g = 0; g < modelo->n_contextos; g++) {
+        struct TablaDecodificacion* t = &tablas->tablas[g];
+        if (construir_tabla_decodificacion(&modelo->tablas[g], t) != 0) return -1;
+        if (t->longitud_max == 0) {
+            printf("Error: contexto %d sin códigos\n", g);
+            return -1;
+        }
+        if (t->longitud_max > tablas->longitud_max) tablas->longitud_max = t->longitud_max;
+    }
+    for (int p = 0; p < TAM_MAX; p++) {
+        const struct TablaDecodificacion* t = &tablas->tablas[modelo->mapa[p]];
+        tablas->tabla_de[p] = t;
+        tablas->entrada_de[p] = t->entrada;
+        tablas->desplazamiento_de[p] = (unsigned char)(64 - t->bits_tabla);
+    }
+    return 0;
+}
+
+// Igual que decodificar_lector, pero cada símbolo se busca en la tabla del contexto de su byte
+// anterior (*previo_io, que queda en el último byte decodificado)
+static int decodificar_lector_contexto(const struct TablasContexto* tablas, struct LectorBits* lector,
+                                       unsigned char* previo_io, unsigned char* salida, size_t n_salida) {
+    struct LectorBits r = *lector;
+    unsigned int previo = *previo_io;
+    size_t i = 0;
+
+    // Con 56 bits disponibles caben 3 códigos de tabla (<= 15 bits cada uno)
+    while (i + 3 <= n_salida) {
+        recargar(&r);
+        uint16_t e = tablas->entrada_de[previo][r.bits >> tablas->desplazamiento_de[previo]];
+        if (e == 0) goto largo;
+        previo = salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+
+        e = tablas->entrada_de[previo][r.bits >> tablas->desplazamiento_de[previo]];
+        if (e == 0) continue;
+        previo = salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+
+        e = tablas->entrada_de[previo][r.bits >> tablas->desplazamiento_de[previo]];
+        if (e == 0) continue;
+        previo = salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+        continue;
+
+    largo:
+        if (decodificar_largo(tablas->tabla_de[previo], &r, &salida[i]) != 0) {
+            printf("Error: código inválido en texto comprimido\n");
+            return -1;
+        }
+        previo = salida[i++];
+    }
+
+    while (i < n_salida) {
+        recargar(&r);
+        uint16_t e = tablas->entrada_de[previo][r.bits >> tablas->desplazamiento_de[previo]];
+        if (e) {
+            salida[i] = (unsigned char)e;
+            r.bits <<= e >> 8;
+            r.disponibles -= e >> 8;
+        } else if (decodificar_largo(tablas->tabla_de[previo], &r, &salida[i]) != 0) {
+            printf("Error: código inválido en texto comprimido\n");
+            return -1;
+        }
+        previo = salida[i++];
+    }
+
+    *lector = r;
+    *previo_io = (unsigned char)previo;
+    return 0;
+}
+
+/**
+ * Decodifica exactamente n_salida símbolos leyendo los bits empaquetados directamente.
+ * Verifica que se consuman exactamente n_bits.
+ */
+int decodificar_bits(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                     uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    return decodificar_bits_desde(tabla, datos, n_bytes, 0, n_bits, salida, n_salida);
+}
+
+/**
+ * Igual que decodificar_bits, pero empieza en el bit 'bit_inicio' de datos (un punto de
+ * sincronía): permite decodificar un tramo de un flujo sin leer lo anterior.
+ */
+int decodificar_bits_desde(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                           uint64_t bit_inicio, uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    if (n_salida > 0 && tabla->longitud_max == 0) {
+        printf("Error: tabla de decodificación vacía\n");
+        return -1;
+    }
+    if (bit_inicio / 8 > n_bytes) {
+        printf("Error: punto de sincronía fuera del payload\n");
+        return -1;
+    }
+
+    const uint8_t* inicio = datos + bit_inicio / 8;
+    int salto = (int)(bit_inicio % 8);
+    struct LectorBits r = {0, 0, inicio, datos + n_bytes, 0};
+    if (salto) {
+        recargar(&r);
+        r.bits <<= salto;
+        r.disponibles -= salto;
+    }
+    if (decodificar_lector(tabla, &r, salida, n_salida) != 0) return -1;
+
+    uint64_t consumidos = (uint64_t)(r.p - inicio + r.relleno) * 8 - (uint64_t)r.disponibles - (uint64_t)salto;
+    if (consumidos != n_bits) {
+        printf("Error: bits consumidos (%llu) no coinciden con los esperados (%llu)\n",
+               (unsigned long long)consumidos, (unsigned long long)n_bits);
+        return -1;
+    }
+    return 0;
+}
+
+// Decodifica exactamente n_salida símbolos de un flujo único desde el estado actual del lector
+static int decodificar_lector(const struct TablaDecodificacion* tabla, struct LectorBits* lector,
+                              unsigned char* salida, size_t n_salida) {
+    struct LectorBits r = *lector;
+    const uint16_t* entrada = tabla->entrada;
+    int desplazamiento = 64 - tabla->bits_tabla;
+    size_t i = 0;
+
+    // Ciclo principal sin chequeo de fin por símbolo: con 56 bits disponibles
+    // caben 3 códigos de la tabla (<= 15 bits cada uno)
+    while (i + 3 <= n_salida) {
+        recargar(&r);
+        uint16_t e = entrada[r.bits >> desplazamiento];
+        if (e == 0) goto largo;
+        salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+
+        e = entrada[r.bits >> desplazamiento];
+        if (e == 0) continue;
+        salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+
+        e = entrada[r.bits >> desplazamiento];
+        if (e == 0) continue;
+        salida[i++] = (unsigned char)e;
+        r.bits <<= e >> 8;
+        r.disponibles -= e >> 8;
+        continue;
+
+    largo:
+        // Camino lento: justo después de recargar hay bits suficientes para un código largo
+        if (decodificar_largo(tabla, &r, &salida[i]) != 0) {
+            printf("Error: código inválido en texto comprimido\n");
+            return -1;
+        }
+        i++;
+    }
+
+    // Últimos símbolos, de a uno
+    while (i < n_salida) {
+        recargar(&r);
+        uint16_t e = entrada[r.bits >> desplazamiento];
+        if (e) {
+            salida[i] = (unsigned char)e;
+            r.bits <<= e >> 8;
+            r.disponibles -= e >> 8;
+        } else if (decodificar_largo(tabla, &r, &salida[i]) != 0) {
+            printf("Error: código inválido en texto comprimido\n");
+            return -1;
+        }
+        i++;
+    }
+
+    *lector = r;
+    return 0;
+}
+
+// Decodifica un símbolo; tras el camino lento se recarga para que sigan alcanzando los bits
+static inline int decodificar_simbolo(const struct TablaDecodificacion* tabla, struct LectorBits* r,
+                                      int desplazamiento, unsigned char* destino) {
+    uint16_t e = tabla->entrada[r->bits >> desplazamiento];
+    if (e) {
+        *destino = (unsigned char)e;
+        r->bits <<= e >> 8;
+        r->disponibles -= e >> 8;
+        return 0;
+    }
+    recargar(r);
+    if (decodificar_largo(tabla, r, destino) != 0) return -1;
+    recargar(r);
+    return 0;
+}
+
+// Decodificación intercalada genérica: en cada ronda avanza un símbolo por flujo
+static int decodificar_rondas(const struct TablaDecodificacion* tabla, struct LectorBits* lectores,
+                              int n_flujos, unsigned char* salida, size_t desde, size_t n_salida) {
+    int desplazamiento = 64 - tabla->bits_tabla;
+    for (size_t i = desde; i < n_salida; i++) {
+        struct LectorBits* r = &lectores[i % (size_t)n_flujos];
+        recargar(r);
+        if (decodificar_simbolo(tabla, r, desplazamiento, &salida[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+// Un símbolo del camino rápido sobre copias locales del lector; si el código es largo se
+// abandona el bloque y se rehace con el camino genérico
+#define PASO_RAPIDO(bits, disponibles, destino)                 \
+    do {                                                        \
+        unsigned int e_ = entrada[(bits) >> desplazamiento];    \
+        if (e_ == 0) goto bloque_lento;                         \
+        (destino) = (unsigned char)e_;                          \
+        (bits) <<= e_ >> 8;                                     \
+        (disponibles) -= (int)(e_ >> 8);                        \
+    } while (0)
+
+// Cuatro flujos en paralelo: los lectores se copian a variables locales para que las cuatro
+// cadenas de dependencia queden en registros y el procesador las solape. Decodifica bloques
+// de 3 rondas (12 símbolos) por recarga y devuelve los símbolos completados.
+static size_t decodificar_cuatro_flujos(const struct TablaDecodificacion* tabla, struct LectorBits* l,
+                                        unsigned char* salida, size_t n_salida) {
+    const uint16_t* entrada = tabla->entrada;
+    int desplazamiento = 64 - tabla->bits_tabla;
+    size_t i = 0;
+
+    for (; i + 12 <= n_salida; i += 12) {
+        recargar(&l[0]);
+        recargar(&l[1]);
+        recargar(&l[2]);
+        recargar(&l[3]);
+        uint64_t b0 = l[0].bits, b1 = l[1].bits, b2 = l[2].bits, b3 = l[3].bits;
+        int d0 = l[0].disponibles, d1 = l[1].disponibles, d2 = l[2].disponibles, d3 = l[3].disponibles;
+        unsigned char* o = salida + i;
+
+        for (int j = 0; j < 12; j += 4) {
+            PASO_RAPIDO(b0, d0, o[j]);
+            PASO_RAPIDO(b1, d1, o[j + 1]);
+            PASO_RAPIDO(b2, d2, o[j + 2]);
+            PASO_RAPIDO(b3, d3, o[j + 3]);
+        }
+
+        l[0].bits = b0; l[1].bits = b1; l[2].bits = b2; l[3].bits = b3;
+        l[0].disponibles = d0; l[1].disponibles = d1; l[2].disponibles = d2; l[3].disponibles = d3;
+        continue;
+
+    bloque_lento:
+        // Los lectores quedaron como tras la recarga: rehacer el bloque símbolo a símbolo
+        if (decodificar_rondas(tabla, l, 4, salida, i, i + 12) != 0) return (size_t)-1;
+    }
+    return i;
+}
+
+#undef PASO_RAPIDO
+
+/**
+ * Decodifica un payload de sub-flujos intercalados escrito por codificar_flujos.
+ * Valida la tabla de saltos contra n_bytes y n_bits y que cada flujo se consuma exactamente.
+ */
+int decodificar_flujos(const struct TablaDecodificacion* tabla, const uint8_t* datos, size_t n_bytes,
+                       uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    int n_flujos = (n_bytes >= 1) ? datos[0] : 0;
+    if (n_flujos < 1 || n_flujos > HUF_FLUJOS_MAX || n_bytes < HUF_TABLA_SALTOS(n_flujos)) {
+        printf("Error: tabla de saltos inválida\n");
+        return -1;
+    }
+    if (n_salida > 0 && tabla->longitud_max == 0) {
+        printf("Error: tabla de decodificación vacía\n");
+        return -1;
+    }
+
+    struct LectorBits lectores[HUF_FLUJOS_MAX];
+    uint64_t bits[HUF_FLUJOS_MAX];
+    uint64_t total_bits = 0;
+    size_t pos = HUF_TABLA_SALTOS(n_flujos);
+    for (int f = 0; f < n_flujos; f++) {
+        bits[f] = 0;
+        for (int b = 0; b < 8; b++) bits[f] |= (uint64_t)datos[1 + 8 * f + b] << (8 * b);
+
+        uint64_t bytes = (bits[f] + 7) / 8;
+        if (bits[f] > (uint64_t)(n_bytes - pos) * 8) {
+            printf("Error: tabla de saltos excede el payload\n");
+            return -1;
+        }
+        lectores[f] = (struct LectorBits){0, 0, datos + pos, datos + pos + bytes, 0};
+        pos += (size_t)bytes;
+        total_bits += bits[f];
+    }
+    if (pos != n_bytes || total_bits != n_bits) {
+        printf("Error: tabla de saltos no coincide con el payload\n");
+        return -1;
+    }
+
+    size_t hechos = 0;
+    if (n_flujos == 4) hechos = decodificar_cuatro_flujos(tabla, lectores, salida, n_salida);
+    if (hechos == (size_t)-1 || decodificar_rondas(tabla, lectores, n_flujos, salida, hechos, n_salida) != 0) {
+        printf("Error: código inválido en texto comprimido\n");
+        return -1;
+    }
+
+    for (int f = 0; f < n_flujos; f++) {
+        const struct LectorBits* r = &lectores[f];
+        const uint8_t* inicio = r->fin - (bits[f] + 7) / 8;
+        uint64_t consumidos = (uint64_t)(r->p - inicio + r->relleno) * 8 - (uint64_t)r->disponibles;
+        if (consumidos != bits[f]) {
+            printf("Error: el flujo %d consumió %llu bits en lugar de %llu\n", f,
+                   (unsigned long long)consumidos, (unsigned long long)bits[f]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Firma común de decodificar_bits y decodificar_flujos
+typedef int (*funcion_decodificar)(const struct TablaDecodificacion*, const uint8_t*, size_t,
+                                   uint64_t, unsigned char*, size_t);
+
+// Arma la tabla de búsqueda para los códigos dados y decodifica en un buffer del llamador
+static int decodificar_con_codigos_en(const struct TablaCodigos* codigos, funcion_decodificar decodificar,
+                                      const uint8_t* datos, size_t n_bytes, uint64_t n_bits,
+                                      unsigned char* salida, size_t n_salida) {
+    if (n_salida == 0) return 0;
+
+    struct TablaDecodificacion tabla;
+    if (construir_tabla_decodificacion(codigos, &tabla) != 0) return -1;
+    return decodificar(&tabla, datos, n_bytes, n_bits, salida, n_salida);
+}
+
+// Reserva la salida, arma la tabla de búsqueda para los códigos dados y decodifica
+static unsigned char* decodificar_con_codigos(const struct TablaCodigos* codigos, funcion_decodificar decodificar,
+                                              const uint8_t* datos, size_t n_bytes, uint64_t n_bits,
+                                              size_t n_salida) {
+    unsigned char* salida = (unsigned char*)malloc(n_salida + 1);
+    if (!salida) {
+        printf("Error de memoria para texto original (tamaño: %zu)\n", n_salida);
+        return NULL;
+    }
+    salida[n_salida] = '\0';
+    if (decodificar_con_codigos_en(codigos, decodificar, datos, n_bytes, n_bits, salida, n_salida) != 0) {
+        free(salida);
+        return NULL;
+    }
+    return salida;
+}
+
+/**
+ * Descomprime un payload empaquetado usando el árbol de Huffman de la arena: genera la tabla
+ * de códigos, la tabla de búsqueda y decodifica. Devuelve un buffer de n_salida bytes terminado en '\0'.
+ */
+unsigned char* descomprimir_empaquetado(const struct ArenaNodos* arena, int raiz, const uint8_t* datos,
+                                        size_t n_bytes, uint64_t n_bits, size_t n_salida) {
+    // Árbol de una sola hoja: el código tiene longitud 0 y el payload está vacío
+    if (raiz >= 0 && arena->nodos[raiz].izquierda == ARENA_NULO) {
+        unsigned char* salida = (unsigned char*)malloc(n_salida + 1);
+        if (!salida) return NULL;
+        memset(salida, arena->nodos[raiz].caracter, n_salida);
+        salida[n_salida] = '\0';
+        return salida;
+    }
+
+    struct TablaCodigos codigos;
+    if (generar_tabla_codigos(arena, raiz, &codigos) != 0) return NULL;
+    return decodificar_con_codigos(&codigos, decodificar_bits, datos, n_bytes, n_bits, n_salida);
+}
+
+/**
+ * Descomprime un payload con códigos canónicos reconstruidos solo desde las longitudes,
+ * sin construir ningún árbol.
+ */
+unsigned char* descomprimir_canonico(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                     uint64_t n_bits, size_t n_salida) {
+    struct TablaCodigos codigos;
+    if (asignar_codigos_canonicos(longitudes, &codigos) != 0) return NULL;
+    return decodificar_con_codigos(&codigos, decodificar_bits, datos, n_bytes, n_bits, n_salida);
+}
+
+/**
+ * Igual que descomprimir_canonico, para un payload de sub-flujos intercalados (codificar_flujos).
+ */
+unsigned char* descomprimir_canonico_flujos(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                            uint64_t n_bits, size_t n_salida) {
+    struct TablaCodigos codigos;
+    if (asignar_codigos_canonicos(longitudes, &codigos) != 0) return NULL;
+    return decodificar_con_codigos(&codigos, decodificar_flujos, datos, n_bytes, n_bits, n_salida);
+}
+
+/**
+ * Variantes de descomprimir_canonico y descomprimir_canonico_flujos que escriben exactamente
+ * n_salida bytes en un buffer del llamador (por ejemplo, un bloque dentro de la salida completa).
+ */
+int descomprimir_canonico_en(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    struct TablaCodigos codigos;
+    if (asignar_codigos_canonicos(longitudes, &codigos) != 0) return -1;
+    return decodificar_con_codigos_en(&codigos, decodificar_bits, datos, n_bytes, n_bits, salida, n_salida);
+}
+
+int descomprimir_canonico_flujos_en(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                    uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    struct TablaCodigos codigos;
+    if (asignar_codigos_canonicos(longitudes, &codigos) != 0) return -1;
+    return decodificar_con_codigos_en(&codigos, decodificar_flujos, datos, n_bytes, n_bits, salida, n_salida);
+}
+
+/**
+ * Decodifica n_salida símbolos de un payload de flujo único empezando en un punto de sincronía
+ * (bit_inicio) y consumiendo exactamente n_bits, en un buffer del llamador.
+ */
+int descomprimir_canonico_desde(const unsigned char* longitudes, const uint8_t* datos, size_t n_bytes,
+                                uint64_t bit_inicio, uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    if (n_salida == 0) return 0;
+
+    struct TablaCodigos codigos;
+    struct TablaDecodificacion tabla;
+    if (asignar_codigos_canonicos(longitudes, &codigos) != 0 ||
+        construir_tabla_decodificacion(&codigos, &tabla) != 0) {
+        return -1;
+    }
+    return decodificar_bits_desde(&tabla, datos, n_bytes, bit_inicio, n_bits, salida, n_salida);
+}
+
+/**
+ * Descomprime un payload en modo de contexto de orden 1 (codificar_contexto) en un buffer del
+ * llamador, verificando que se consuman exactamente n_bits.
+ */
+int descomprimir_contexto_en(const struct ModeloContexto* modelo, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    if (n_salida == 0) return 0;
+
+    struct TablasContexto* tablas = (struct TablasContexto*)malloc(sizeof(struct TablasContexto));
+    if (!tablas) {
+        printf("Error de memoria para tablas de contexto\n");
+        return -1;
+    }
+    int rc = -1;
+    if (construir_tablas_contexto(modelo, tablas) == 0) {
+        struct LectorBits r = {0, 0, datos, datos + n_bytes, 0};
+        unsigned char previo = 0;
+        if (decodificar_lector_contexto(tablas, &r, &previo, salida, n_salida) == 0) {
+            uint64_t consumidos = (uint64_t)(r.p - datos + r.relleno) * 8 - (uint64_t)r.disponibles;
+            if (consumidos == n_bits) rc = 0;
+            else printf("Error: bits consumidos (%llu) no coinciden con los esperados (%llu)\n",
+                        (unsigned long long)consumidos, (unsigned long long)n_bits);
+        }
+    }
+    free(tablas);
+    return rc;
+}
+
+/**
+ * Arma la tabla de búsqueda del alfabeto extendido. Cada entrada trae el símbolo, los bytes que
+ * representa y la longitud del código, así se decodifica y se copia con una sola búsqueda.
+ */
+int construir_tabla_palabras(const struct AlfabetoPalabras* alfabeto, struct TablaPalabras* tabla) {
+    int n_simbolos = TAM_MAX + alfabeto->n_palabras;
+    int k = 0;
+    for (int s = 0; s < n_simbolos; s++) {
+        if (alfabeto->longitudes[s] > k) k = alfabeto->longitudes[s];
+    }
+    if (k == 0 || k > HUF_BITS_TABLA_MAX) {
+        printf("Error: alfabeto extendido con códigos de %d bits\n", k);
+        return -1;
+    }
+
+    tabla->bits_tabla = k;
+    memset(tabla->entrada, 0, ((size_t)1 << k) * sizeof(tabla->entrada[0]));
+    for (int s = 0; s < n_simbolos; s++) {
+        int longitud = alfabeto->longitudes[s];
+        tabla->bytes[s] = alfabeto->bytes[s];
+        if (longitud == 0) continue;
+        size_t base = (size_t)alfabeto->codigo[s] << (k - longitud);
+        size_t repeticiones = (size_t)1 << (k - longitud);
+        uint32_t valor = ((uint32_t)s << 8) | ((uint32_t)alfabeto->largo[s] << 4) | (uint32_t)longitud;
+        for (size_t j = 0; j < repeticiones; j++) {
+            tabla->entrada[base + j] = valor;
+        }
+    }
+    return 0;
+}
+
+// Un símbolo del alfabeto extendido: copia siempre HUF_PALABRA_LARGO_MAX bytes y avanza los que representa
+#define PASO_PALABRA(r, o)                                          \
+    do {                                                            \
+        uint32_t e_ = entrada[(r).bits >> desplazamiento];          \
+        if (e_ == 0) goto invalido;                                 \
+        memcpy(salida + (o), &bytes[e_ >> 8], HUF_PALABRA_LARGO_MAX); \
+        (o) += (e_ >> 4) & 0x0F;                                    \
+        (r).bits <<= e_ & 0x0F;                                     \
+        (r).disponibles -= (int)(e_ & 0x0F);                        \
+    } while (0)
+
+/**
+ * Descomprime un payload del alfabeto extendido (codificar_palabras) en exactamente n_salida
+ * bytes de un buffer del llamador, verificando que se consuman exactamente n_bits.
+ */
+int descomprimir_palabras_en(const struct AlfabetoPalabras* alfabeto, const uint8_t* datos, size_t n_bytes,
+                             uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    if (n_salida == 0) return 0;
+
+    struct TablaPalabras* tabla = (struct TablaPalabras*)malloc(sizeof(struct TablaPalabras));
+    if (!tabla) {
+        printf("Error de memoria para tabla de palabras\n");
+        return -1;
+    }
+    if (construir_tabla_palabras(alfabeto, tabla) != 0) {
+        free(tabla);
+        return -1;
+    }
+
+    const uint32_t* entrada = tabla->entrada;
+    const uint64_t* bytes = tabla->bytes;
+    int desplazamiento = 64 - tabla->bits_tabla;
+    struct LectorBits r = {0, 0, datos, datos + n_bytes, 0};
+    size_t o = 0;
+
+    // Ciclo principal: 3 códigos por recarga y margen para copiar 8 bytes por símbolo
+    while (o + 3 * HUF_PALABRA_LARGO_MAX <= n_salida) {
+        recargar(&r);
+        PASO_PALABRA(r, o);
+        PASO_PALABRA(r, o);
+        PASO_PALABRA(r, o);
+    }
+
+    // Últimos símbolos: se copian solo los bytes que representan, sin pasar de n_salida
+    while (o < n_salida) {
+        recargar(&r);
+        uint32_t e = entrada[r.bits >> desplazamiento];
+        size_t largo = (e >> 4) & 0x0F;
+        if (e == 0 || largo > n_salida - o) goto invalido;
+        memcpy(salida + o, &bytes[e >> 8], largo);
+        o += largo;
+        r.bits <<= e & 0x0F;
+        r.disponibles -= (int)(e & 0x0F);
+    }
+    free(tabla);
+
+    uint64_t consumidos = (uint64_t)(r.p - datos + r.relleno) * 8 - (uint64_t)r.disponibles;
+    if (consumidos != n_bits) {
+        printf("Error: bits consumidos (%llu) no coinciden con los esperados (%llu)\n",
+               (unsigned long long)consumidos, (unsigned long long)n_bits);
+        return -1;
+    }
+    return 0;
+
+invalido:
+    printf("Error: código inválido en texto comprimido\n");
+    free(tabla);
+    return -1;
+}
+
+#undef PASO_PALABRA
+
+// Llena la tabla de un alfabeto de LZ77 indexada por los k bits más altos (k = longitud máxima)
+static int llenar_tabla_lz(const unsigned char* longitudes, const uint64_t* codigos, int n_simbolos,
+                           uint16_t* entrada, int* bits_tabla) {
+    int k = 0;
+    for (int s = 0; s < n_simbolos; s++) {
+        if (longitudes[s] > k) k = longitudes[s];
+    }
+    if (k > LZ_BITS_CODIGO) {
+        printf("Error: alfabeto LZ77 con códigos de %d bits\n", k);
+        return -1;
+    }
+    // Sin símbolos (por ejemplo, sin coincidencias): una tabla de un bit toda inválida
+    if (k == 0) k = 1;
+
+    *bits_tabla = k;
+    memset(entrada, 0, ((size_t)1 << k) * sizeof(entrada[0]));
+    for (int s = 0; s < n_simbolos; s++) {
+        int longitud = longitudes[s];
+        if (longitud == 0) continue;
+        size_t base = (size_t)codigos[s] << (k - longitud);
+        size_t repeticiones = (size_t)1 << (k - longitud);
+        for (size_t j = 0; j < repeticiones; j++) {
+            entrada[base + j] = (uint16_t)((s << 4) | longitud);
+        }
+    }
+    return 0;
+}
+
+int construir_tabla_lz(const struct ModeloLZ* modelo, struct TablaLZ* tabla) {
+    if (llenar_tabla_lz(modelo->longitudes_literal, modelo->codigo_literal, LZ_SIMBOLOS_LITERAL,
+                        tabla->literal, &tabla->bits_literal) != 0) return -1;
+    return llenar_tabla_lz(modelo->longitudes_distancia, modelo->codigo_distancia, LZ_CODIGOS_DISTANCIA,
+                           tabla->distancia, &tabla->bits_distancia);
+}
+
+// Toma los bits extra de un valor de LZ77 (a lo sumo 19, siempre hay al menos 57 cargados)
+static inline uint32_t leer_extra(struct LectorBits* r, int extra) {
+    if (extra == 0) return 0;
+    uint32_t v = (uint32_t)(r->bits >> (64 - extra));
+    r->bits <<= extra;
+    r->disponibles -= extra;
+    return v;
+}
+
+/**
+ * Descomprime un payload de comprimir_lz77 en exactamente n_salida bytes de un buffer del llamador.
+ * Cada token es un literal o un largo seguido de una distancia; las coincidencias se copian desde la
+ * salida ya escrita, de a 8 bytes si no se solapan y queda margen. Se verifica que cada distancia
+ * caiga dentro de la salida y que se consuman exactamente n_bits.
+ */
+int descomprimir_lz77_en(const struct ModeloLZ* modelo, const uint8_t* datos, size_t n_bytes,
+                         uint64_t n_bits, unsigned char* salida, size_t n_salida) {
+    if (n_salida == 0) return 0;
+
+    struct TablaLZ* tabla = (struct TablaLZ*)malloc(sizeof(struct TablaLZ));
+    if (!tabla) {
+        printf("Error de memoria para tablas LZ77\n");
+        return -1;
+    }
+    if (construir_tabla_lz(modelo, tabla) != 0) {
+        free(tabla);
+        return -1;
+    }
+
+    int desplazamiento_literal = 64 - tabla->bits_literal;
+    int desplazamiento_distancia = 64 - tabla->bits_distancia;
+    struct LectorBits r = {0, 0, datos, datos + n_bytes, 0};
+    size_t o = 0;
+    while (o < n_salida) {
+        recargar(&r);
+        uint32_t e = tabla->literal[r.bits >> desplazamiento_literal];
+        if (e == 0) goto invalido;
+        r.bits <<= e & 0x0F;
+        r.disponibles -= (int)(e & 0x0F);
+        uint32_t s = e >> 4;
+        if (s < TAM_MAX) {
+            salida[o++] = (unsigned char)s;
+            continue;
+        }
+
+        int extra;
+        uint32_t largo = base_valor_lz((int)s - TAM_MAX, &extra);
+        largo += leer_extra(&r, extra) + LZ_LARGO_MIN;
+        recargar(&r);
+        e = tabla->distancia[r.bits >> desplazamiento_distancia];
+        if (e == 0) goto invalido;
+        r.bits <<= e & 0x0F;
+        r.disponibles -= (int)(e & 0x0F);
+        size_t distancia = base_valor_lz((int)(e >> 4), &extra);
+        distancia += leer_extra(&r, extra) + 1;
+        if (distancia > o || largo > n_salida - o) goto invalido;
+
+        unsigned char* destino = salida + o;
+        const unsigned char* origen = destino - distancia;
+        if (distancia >= 8 && largo + 8 <= n_salida - o) {
+            for (size_t j = 0; j < largo; j += 8) memcpy(destino + j, origen + j, 8);
+        } else {
+            for (size_t j = 0; j < largo; j++) destino[j] = origen[j];
+        }
+        o += largo;
+    }
+    free(tabla);
+
+    uint64_t consumidos = (uint64_t)(r.p - datos + r.relleno) * 8 - (uint64_t)r.disponibles;
+    if (consumidos != n_bits) {
+        printf("Error: bits consumidos (%llu) no coinciden con los esperados (%llu)\n",
+               (unsigned long long)consumidos, (unsigned long long)n_bits);
+        return -1;
+    }
+    return 0;
+
+invalido:
+    printf("Error: código inválido en texto comprimido\n");
+    free(tabla);
+    return -1;
+}
+
+// Mueve lo que queda sin leer al principio del buffer y lo completa desde la fuente
+static void rellenar(struct DecodificadorFlujo* d) {
+    size_t quedan = d->lleno - d->pos;
+    memmove(d->buffer, d->buffer + d->pos, quedan);
+    d->descartados += d->pos;
+    d->pos = 0;
+    d->lleno = quedan;
+    while (!d->fin_fuente && d->lleno < HUF_BUFFER_FLUJO) {
+        size_t leidos = d->leer(d->contexto, d->buffer + d->lleno, HUF_BUFFER_FLUJO - d->lleno);
+        if (leidos == 0) d->fin_fuente = 1;
+        d->lleno += leidos;
+    }
+}
+
+/**
+ * Prepara un decodificador incremental de flujo único que toma el payload de 'leer' de a
+ * HUF_BUFFER_FLUJO bytes. 'salto' descarta los primeros bits del primer byte (punto de sincronía).
+ */
+int decodificador_iniciar(struct DecodificadorFlujo* d, const struct TablaDecodificacion* tabla,
+                          funcion_leer leer, void* contexto, int salto) {
+    d->tabla = tabla;
+    d->leer = leer;
+    d->contexto = contexto;
+    d->bits = 0;
+    d->disponibles = 0;
+    d->relleno = 0;
+    d->pos = 0;
+    d->lleno = 0;
+    d->descartados = 0;
+    d->fin_fuente = 0;
+    d->salto = salto;
+    d->tablas_contexto = NULL;
+    d->previo = 0;
+    rellenar(d);
+
+    if (salto) {
+        struct LectorBits r = {0, 0, d->buffer, d->buffer + d->lleno, 0};
+        recargar(&r);
+        r.bits <<= salto;
+        r.disponibles -= salto;
+        d->bits = r.bits;
+        d->disponibles = r.disponibles;
+        d->pos = (size_t)(r.p - d->buffer);
+        d->relleno = r.relleno;
+    }
+    return 0;
+}
+
+/**
+ * Pasa el decodificador al modo de contexto de orden 1 (el byte anterior al primero es 0).
+ */
+void decodificador_contexto(struct DecodificadorFlujo* d, const struct TablasContexto* tablas) {
+    d->tablas_contexto = tablas;
+    d->tabla = &tablas->tablas[0];
+    d->previo = 0;
+}
+
+/**
+ * Decodifica los próximos n símbolos en 'salida'. Trabaja por lotes que no pueden pasar del
+ * final del buffer: así los ceros de relleno solo aparecen al terminar la fuente de verdad.
+ */
+int decodificador_leer(struct DecodificadorFlujo* d, unsigned char* salida, size_t n) {
+    const struct TablaDecodificacion* tabla = d->tabla;
+    int longitud_max = d->tablas_contexto ? d->tablas_contexto->longitud_max : tabla->longitud_max;
+    if (n > 0 && longitud_max == 0) {
+        printf("Error: tabla de decodificación vacía\n");
+        return -1;
+    }
+
+    while (n > 0) {
+        if (!d->fin_fuente && d->lleno - d->pos < HUF_BUFFER_FLUJO / 2) rellenar(d);
+
+        // El lector va a lo sumo 8 bytes adelantado: con 16 de margen nunca llega al final
+        size_t lote = n;
+        if (!d->fin_fuente) {
+            size_t maximo = (d->lleno - d->pos - 16) * 8 / (size_t)longitud_max;
+            if (lote > maximo) lote = maximo;
+        }
+
+        struct LectorBits r = {d->bits, d->disponibles, d->buffer + d->pos, d->buffer + d->lleno, d->relleno};
+        int rc = d->tablas_contexto ? decodificar_lector_contexto(d->tablas_contexto, &r, &d->previo, salida, lote)
+                                    : decodificar_lector(tabla, &r, salida, lote);
+        if (rc != 0) return -1;
+        d->bits = r.bits;
+        d->disponibles = r.disponibles;
+        d->pos = (size_t)(r.p - d->buffer);
+        d->relleno = r.relleno;
+
+        salida += lote;
+        n -= lote;
+    }
+    return 0;
+}
+
+/**
+ * Verifica que el decodificador haya consumido exactamente n_bits desde su inicio.
+ */
+int decodificador_terminar(const struct DecodificadorFlujo* d, uint64_t n_bits) {
+    uint64_t consumidos = (d->descartados + d->pos + d->relleno) * 8 - (uint64_t)d->disponibles - (uint64_t)d->salto;
+    if (consumidos != n_bits) {
+        printf("Error: bits consumidos (%llu) no coinciden con los esperados (%llu)\n",
+               (unsigned long long)consumidos, (unsigned long long)n_bits);
+        return -1;
+    }
+    return 0;
+}
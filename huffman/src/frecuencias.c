@@ -4,15 +4,89 @@
 #include "../include/huffman.h"
 #include "../include/frecuencias.h"
 
+/**
+ * Suma al histograma la cantidad de apariciones de cada byte en datos[0, n).
+ * Lee de a 8 bytes y reparte los incrementos en HISTOGRAMA_TABLAS tablas intercaladas:
+ * así una racha del mismo byte no encadena escrituras y lecturas sobre un único contador.
+ * No se detiene en bytes '\0'.
+ */
+void acumular_histograma(const unsigned char* datos, size_t n, uint64_t* frecuencias) {
+    uint64_t tablas[HISTOGRAMA_TABLAS][TAM_MAX];
+    memset(tablas, 0, sizeof(tablas));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t palabra;
+        memcpy(&palabra, datos + i, sizeof(palabra));
+        tablas[0][(uint8_t)palabra]++;
+        tablas[1][(uint8_t)(palabra >> 8)]++;
+        tablas[2][(uint8_t)(palabra >> 16)]++;
+        tablas[3][(uint8_t)(palabra >> 24)]++;
+        tablas[0][(uint8_t)(palabra >> 32)]++;
+        tablas[1][(uint8_t)(palabra >> 40)]++;
+        tablas[2][(uint8_t)(palabra >> 48)]++;
+        tablas[3][(uint8_t)(palabra >> 56)]++;
+    }
+    for (; i < n; i++) {
+        tablas[0][datos[i]]++;
+    }
+
+    for (int c = 0; c < TAM_MAX; c++) {
+        frecuencias[c] += tablas[0][c] + tablas[1][c] + tablas[2][c] + tablas[3][c];
+    }
+}
+
+// log2(x) en punto fijo con LOG_FRACCION bits fraccionarios, para x >= 1 (sin libm)
+uint32_t log2_fijo(uint64_t x) {
+    int e = 0;
+    while ((x >> e) > 1) e++;
+    uint64_t m = (e <= 31) ? x << (31 - e) : x >> (e - 31);   // mantisa en [2^31, 2^32)
+    uint32_t r = (uint32_t)e << LOG_FRACCION;
+    for (int b = LOG_FRACCION - 1; b >= 0; b--) {
+        m = (m * m) >> 31;
+        if (m >= (1ull << 32)) {
+            m >>= 1;
+            r |= 1u << b;
+        }
+    }
+    return r;
+}
+
+// Cota de Shannon del histograma en bits: suma de frecuencia × log2(total / frecuencia)
+uint64_t bits_entropia(const uint64_t* frecuencias) {
+    uint64_t total = 0;
+    for (int c = 0; c < TAM_MAX; c++) total += frecuencias[c];
+    if (total == 0) return 0;
+
+    uint32_t log_total = log2_fijo(total);
+    uint64_t bits = 0;
+    for (int c = 0; c < TAM_MAX; c++) {
+        if (frecuencias[c]) bits += frecuencias[c] * (log_total - log2_fijo(frecuencias[c]));
+    }
+    return (bits + (1u << LOG_FRACCION) - 1) >> LOG_FRACCION;
+}
+
+/**
+ * Suma al histograma de orden 1 (TAM_MAX x TAM_MAX, fila = byte anterior) los pares de datos[0, n).
+ * *previo es el byte anterior a datos[0] y al volver queda el último byte, para seguir por trozos.
+ */
+void acumular_histograma_orden1(const unsigned char* datos, size_t n, unsigned char* previo, uint64_t* frecuencias) {
+    unsigned char p = *previo;
+    for (size_t i = 0; i < n; i++) {
+        frecuencias[(size_t)p * TAM_MAX + datos[i]]++;
+        p = datos[i];
+    }
+    *previo = p;
+}
+
 /**
  * Cuenta la frecuencia de cada carácter en una cadena de texto.
  */
 void contar_frecuencias(const char* texto, int* frecuencias) {
+    uint64_t histograma[TAM_MAX] = {0};
+    acumular_histograma((const unsigned char*)texto, strlen(texto), histograma);
     for (int i = 0; i < TAM_MAX; i++) {
-        frecuencias[i] = 0;
-    }
-    for (int i = 0; i < strlen(texto); i++) {
-        frecuencias[(unsigned char)texto[i]]++;
+        frecuencias[i] = (int)histograma[i];
     }
 }
 
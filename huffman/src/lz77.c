@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/lz77.h"
+#include "../include/arbol.h"
+#include "../include/codigos.h"
+
+// Índice de coincidencias: cadenas hash de LZ_LARGO_MIN bytes
+#define LZ_HASH_BITS 16
+
+// Parámetros de búsqueda de cada nivel: eslabones recorridos por posición, si se posterga una
+// coincidencia para probar la siguiente posición (perezoso) y el largo a partir del cual se deja
+// de buscar
+struct NivelLZ {
+    int cadena;
+    int perezoso;
+    uint32_t largo_bueno;
+};
+
+static const struct NivelLZ niveles[LZ_NIVEL_MAX + 1] = {
+    {0, 0, 0},
+    {4, 0, 16},      {8, 0, 32},      {16, 0, 64},
+    {16, 1, 64},     {32, 1, 128},    {64, 1, 256},
+    {128, 1, 1024},  {512, 1, 4096},  {4096, 1, LZ_LARGO_MAX},
+};
+
+// Literal (distancia = 0, largo = byte) o coincidencia
+struct TokenLZ {
+    uint32_t largo;
+    uint32_t distancia;
+};
+
+struct BuscadorLZ {
+    const unsigned char* datos;
+    size_t n;
+    int32_t* cabeza;      // última posición de cada hash (-1 = ninguna)
+    int32_t* anterior;    // posición previa con el mismo hash, indexada por posición % ventana
+    uint32_t mascara;
+    struct NivelLZ nivel;
+};
+
+static inline uint32_t hash_lz(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline void insertar(struct BuscadorLZ* b, size_t i) {
+    if (i + LZ_LARGO_MIN > b->n) return;
+    uint32_t h = hash_lz(b->datos + i);
+    b->anterior[i & b->mascara] = b->cabeza[h];
+    b->cabeza[h] = (int32_t)i;
+}
+
+// Mejor coincidencia para la posición i (ya insertada); devuelve su largo (0 = ninguna)
+static uint32_t buscar(const struct BuscadorLZ* b, size_t i, uint32_t* distancia) {
+    if (i + LZ_LARGO_MIN > b->n) return 0;
+    const unsigned char* actual = b->datos + i;
+    size_t maximo = b->n - i;
+    if (maximo > LZ_LARGO_MAX) maximo = LZ_LARGO_MAX;
+
+    uint32_t mejor = 0;
+    int32_t candidato = b->anterior[i & b->mascara];
+    for (int eslabones = b->nivel.cadena; candidato >= 0 && eslabones > 0; eslabones--) {
+        size_t d = i - (size_t)candidato;
+        if (d > b->mascara) break;
+        const unsigned char* previo = b->datos + candidato;
+        if (previo[mejor] == actual[mejor] && memcmp(previo, actual, LZ_LARGO_MIN) == 0) {
+            size_t largo = LZ_LARGO_MIN;
+            while (largo < maximo && previo[largo] == actual[largo]) largo++;
+            if (largo > mejor) {
+                mejor = (uint32_t)largo;
+                *distancia = (uint32_t)d;
+                if (mejor >= b->nivel.largo_bueno || largo == maximo) break;
+            }
+        }
+        int32_t siguiente = b->anterior[candidato & b->mascara];
+        if (siguiente >= candidato) break;   // la ranura ya se reusó para una posición más nueva
+        candidato = siguiente;
+    }
+    return mejor;
+}
+
+// Inserta en el índice todas las posiciones hasta 'hasta' inclusive
+static inline void insertar_hasta(struct BuscadorLZ* b, size_t* insertadas, size_t hasta) {
+    while (*insertadas <= hasta) insertar(b, (*insertadas)++);
+}
+
+static inline void agregar_token(struct TokenLZ* tokens, size_t* t, uint32_t largo, uint32_t distancia) {
+    tokens[*t].largo = largo;
+    tokens[*t].distancia = distancia;
+    (*t)++;
+}
+
+// Parte la entrada en tokens (greedy, o perezoso según el nivel); devuelve cuántos generó o -1
+static long long tokenizar(const unsigned char* datos, size_t n, int nivel, int ventana, struct TokenLZ* tokens) {
+    struct BuscadorLZ b = {datos, n, NULL, NULL, (1u << ventana) - 1, niveles[nivel]};
+    b.cabeza = (int32_t*)malloc(sizeof(int32_t) << LZ_HASH_BITS);
+    b.anterior = (int32_t*)malloc(sizeof(int32_t) << ventana);
+    if (!b.cabeza || !b.anterior) {
+        free(b.cabeza);
+        free(b.anterior);
+        return -1;
+    }
+    memset(b.cabeza, 0xFF, sizeof(int32_t) << LZ_HASH_BITS);
+
+    size_t t = 0, insertadas = 0;
+    for (size_t i = 0; i < n;) {
+        uint32_t distancia = 0;
+        insertar_hasta(&b, &insertadas, i);
+        uint32_t largo = buscar(&b, i, &distancia);
+
+        // Perezoso: si la posición siguiente tiene una coincidencia más larga, esta queda como literal
+        if (largo >= LZ_LARGO_MIN && b.nivel.perezoso && largo < b.nivel.largo_bueno && i + 1 < n) {
+            uint32_t distancia2 = 0;
+            insertar_hasta(&b, &insertadas, i + 1);
+            uint32_t largo2 = buscar(&b, i + 1, &distancia2);
+            if (largo2 > largo) {
+                agregar_token(tokens, &t, datos[i], 0);
+                i++;
+                largo = largo2;
+                distancia = distancia2;
+            }
+        }
+
+        if (largo >= LZ_LARGO_MIN) {
+            agregar_token(tokens, &t, largo, distancia);
+            i += largo;
+        } else {
+            agregar_token(tokens, &t, datos[i], 0);
+            i++;
+        }
+    }
+    free(b.cabeza);
+    free(b.anterior);
+    return (long long)t;
+}
+
+// Escritor de bits MSB primero: el acumulador se vacía de a 32 bits, así un campo de hasta
+// 32 bits nunca lo desborda
+struct EscritorLZ {
+    uint8_t* p;
+    uint64_t acumulador;
+    int pendientes;
+};
+
+static inline void escribir_bits(struct EscritorLZ* w, uint64_t valor, int bits) {
+    w->acumulador = (w->acumulador << bits) | valor;
+    w->pendientes += bits;
+    if (w->pendientes >= 32) {
+        w->pendientes -= 32;
+        uint32_t palabra = (uint32_t)(w->acumulador >> w->pendientes);
+        w->p[0] = (uint8_t)(palabra >> 24);
+        w->p[1] = (uint8_t)(palabra >> 16);
+        w->p[2] = (uint8_t)(palabra >> 8);
+        w->p[3] = (uint8_t)palabra;
+        w->p += 4;
+    }
+}
+
+/**
+ * Comprime 'datos' con LZ77 seguido de Huffman: parte la entrada en tokens con la ventana y el
+ * nivel pedidos, arma los códigos canónicos de los dos alfabetos desde sus histogramas y escribe
+ * cada token como código de literal/largo (+ bits extra) y, si es coincidencia, código de
+ * distancia (+ bits extra). Devuelve el payload y deja los códigos en 'modelo'.
+ */
+uint8_t* comprimir_lz77(const unsigned char* datos, size_t n, int nivel, int ventana,
+                        struct ModeloLZ* modelo, size_t* out_len, uint64_t* out_bits) {
+    if (nivel < 1 || nivel > LZ_NIVEL_MAX || ventana < LZ_VENTANA_MIN || ventana > LZ_VENTANA_MAX ||
+        n > INT32_MAX) {
+        return NULL;
+    }
+    struct TokenLZ* tokens = (struct TokenLZ*)malloc((n ? n : 1) * sizeof(struct TokenLZ));
+    if (!tokens) {
+        printf("Error de memoria para tokens LZ77 (bytes: %zu)\n", n);
+        return NULL;
+    }
+    long long n_tokens = tokenizar(datos, n, nivel, ventana, tokens);
+    if (n_tokens < 0) {
+        printf("Error de memoria para el índice LZ77\n");
+        free(tokens);
+        return NULL;
+    }
+
+    // Histogramas de los dos alfabetos y bits extra
+    uint64_t frec_literal[LZ_SIMBOLOS_LITERAL] = {0};
+    uint64_t frec_distancia[LZ_CODIGOS_DISTANCIA] = {0};
+    uint64_t bits = 0;
+    for (long long k = 0; k < n_tokens; k++) {
+        int extra;
+        if (tokens[k].distancia == 0) {
+            frec_literal[tokens[k].largo]++;
+            continue;
+        }
+        frec_literal[TAM_MAX + codigo_valor_lz(tokens[k].largo - LZ_LARGO_MIN, &extra)]++;
+        bits += (uint64_t)extra;
+        frec_distancia[codigo_valor_lz(tokens[k].distancia - 1, &extra)]++;
+        bits += (uint64_t)extra;
+    }
+    if (limitar_longitudes_n(frec_literal, LZ_SIMBOLOS_LITERAL, modelo->longitudes_literal, LZ_BITS_CODIGO) != 0 ||
+        limitar_longitudes_n(frec_distancia, LZ_CODIGOS_DISTANCIA, modelo->longitudes_distancia, LZ_BITS_CODIGO) != 0 ||
+        asignar_codigos_canonicos_n(modelo->longitudes_literal, LZ_SIMBOLOS_LITERAL, modelo->codigo_literal) != 0 ||
+        asignar_codigos_canonicos_n(modelo->longitudes_distancia, LZ_CODIGOS_DISTANCIA, modelo->codigo_distancia) != 0) {
+        free(tokens);
+        return NULL;
+    }
+    for (int s = 0; s < LZ_SIMBOLOS_LITERAL; s++) bits += frec_literal[s] * modelo->longitudes_literal[s];
+    for (int s = 0; s < LZ_CODIGOS_DISTANCIA; s++) bits += frec_distancia[s] * modelo->longitudes_distancia[s];
+
+    // Bytes exactos más margen para el último vaciado de 32 bits
+    uint8_t* salida = (uint8_t*)malloc((size_t)((bits + 7) / 8) + 8);
+    if (!salida) {
+        printf("Error de memoria para texto codificado (bytes: %zu)\n", n);
+        free(tokens);
+        return NULL;
+    }
+    struct EscritorLZ w = {salida, 0, 0};
+    for (long long k = 0; k < n_tokens; k++) {
+        if (tokens[k].distancia == 0) {
+            uint32_t s = tokens[k].largo;
+            escribir_bits(&w, modelo->codigo_literal[s], modelo->longitudes_literal[s]);
+            continue;
+        }
+        int extra;
+        uint32_t valor = tokens[k].largo - LZ_LARGO_MIN;
+        int c = codigo_valor_lz(valor, &extra);
+        escribir_bits(&w, modelo->codigo_literal[TAM_MAX + c], modelo->longitudes_literal[TAM_MAX + c]);
+        if (extra) escribir_bits(&w, valor & ((1u << extra) - 1), extra);
+        valor = tokens[k].distancia - 1;
+        c = codigo_valor_lz(valor, &extra);
+        escribir_bits(&w, modelo->codigo_distancia[c], modelo->longitudes_distancia[c]);
+        if (extra) escribir_bits(&w, valor & ((1u << extra) - 1), extra);
+    }
+    free(tokens);
+    while (w.pendientes >= 8) {
+        w.pendientes -= 8;
+        *w.p++ = (uint8_t)(w.acumulador >> w.pendientes);
+    }
+    if (w.pendientes > 0) {
+        *w.p++ = (uint8_t)(w.acumulador << (8 - w.pendientes));
+    }
+
+    *out_len = (size_t)(w.p - salida);
+    *out_bits = bits;
+    return salida;
+}
+
+// Cabecera: longitudes de los dos alfabetos en nibbles (todas caben en LZ_BITS_CODIGO bits),
+// primero literales/largos y después distancias
+size_t escribir_modelo_lz(const struct ModeloLZ* modelo, uint8_t* buffer) {
+    memset(buffer, 0, HUF_CABECERA_LZ_MAX);
+    for (int s = 0; s < LZ_SIMBOLOS_LITERAL; s++) {
+        buffer[s / 2] |= (s % 2) ? modelo->longitudes_literal[s] : (uint8_t)(modelo->longitudes_literal[s] << 4);
+    }
+    for (int d = 0; d < LZ_CODIGOS_DISTANCIA; d++) {
+        int s = LZ_SIMBOLOS_LITERAL + d;
+        buffer[s / 2] |= (s % 2) ? modelo->longitudes_distancia[d] : (uint8_t)(modelo->longitudes_distancia[d] << 4);
+    }
+    return HUF_CABECERA_LZ_MAX;
+}
+
+static inline unsigned char leer_nibble(const uint8_t* buffer, int s) {
+    return (s % 2) ? (buffer[s / 2] & 0x0F) : (buffer[s / 2] >> 4);
+}
+
+// Lee una cabecera escrita por escribir_modelo_lz y rearma los códigos; devuelve los bytes
+// consumidos o -1
+int leer_modelo_lz(const uint8_t* buffer, size_t n, struct ModeloLZ* modelo) {
+    if (n < HUF_CABECERA_LZ_MAX) return -1;
+    for (int s = 0; s < LZ_SIMBOLOS_LITERAL; s++) {
+        modelo->longitudes_literal[s] = leer_nibble(buffer, s);
+    }
+    for (int d = 0; d < LZ_CODIGOS_DISTANCIA; d++) {
+        modelo->longitudes_distancia[d] = leer_nibble(buffer, LZ_SIMBOLOS_LITERAL + d);
+    }
+    if (asignar_codigos_canonicos_n(modelo->longitudes_literal, LZ_SIMBOLOS_LITERAL, modelo->codigo_literal) != 0 ||
+        asignar_codigos_canonicos_n(modelo->longitudes_distancia, LZ_CODIGOS_DISTANCIA, modelo->codigo_distancia) != 0) {
+        return -1;
+    }
+    return HUF_CABECERA_LZ_MAX;
+}
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/palabras.h"
+#include "../include/arbol.h"
+#include "../include/decodificador.h"
+
+// Índice del diccionario: tabla hash abierta por (bytes, largo) y acceso directo a los bigramas
+#define INDICE_BITS 13
+#define INDICE_TAM  (1u << INDICE_BITS)
+
+struct IndicePalabras {
+    uint64_t clave[INDICE_TAM];
+    unsigned char largo[INDICE_TAM];   // 0 = ranura libre
+    uint16_t simbolo[INDICE_TAM];
+    uint16_t bigrama[1 << 16];         // símbolo de cada par de bytes (primero << 8 | segundo), 0 = no está
+};
+
+// Candidatos a entrar al diccionario con su cuenta: tabla hash abierta que deja de aceptar
+// claves nuevas al llenarse 3/4 (el vocabulario de un texto grande no la agota en la práctica)
+#define CANDIDATOS_BITS 17
+#define CANDIDATOS_TAM  (1u << CANDIDATOS_BITS)
+
+struct Candidatos {
+    uint64_t clave[CANDIDATOS_TAM];
+    uint64_t cuenta[CANDIDATOS_TAM];
+    unsigned char largo[CANDIDATOS_TAM];   // 0 = ranura libre
+    size_t usados;
+};
+
+static inline uint32_t hash_palabra(uint64_t clave, int largo, int bits) {
+    return (uint32_t)(((clave ^ (uint64_t)largo) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+// Los primeros 'largo' bytes de p en orden de memoria, completados con ceros
+static inline uint64_t leer_clave(const unsigned char* p, int largo) {
+    uint64_t clave = 0;
+    memcpy(&clave, p, (size_t)largo);
+    return clave;
+}
+
+// Letras ASCII y bytes de secuencias UTF-8 (acentos, eñes) forman palabras
+static inline int es_letra(unsigned char c) {
+    return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c >= 0x80;
+}
+
+static inline int es_inicio_palabra(const unsigned char* datos, size_t i) {
+    return es_letra(datos[i]) && (i == 0 || !es_letra(datos[i - 1]));
+}
+
+// Letras seguidas desde i, contando a lo sumo HUF_PALABRA_LARGO_MAX + 1
+static inline int largo_letras(const unsigned char* datos, size_t n, size_t i) {
+    int r = 0;
+    while (i + (size_t)r < n && r <= HUF_PALABRA_LARGO_MAX && es_letra(datos[i + (size_t)r])) r++;
+    return r;
+}
+
+// Palabra candidata que empieza en i: las letras más el espacio que las sigue si cabe, o solo
+// las letras. Devuelve su largo o 0 si no entra en el alfabeto
+static inline int palabra_candidata(const unsigned char* datos, size_t n, size_t i, int r) {
+    if (r + 1 <= HUF_PALABRA_LARGO_MAX && i + (size_t)r < n && datos[i + (size_t)r] == ' ') return r + 1;
+    if (r >= 2 && r <= HUF_PALABRA_LARGO_MAX) return r;
+    return 0;
+}
+
+static void sumar_candidato(struct Candidatos* cand, const unsigned char* p, int largo, uint64_t cuenta) {
+    uint64_t clave = leer_clave(p, largo);
+    uint32_t h = hash_palabra(clave, largo, CANDIDATOS_BITS);
+    while (cand->largo[h]) {
+        if (cand->largo[h] == largo && cand->clave[h] == clave) {
+            cand->cuenta[h] += cuenta;
+            return;
+        }
+        h = (h + 1) & (CANDIDATOS_TAM - 1);
+    }
+    if (cand->usados >= CANDIDATOS_TAM / 4 * 3) return;
+    cand->clave[h] = clave;
+    cand->largo[h] = (unsigned char)largo;
+    cand->cuenta[h] = cuenta;
+    cand->usados++;
+}
+
+static int buscar(const struct IndicePalabras* indice, uint64_t clave, int largo) {
+    uint32_t h = hash_palabra(clave, largo, INDICE_BITS);
+    while (indice->largo[h]) {
+        if (indice->largo[h] == largo && indice->clave[h] == clave) return indice->simbolo[h];
+        h = (h + 1) & (INDICE_TAM - 1);
+    }
+    return 0;
+}
+
+// Palabra del diccionario que empieza en el inicio de palabra i (con espacio primero). 0 si no hay
+static inline int buscar_palabra(const struct IndicePalabras* indice, const unsigned char* datos, size_t n,
+                                 size_t i, int* largo) {
+    int r = largo_letras(datos, n, i);
+    if (r + 1 <= HUF_PALABRA_LARGO_MAX && i + (size_t)r < n && datos[i + (size_t)r] == ' ') {
+        int s = buscar(indice, leer_clave(datos + i, r + 1), r + 1);
+        if (s) {
+            *largo = r + 1;
+            return s;
+        }
+    }
+    if (r >= 2 && r <= HUF_PALABRA_LARGO_MAX) {
+        int s = buscar(indice, leer_clave(datos + i, r), r);
+        if (s) {
+            *largo = r;
+            return s;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Próximo símbolo en datos[i, n): la palabra del diccionario si i es un inicio de palabra, si no
+ * un bigrama del diccionario (salvo que tape el inicio de una palabra del diccionario) o el byte.
+ * Devuelve los bytes que consume el símbolo.
+ */
+static inline int siguiente_simbolo(const struct IndicePalabras* indice, const unsigned char* datos, size_t n,
+                                    size_t i, int* simbolo) {
+    int largo;
+    if (es_inicio_palabra(datos, i)) {
+        int s = buscar_palabra(indice, datos, n, i, &largo);
+        if (s) {
+            *simbolo = s;
+            return largo;
+        }
+    }
+    if (i + 1 < n) {
+        int s = indice->bigrama[(datos[i] << 8) | datos[i + 1]];
+        if (s && !(es_inicio_palabra(datos, i + 1) && buscar_palabra(indice, datos, n, i + 1, &largo))) {
+            *simbolo = s;
+            return 2;
+        }
+    }
+    *simbolo = datos[i];
+    return 1;
+}
+
+// Los TAM_MAX primeros símbolos son los bytes
+static void literales(struct AlfabetoPalabras* alfabeto) {
+    for (int c = 0; c < TAM_MAX; c++) {
+        unsigned char byte = (unsigned char)c;
+        alfabeto->largo[c] = 1;
+        alfabeto->bytes[c] = leer_clave(&byte, 1);
+    }
+}
+
+static void indexar(const struct AlfabetoPalabras* alfabeto, struct IndicePalabras* indice) {
+    memset(indice->largo, 0, sizeof(indice->largo));
+    memset(indice->bigrama, 0, sizeof(indice->bigrama));
+    for (int s = TAM_MAX; s < TAM_MAX + alfabeto->n_palabras; s++) {
+        int largo = alfabeto->largo[s];
+        uint32_t h = hash_palabra(alfabeto->bytes[s], largo, INDICE_BITS);
+        while (indice->largo[h]) h = (h + 1) & (INDICE_TAM - 1);
+        indice->clave[h] = alfabeto->bytes[s];
+        indice->largo[h] = (unsigned char)largo;
+        indice->simbolo[h] = (uint16_t)s;
+        if (largo == 2) {
+            const unsigned char* b = (const unsigned char*)&alfabeto->bytes[s];
+            indice->bigrama[(b[0] << 8) | b[1]] = (uint16_t)s;
+        }
+    }
+}
+
+// Candidato elegible con su ahorro estimado: símbolos que se dejan de emitir
+struct Elegible {
+    uint64_t ahorro;
+    uint64_t clave;
+    int largo;
+};
+
+// Mayor ahorro primero; en empate, por (largo, clave) para que el diccionario sea reproducible
+static int comparar_elegibles(const void* a, const void* b) {
+    const struct Elegible* ea = (const struct Elegible*)a;
+    const struct Elegible* eb = (const struct Elegible*)b;
+    if (ea->ahorro != eb->ahorro) return (ea->ahorro > eb->ahorro) ? -1 : 1;
+    if (ea->largo != eb->largo) return ea->largo - eb->largo;
+    if (ea->clave != eb->clave) return (ea->clave < eb->clave) ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Arma el diccionario con los max_palabras candidatos de mayor ahorro. Un candidato entra solo si
+ * ahorra más símbolos que los bytes que ocupa en la cabecera.
+ */
+static int elegir_palabras(const struct Candidatos* cand, int max_palabras, struct AlfabetoPalabras* alfabeto) {
+    struct Elegible* orden = (struct Elegible*)malloc(cand->usados ? cand->usados * sizeof(struct Elegible) : 1);
+    if (!orden) return -1;
+    size_t n = 0;
+    for (uint32_t h = 0; h < CANDIDATOS_TAM; h++) {
+        if (!cand->largo[h]) continue;
+        uint64_t ahorro = cand->cuenta[h] * (uint64_t)(cand->largo[h] - 1);
+        if (ahorro <= (uint64_t)cand->largo[h] + 1) continue;
+        orden[n].ahorro = ahorro;
+        orden[n].clave = cand->clave[h];
+        orden[n].largo = cand->largo[h];
+        n++;
+    }
+    qsort(orden, n, sizeof(struct Elegible), comparar_elegibles);
+
+    alfabeto->n_palabras = (n < (size_t)max_palabras) ? (int)n : max_palabras;
+    for (int i = 0; i < alfabeto->n_palabras; i++) {
+        alfabeto->largo[TAM_MAX + i] = (unsigned char)orden[i].largo;
+        alfabeto->bytes[TAM_MAX + i] = orden[i].clave;
+    }
+    free(orden);
+    return 0;
+}
+
+/**
+ * Arma el alfabeto extendido de un buffer: diccionario de a lo sumo max_palabras palabras y
+ * bigramas, y códigos canónicos de a lo sumo 'limite' bits (como máximo HUF_BITS_TABLA_MAX, así
+ * cada símbolo se decodifica con una búsqueda). El diccionario sale de tres pasadas:
+ *  1) se cuentan las palabras (letras seguidas, con el espacio que las sigue) y se eligen las de
+ *     mayor ahorro;
+ *  2) se segmenta con esas palabras, contando cuántas veces se usa cada una y los pares de bytes
+ *     que quedan sueltos, y se elige el diccionario final entre palabras y bigramas;
+ *  3) se segmenta con el diccionario final para obtener las frecuencias de los símbolos.
+ * Las palabras que no se usan se descartan. En *bits devuelve el tamaño del payload.
+ */
+int construir_alfabeto_palabras(const unsigned char* datos, size_t n, int max_palabras, int limite,
+                                struct AlfabetoPalabras* alfabeto, uint64_t* bits) {
+    if (max_palabras < 0 || max_palabras > HUF_PALABRAS_MAX) return -1;
+    if (limite <= 0 || limite > HUF_BITS_TABLA_MAX) limite = HUF_BITS_TABLA_MAX;
+
+    struct Candidatos* cand = (struct Candidatos*)calloc(1, sizeof(struct Candidatos));
+    struct IndicePalabras* indice = (struct IndicePalabras*)malloc(sizeof(struct IndicePalabras));
+    uint64_t* frecuencias = (uint64_t*)calloc(HUF_SIMBOLOS_MAX, sizeof(uint64_t));
+    int rc = -1;
+    if (!cand || !indice || !frecuencias) goto salir;
+
+    literales(alfabeto);
+    alfabeto->n_palabras = 0;
+
+    // 1) palabras
+    for (size_t i = 0; i < n;) {
+        if (!es_inicio_palabra(datos, i)) {
+            i++;
+            continue;
+        }
+        int r = largo_letras(datos, n, i);
+        int largo = palabra_candidata(datos, n, i, r);
+        if (largo) sumar_candidato(cand, datos + i, largo, 1);
+        i += (size_t)r;
+    }
+    if (elegir_palabras(cand, max_palabras, alfabeto) != 0) goto salir;
+
+    // 2) uso real de las palabras y pares de bytes sueltos
+    indexar(alfabeto, indice);
+    memset(cand, 0, sizeof(struct Candidatos));
+    int pendiente = -1;   // byte suelto anterior que todavía no formó un par
+    for (size_t i = 0; i < n;) {
+        int s;
+        int largo = siguiente_simbolo(indice, datos, n, i, &s);
+        if (s >= TAM_MAX) {
+            sumar_candidato(cand, datos + i, largo, 1);
+            pendiente = -1;
+        } else if (pendiente >= 0) {
+            sumar_candidato(cand, datos + i - 1, 2, 1);
+            pendiente = -1;
+        } else {
+            pendiente = s;
+        }
+        i += (size_t)largo;
+    }
+    if (elegir_palabras(cand, max_palabras, alfabeto) != 0) goto salir;
+
+    // 3) frecuencias con el diccionario final
+    indexar(alfabeto, indice);
+    for (size_t i = 0; i < n;) {
+        int s;
+        i += (size_t)siguiente_simbolo(indice, datos, n, i, &s);
+        frecuencias[s]++;
+    }
+
+    // Descartar las palabras sin uso (no cambian la segmentación: nunca se encontraron)
+    int palabras = 0;
+    for (int s = TAM_MAX; s < TAM_MAX + alfabeto->n_palabras; s++) {
+        if (!frecuencias[s]) continue;
+        int destino = TAM_MAX + palabras++;
+        alfabeto->largo[destino] = alfabeto->largo[s];
+        alfabeto->bytes[destino] = alfabeto->bytes[s];
+        frecuencias[destino] = frecuencias[s];
+    }
+    alfabeto->n_palabras = palabras;
+    int n_simbolos = TAM_MAX + palabras;
+
+    int presentes = 0;
+    for (int s = 0; s < n_simbolos; s++) {
+        if (frecuencias[s]) presentes++;
+    }
+    while ((1 << limite) < presentes) limite++;
+    if (limitar_longitudes_n(frecuencias, n_simbolos, alfabeto->longitudes, limite) != 0 ||
+        asignar_codigos_canonicos_n(alfabeto->longitudes, n_simbolos, alfabeto->codigo) != 0) {
+        goto salir;
+    }
+
+    if (bits) {
+        *bits = 0;
+        for (int s = 0; s < n_simbolos; s++) *bits += frecuencias[s] * alfabeto->longitudes[s];
+    }
+    rc = 0;
+
+salir:
+    free(frecuencias);
+    free(indice);
+    free(cand);
+    return rc;
+}
+
+/**
+ * Codifica un buffer con el alfabeto extendido (MSB primero), segmentándolo igual que
+ * construir_alfabeto_palabras. La salida se reserva para el peor caso (cada byte con el código
+ * más largo) y se achica al final. Devuelve el buffer empaquetado o NULL si falla.
+ */
+uint8_t* codificar_palabras(const unsigned char* datos, size_t n, const struct AlfabetoPalabras* alfabeto,
+                            size_t* out_len, uint64_t* out_bits) {
+    int longitud_max = 0;
+    for (int s = 0; s < TAM_MAX + alfabeto->n_palabras; s++) {
+        if (alfabeto->longitudes[s] > longitud_max) longitud_max = alfabeto->longitudes[s];
+    }
+    struct IndicePalabras* indice = (struct IndicePalabras*)malloc(sizeof(struct IndicePalabras));
+    uint8_t* salida = (uint8_t*)malloc(n / 8 * (size_t)longitud_max + (size_t)longitud_max + 8);
+    if (!indice || !salida) {
+        printf("Error de memoria para texto codificado (bytes: %zu)\n", n);
+        free(indice);
+        free(salida);
+        return NULL;
+    }
+    indexar(alfabeto, indice);
+
+    // Códigos de a lo sumo 15 bits: el acumulador se vacía de a 32 bits
+    uint8_t* p = salida;
+    uint64_t acumulador = 0, bits = 0;
+    int pendientes = 0;
+    for (size_t i = 0; i < n;) {
+        int s;
+        i += (size_t)siguiente_simbolo(indice, datos, n, i, &s);
+        int longitud = alfabeto->longitudes[s];
+        if (longitud == 0) {
+            printf("Error: símbolo %d sin código en el alfabeto extendido\n", s);
+            free(indice);
+            free(salida);
+            return NULL;
+        }
+        acumulador = (acumulador << longitud) | alfabeto->codigo[s];
+        pendientes += longitud;
+        bits += (uint64_t)longitud;
+        if (pendientes >= 32) {
+            pendientes -= 32;
+            uint32_t palabra = (uint32_t)(acumulador >> pendientes);
+            p[0] = (uint8_t)(palabra >> 24);
+            p[1] = (uint8_t)(palabra >> 16);
+            p[2] = (uint8_t)(palabra >> 8);
+            p[3] = (uint8_t)palabra;
+            p += 4;
+        }
+    }
+    while (pendientes >= 8) {
+        pendientes -= 8;
+        *p++ = (uint8_t)(acumulador >> pendientes);
+    }
+    if (pendientes > 0) {
+        *p++ = (uint8_t)(acumulador << (8 - pendientes));
+    }
+    free(indice);
+
+    size_t bytes = (size_t)(p - salida);
+    uint8_t* ajustada = (uint8_t*)realloc(salida, bytes ? bytes : 1);
+    *out_len = bytes;
+    *out_bits = bits;
+    return ajustada ? ajustada : salida;
+}
+
+/**
+ * Escribe el alfabeto: cantidad de palabras (u16), cada palabra como largo y bytes, la longitud
+ * máxima de código y la longitud de cada símbolo en nibbles. Devuelve los bytes escritos (como
+ * máximo HUF_CABECERA_PALABRAS_MAX).
+ */
+size_t escribir_alfabeto_palabras(const struct AlfabetoPalabras* alfabeto, uint8_t* buffer) {
+    size_t n = 0;
+    buffer[n++] = (uint8_t)(alfabeto->n_palabras & 0xFF);
+    buffer[n++] = (uint8_t)(alfabeto->n_palabras >> 8);
+    for (int s = TAM_MAX; s < TAM_MAX + alfabeto->n_palabras; s++) {
+        buffer[n++] = alfabeto->largo[s];
+        memcpy(buffer + n, &alfabeto->bytes[s], alfabeto->largo[s]);
+        n += alfabeto->largo[s];
+    }
+
+    int n_simbolos = TAM_MAX + alfabeto->n_palabras;
+    int longitud_max = 0;
+    for (int s = 0; s < n_simbolos; s++) {
+        if (alfabeto->longitudes[s] > longitud_max) longitud_max = alfabeto->longitudes[s];
+    }
+    buffer[n++] = (uint8_t)longitud_max;
+    for (int s = 0; s < n_simbolos; s += 2) {
+        uint8_t bajo = (s + 1 < n_simbolos) ? alfabeto->longitudes[s + 1] : 0;
+        buffer[n++] = (uint8_t)((alfabeto->longitudes[s] << 4) | bajo);
+    }
+    return n;
+}
+
+/**
+ * Lee un alfabeto escrito por escribir_alfabeto_palabras y reconstruye sus códigos canónicos.
+ * Devuelve los bytes consumidos o -1 si la cabecera es inválida.
+ */
+int leer_alfabeto_palabras(const uint8_t* buffer, size_t n, struct AlfabetoPalabras* alfabeto) {
+    if (n < 3) return -1;
+    alfabeto->n_palabras = buffer[0] | (buffer[1] << 8);
+    if (alfabeto->n_palabras > HUF_PALABRAS_MAX) return -1;
+
+    literales(alfabeto);
+    size_t pos = 2;
+    for (int s = TAM_MAX; s < TAM_MAX + alfabeto->n_palabras; s++) {
+        if (pos >= n) return -1;
+        int largo = buffer[pos++];
+        if (largo < 2 || largo > HUF_PALABRA_LARGO_MAX || n - pos < (size_t)largo) return -1;
+        alfabeto->largo[s] = (unsigned char)largo;
+        alfabeto->bytes[s] = leer_clave(buffer + pos, largo);
+        pos += (size_t)largo;
+    }
+
+    int n_simbolos = TAM_MAX + alfabeto->n_palabras;
+    if (pos >= n) return -1;
+    int longitud_max = buffer[pos++];
+    if (longitud_max > HUF_BITS_TABLA_MAX || n - pos < (size_t)(n_simbolos + 1) / 2) return -1;
+    for (int s = 0; s < n_simbolos; s++) {
+        uint8_t b = buffer[pos + (size_t)s / 2];
+        alfabeto->longitudes[s] = (s % 2) ? (b & 0x0F) : (b >> 4);
+        if (alfabeto->longitudes[s] > longitud_max) return -1;
+    }
+    pos += (size_t)(n_simbolos + 1) / 2;
+
+    if (asignar_codigos_canonicos_n(alfabeto->longitudes, n_simbolos, alfabeto->codigo) != 0) return -1;
+    return (int)pos;
+}
@@ -25,6 +25,12 @@
 #include "../../huffman/include/huffman.h"
 #include "../../huffman/include/frecuencias.h"
 #include "../../huffman/include/arbol.h"
+#include "../../huffman/include/codigos.h"
+#include "../../huffman/include/decodificador.h"
+#include "../../huffman/include/contexto.h"
+#include "../../huffman/include/palabras.h"
+#include "../../huffman/include/ans.h"
+#include "../../huffman/include/lz77.h"
 
 /* --- Logging de errores estandar del proyecto --- */
 #define DIE(...)                      \
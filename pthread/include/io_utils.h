@@ -23,6 +23,9 @@ void sv_free(strvec_t *v);                  /* libera todos los strings y el vec
 /* --- E/S de archivos completos en modo binario --- */
 int read_file_text(const char *path, char **out_buf, size_t *out_len);   /* lee el archivo a memoria y agrega '\0' */
 int write_file_text(const char *path, const char *buf, size_t len);      /* escribe exactamente 'len' bytes */
+int read_file_range(const char *path, uint64_t off, char *buf, size_t len);   /* lee 'len' bytes desde 'off' */
+int create_file_sized(const char *path, uint64_t len);                        /* crea el archivo con 'len' bytes */
+int write_file_range(const char *path, uint64_t off, const char *buf, size_t len);   /* escribe 'len' bytes en 'off' */
 
 /* --- Descubrimiento de archivos en un directorio --- */
 int list_files_with_suffix(const char *dir, const char *suffix, strvec_t *out);   /* llena 'out' con rutas */
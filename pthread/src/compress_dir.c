@@ -13,93 +13,396 @@ typedef struct
 {
     char path[PATH_MAX];
     char name[PATH_MAX];
+    size_t index;          /* posición de la entrada en el vector compartido */
+    uint32_t block;        /* modo bloques: bloque de la entrada que comprime la tarea */
 } task_arg_t;
 
 /* shared_t: Estado compartido entre hilos para acumular los resultados
-   con protección por mutex. */
+   con protección por mutex. Cada tarea entrega su entrada al .hfa cuando la termina, en el orden
+   de las entradas y sin esperar; solo los bloques pasan por archivos parciales de 'dir'. */
 typedef struct
 {
     pthread_mutex_t mtx;
-    hfa_entry_t *vec; /* vector de resultados uno por archivo */
-    size_t idx;       /* índice de escritura actual */
+    const char *dir;       /* directorio de entrada, donde van los archivos parciales */
+    hfa_entry_t *vec;      /* vector de resultados uno por archivo, en el orden del listado */
+    hfa_writer_t *out;     /* .hfa abierto para escritura posicional */
+    bool *done;            /* una marca por entrada: quedó escrita en el .hfa */
+    uint32_t *pending;     /* modo bloques: bloques de cada entrada que todavía no se codificaron */
+    hfa_opts_t opts;       /* límite de bits, sub-flujos, contextos y palabras de cada entrada o bloque */
+    uint64_t penalty_bits; /* bits extra por el límite respecto de Huffman sin límite */
+    uint32_t block_size;   /* archivos más grandes se parten en bloques (0 = nunca) */
+    uint32_t sync_interval; /* bytes entre puntos de sincronía del flujo único (0 = sin puntos) */
+    uint64_t (*hist)[TAM_MAX];  /* --shared: histograma de cada archivo, para agrupar */
+    hfa_table_t *tables;        /* --shared: tablas compartidas que van en la sección del HFA3 */
+    uint32_t ntables;
+    uint32_t *assign;           /* --shared: tabla de cada entrada */
 } shared_t;
 
-/* función worker que comprime un archivo:
- * - Lee el texto
- * - Calcula frecuencias y construye el árbol de Huffman
- * - Genera la tabla y el bitstring y lo empaqueta en bytes
- * - Inserta el resultado en el vector compartido */
-static void do_compress(void *arg)
+/* opciones de una entrada: las comunes más su tabla compartida, si la tiene */
+static hfa_opts_t entry_opts(const shared_t *S, size_t index)
 {
-    task_arg_t *t = (task_arg_t *)arg;
-    shared_t *S = (shared_t *)t->name;
-    S = *(shared_t **)t->name;
+    hfa_opts_t o = S->opts;
+    if (S->tables)
+        o.table = &S->tables[S->assign[index]];
+    return o;
+}
+
+/* ruta del archivo parcial de una entrada completa (block = UINT32_MAX) o de uno de sus bloques */
+static void part_path(const shared_t *S, size_t index, uint32_t block, char out[PATH_MAX])
+{
+    if (block == UINT32_MAX)
+        snprintf(out, PATH_MAX, "%s/.hfp.%zu.part", S->dir, index);
+    else
+        snprintf(out, PATH_MAX, "%s/.hfp.%zu.%u.part", S->dir, index, block);
+}
 
-    /* 1) Leer texto completo a memoria */
+/* comprime un archivo en memoria con sub-flujos intercalados y escribe la entrada en 'pf' */
+static int compress_streams(FILE *pf, const char *path, hfa_entry_t *e, const shared_t *S, uint64_t *penalty)
+{
     char *texto = NULL;
     size_t tlen = 0;
-    if (read_file_text(t->path, &texto, &tlen) != 0)
+    if (read_file_text(path, &texto, &tlen) != 0)
+        return -1;
+
+    uint64_t freq[TAM_MAX] = {0};
+    acumular_histograma((const unsigned char *)texto, tlen, freq);
+    struct TablaCodigos tabla;
+    int rc = generar_codigos_canonicos(freq, S->opts.max_bits, e->code_len, &tabla, penalty);
+    if (rc == 0)
+    {
+        e->txt_len = tlen;
+        e->method = HFA_METHOD_HUFFMAN_STREAMS;
+        e->packed = codificar_flujos((const unsigned char *)texto, tlen, &tabla, S->opts.streams, &e->packed_len, &e->bit_count);
+        if (e->packed && e->packed_len >= tlen && tlen > 0)
+        {
+            /* la codificación no achica el archivo: se almacena tal cual */
+            free(e->packed);
+            e->method = HFA_METHOD_STORED;
+            e->packed = (uint8_t *)texto;
+            e->packed_len = tlen;
+            e->bit_count = (uint64_t)tlen * 8;
+            texto = NULL;
+            if (penalty)
+                *penalty = 0;
+        }
+        rc = (e->packed && hfa_write_entry(pf, e) == 0) ? 0 : -1;
+        free(e->packed);
+        e->packed = NULL;
+    }
+    free(texto);
+    return rc;
+}
+
+/* función worker que comprime un archivo y lo escribe en el .hfa:
+ * - Con flujo único: histograma y codificación por trozos (memoria acotada), con puntos de sincronía
+ * - Con sub-flujos: codifica el archivo en memoria y escribe la entrada
+ * - La entrada se arma en memoria (o en su archivo parcial si la fuente es grande) y se entrega al
+ *   .hfa sin esperar a las anteriores (hfa_slot_commit)
+ * - Marca la entrada como completa */
+static void do_compress(void *arg)
+{
+    task_arg_t *t = (task_arg_t *)arg;
+    shared_t *S = *(shared_t **)t->name;
+    hfa_entry_t *e = &S->vec[t->index];
+
+    char part[PATH_MAX];
+    part_path(S, t->index, UINT32_MAX, part);
+    struct stat st;
+    hfa_slot_t slot;
+    FILE *pf = hfa_slot_open(&slot, part, stat(t->path, &st) == 0 ? (uint64_t)st.st_size : UINT64_MAX);
+    if (!pf)
     {
         free(t);
         return;
     }
 
-    /* 2) Construir Huffman */
-    int freq[TAM_MAX];
-    contar_frecuencias(texto, freq);
-    struct ListaNodos L = crear_lista_nodos(freq);
-    struct Nodo *raiz = construir_arbol_huffman(L);
-    char *tabla[TAM_MAX] = {0};
-    char cod[TAM_MAX];
-    generar_codigos_huffman(raiz, cod, 0, tabla);
-    char *bitstr = comprimir_texto(texto, tabla);
-
-    /* 3) Empaquetar bits en bytes */
-    uint8_t *packed = NULL;
-    size_t packed_len = 0;
-    uint64_t bit_count = 0;
-    pack_bits_from_bitstr(bitstr, &packed, &packed_len, &bit_count);
-
-    /* 4) Guardar en vector compartido */
-    pthread_mutex_lock(&S->mtx);
-    size_t i = S->idx++;
-    S->vec[i].name = strdup(strrchr(t->path, '/') ? strrchr(t->path, '/') + 1 : t->path);
-    S->vec[i].txt = texto;
-    S->vec[i].txt_len = tlen;
-    S->vec[i].raiz = raiz;
-    S->vec[i].tabla = calloc(TAM_MAX, sizeof(char *));
-    for (int k = 0; k < TAM_MAX; k++)
-        S->vec[i].tabla[k] = tabla[k];
-    S->vec[i].bitstr = bitstr;
-    S->vec[i].bit_count = bit_count;
-    S->vec[i].packed = packed;
-    S->vec[i].packed_len = packed_len;
-    pthread_mutex_unlock(&S->mtx);
-
-    /* 5) Liberar arg de tarea */
+    uint64_t penalty = 0;
+    hfa_opts_t o = entry_opts(S, t->index);
+    int rc = (S->opts.streams > 1)
+                 ? compress_streams(pf, t->path, e, S, &penalty)
+                 : hfa_compress_stream(pf, t->path, e->name, &o, S->sync_interval,
+                                       &e->bit_count, &penalty);
+    rc = hfa_slot_commit(S->out, (uint32_t)t->index, &slot, rc);
+
+    if (rc == 0)
+    {
+        pthread_mutex_lock(&S->mtx);
+        S->done[t->index] = true;
+        S->penalty_bits += penalty;
+        pthread_mutex_unlock(&S->mtx);
+    }
+    free(t);
+}
+
+/* entrega al .hfa una entrada en bloques cuando ya se codificaron todos: la cabecera con los
+   tamaños de cada bloque va en memoria y los archivos parciales de los bloques detrás, en orden */
+static int place_blocks(shared_t *S, size_t index)
+{
+    const hfa_entry_t *e = &S->vec[index];
+    hfa_slot_t slot;
+    FILE *mem = hfa_slot_open(&slot, NULL, 0);
+    if (!mem)
+        return -1;
+    int rc = hfa_write_entry_header(mem, e);
+
+    char part[PATH_MAX];
+    for (uint32_t b = 0; b < e->nblocks && rc == 0; b++)
+    {
+        part_path(S, index, b, part);
+        rc = hfa_slot_add_part(&slot, part, e->blocks[b].len);
+    }
+    return hfa_slot_commit(S->out, (uint32_t)index, &slot, rc);
+}
+
+/* función worker que comprime un bloque de un archivo grande:
+ * - Lee solo su rango del archivo
+ * - Lo codifica con histograma y códigos propios
+ * - Escribe el bloque en su archivo parcial y deja en la entrada solo su tamaño y bits
+ * - La tarea del último bloque entrega la entrada completa al .hfa; con un bloque fallido la entrada no llega */
+static void do_compress_block(void *arg)
+{
+    task_arg_t *t = (task_arg_t *)arg;
+    shared_t *S = *(shared_t **)t->name;
+    hfa_entry_t *e = &S->vec[t->index];
+
+    uint64_t start = (uint64_t)t->block * e->block_size;
+    size_t len = (e->txt_len - start < e->block_size) ? (size_t)(e->txt_len - start) : e->block_size;
+
+    unsigned char *buf = (unsigned char *)malloc(len);
+    hfa_block_t blk = {0};
+    uint64_t penalty = 0;
+    hfa_opts_t o = entry_opts(S, t->index);
+    char part[PATH_MAX];
+    part_path(S, t->index, t->block, part);
+    bool last = false;
+    if (buf && read_file_range(t->path, start, (char *)buf, len) == 0 &&
+        hfa_encode_block(buf, len, &o, &blk, &penalty) == 0 &&
+        write_file_text(part, (const char *)blk.data, blk.len) == 0)
+    {
+        pthread_mutex_lock(&S->mtx);
+        e->blocks[t->block].len = blk.len;
+        e->blocks[t->block].bit_count = blk.bit_count;
+        e->bit_count += blk.bit_count;
+        S->penalty_bits += penalty;
+        last = (--S->pending[t->index] == 0);
+        pthread_mutex_unlock(&S->mtx);
+    }
+    if (last && place_blocks(S, t->index) == 0)
+    {
+        pthread_mutex_lock(&S->mtx);
+        S->done[t->index] = true;
+        pthread_mutex_unlock(&S->mtx);
+    }
+
+    free(blk.data);
+    free(buf);
     free(t);
 }
 
+/* función worker de --shared: histograma de un archivo para agruparlo con los demás */
+static void do_histogram(void *arg)
+{
+    task_arg_t *t = (task_arg_t *)arg;
+    shared_t *S = *(shared_t **)t->name;
+    hfa_estimate_t est;
+    if (hfa_estimate_file(t->path, S->opts.max_bits, 0, S->hist[t->index], &est) != 0)
+        WARN("No se pudo leer %s", t->path);
+    free(t);
+}
+
+/* borra los archivos parciales que hayan quedado de una entrada */
+static void remove_parts(const shared_t *S, size_t index)
+{
+    char part[PATH_MAX];
+    const hfa_entry_t *e = &S->vec[index];
+    if (e->method == HFA_METHOD_HUFFMAN_BLOCKS)
+    {
+        for (uint32_t b = 0; b < e->nblocks; b++)
+        {
+            part_path(S, index, b, part);
+            remove(part);
+        }
+    }
+    else
+    {
+        part_path(S, index, UINT32_MAX, part);
+        remove(part);
+    }
+}
+
+/* encola una tarea (archivo completo o bloque) pasando el estado compartido */
+static void submit_task(thread_pool_t *tp, shared_t *S, work_fn fn, const char *path, size_t index, uint32_t block)
+{
+    task_arg_t *t = calloc(1, sizeof(*t));
+    strncpy(t->path, path, PATH_MAX - 1);
+    t->index = index;
+    t->block = block;
+    /* Pasar puntero compartido mediante un pequeño truco */
+    shared_t **pp = (shared_t **)&t->name[0];
+    *pp = S;
+    tp_submit(tp, fn, t);
+}
+
+/* --append: deja en 'files' solo los .txt que el .hfa no tiene o que cambiaron (otro tamaño o
+   modificados después del .hfa). Devuelve cuántos quedaron sin tocar o -1 si no se pudo indexar */
+static long select_changed(const char *arch_path, strvec_t *files)
+{
+    struct stat ast;
+    hfa_meta_t *meta = NULL;
+    uint32_t n = 0;
+    hfa_lookup_t lookup;
+    if (stat(arch_path, &ast) != 0 || hfa_index(arch_path, &meta, &n) != 0)
+        return -1;
+    if (hfa_lookup_build(meta, n, &lookup) != 0)
+    {
+        hfa_free_index(meta, n);
+        return -1;
+    }
+
+    size_t kept = 0;
+    long skipped = 0;
+    for (size_t i = 0; i < files->len; i++)
+    {
+        const char *slash = strrchr(files->paths[i], '/');
+        uint32_t k = hfa_lookup(&lookup, meta, slash ? slash + 1 : files->paths[i]);
+        struct stat st;
+        if (k != UINT32_MAX && stat(files->paths[i], &st) == 0 && (uint64_t)st.st_size == meta[k].orig_len &&
+            st.st_mtime <= ast.st_mtime)
+        {
+            free(files->paths[i]);
+            skipped++;
+        }
+        else
+            files->paths[kept++] = files->paths[i];
+    }
+    files->len = kept;
+    hfa_lookup_free(&lookup);
+    hfa_free_index(meta, n);
+    return skipped;
+}
+
 /* imprime sintaxis del binario */
-static void usage(const char *a) { fprintf(stderr, "Uso: %s <dir> [hilos] [nombre_salida.hfa]\n", a); }
+static void usage(const char *a) { fprintf(stderr, "Uso: %s <dir> [hilos] [nombre_salida.hfa] [--max-bits N] [--streams N] [--context N] [--words N] [--codec huffman|ans|auto] [--level N] [--window N] [--block-kib N] [--sync-kib N] [--table T.hft] [--train T.hft] [--shared K] [--append] [--analyze]\n", a); }
 
 /* coordina la compresión paralela:
- * - Enumera .txt, lanza tareas, espera el fin
- * - Escribe un único .hfa
+ * - Enumera .txt, lanza una tarea por archivo (o por bloque si es grande), espera el fin
+ * - Abre el .hfa antes de lanzar las tareas: cada una escribe su entrada en su región y el
+ *   directorio va al final (con --append, agrega al existente solo los .txt nuevos o cambiados)
  * - Si todo OK, elimina los .txt
  * - Mide y reporta tiempo total en ms */
 int main(int argc, char **argv)
 {
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0);
-    if (argc < 2)
+
+    /* Separar opciones de los argumentos posicionales */
+    const char *pos[3] = {0};
+    int npos = 0;
+    int max_bits = HUF_LIMITE_DEFECTO;
+    int streams = 1;
+    int contexts = 0;
+    int words = 0;
+    int codec = HFA_CODEC_HUFFMAN;
+    int level = 0;
+    int window = LZ_VENTANA_DEFECTO;
+    long block_kib = HFA_BLOCK_SIZE_DEFAULT / 1024;
+    long sync_kib = HFA_SYNC_INTERVAL_DEFAULT / 1024;
+    bool analyze = false;
+    bool append = false;
+    const char *table_path = NULL, *train_path = NULL;
+    int shared = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--max-bits") == 0 && i + 1 < argc)
+            max_bits = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--streams") == 0 && i + 1 < argc)
+            streams = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--context") == 0 && i + 1 < argc)
+            contexts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--words") == 0 && i + 1 < argc)
+            words = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--codec") == 0 && i + 1 < argc)
+        {
+            const char *c = argv[++i];
+            if (strcmp(c, "huffman") == 0)
+                codec = HFA_CODEC_HUFFMAN;
+            else if (strcmp(c, "ans") == 0)
+                codec = HFA_CODEC_ANS;
+            else if (strcmp(c, "auto") == 0)
+                codec = HFA_CODEC_AUTO;
+            else
+                DIE("--codec debe ser huffman, ans o auto");
+        }
+        else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+            level = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+            window = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--block-kib") == 0 && i + 1 < argc)
+            block_kib = atol(argv[++i]);
+        else if (strcmp(argv[i], "--sync-kib") == 0 && i + 1 < argc)
+            sync_kib = atol(argv[++i]);
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc)
+            table_path = argv[++i];
+        else if (strcmp(argv[i], "--train") == 0 && i + 1 < argc)
+            train_path = argv[++i];
+        else if (strcmp(argv[i], "--shared") == 0 && i + 1 < argc)
+            shared = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--analyze") == 0)
+            analyze = true;
+        else if (strcmp(argv[i], "--append") == 0)
+            append = true;
+        else if (argv[i][0] == '-' || npos == 3)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+            pos[npos++] = argv[i];
+    }
+    if (npos < 1)
     {
         usage(argv[0]);
         return 1;
     }
-    const char *dir = argv[1];
-    int threads = (argc >= 3) ? atoi(argv[2]) : num_cpus();
-    const char *outname = (argc >= 4) ? argv[3] : "archive.hfa";
+    if (max_bits != 0 && (max_bits < 8 || max_bits > 30))
+        DIE("--max-bits debe ser 0 (sin límite) o estar entre 8 y 30");
+    if (streams < 1 || streams > HUF_FLUJOS_MAX)
+        DIE("--streams debe estar entre 1 y %d", HUF_FLUJOS_MAX);
+    if (contexts != 0 && (contexts < 2 || contexts > HUF_CONTEXTOS_MAX))
+        DIE("--context debe ser 0 (sin contexto) o estar entre 2 y %d", HUF_CONTEXTOS_MAX);
+    if (contexts && streams > 1)
+        DIE("--context no se combina con --streams");
+    if (words < 0 || words > HUF_PALABRAS_MAX)
+        DIE("--words debe ser 0 (solo bytes) o estar entre 1 y %d", HUF_PALABRAS_MAX);
+    if (words && (streams > 1 || contexts))
+        DIE("--words no se combina con --streams ni con --context");
+    if (codec != HFA_CODEC_HUFFMAN && streams > 1)
+        DIE("--codec no se combina con --streams (ANS ya intercala %d estados)", ANS_ESTADOS);
+    if (level < 0 || level > LZ_NIVEL_MAX)
+        DIE("--level debe ser 0 (sin LZ77) o estar entre 1 y %d", LZ_NIVEL_MAX);
+    if (window < LZ_VENTANA_MIN || window > LZ_VENTANA_MAX)
+        DIE("--window debe estar entre %d y %d", LZ_VENTANA_MIN, LZ_VENTANA_MAX);
+    if (level && streams > 1)
+        DIE("--level no se combina con --streams");
+    if (table_path && streams > 1)
+        DIE("--table no se combina con --streams");
+    if (shared < 0 || shared > HFA_SHARED_MAX)
+        DIE("--shared debe ser 0 (una tabla por entrada) o estar entre 1 y %d", HFA_SHARED_MAX);
+    if (shared && (streams > 1 || table_path))
+        DIE("--shared no se combina con --streams ni con --table");
+    if (shared && append)
+        DIE("--shared no se combina con --append (las tablas van antes de las entradas)");
+    const hfa_table_t *table = NULL;
+    if (table_path && !(table = hfa_load_table(table_path)))
+        DIE("No se pudo cargar la tabla %s", table_path);
+    if (block_kib < 0 || block_kib > 1024 * 1024)
+        DIE("--block-kib debe ser 0 (sin bloques) o estar entre 1 y %d", 1024 * 1024);
+    if (sync_kib < 0 || sync_kib > 1024 * 1024)
+        DIE("--sync-kib debe ser 0 (sin puntos de sincronía) o estar entre 1 y %d", 1024 * 1024);
+
+    const char *dir = pos[0];
+    int threads = (npos >= 2) ? atoi(pos[1]) : num_cpus();
+    const char *outname = (npos >= 3) ? pos[2] : "archive.hfa";
 
     strvec_t files;
     sv_init(&files);
@@ -114,31 +417,133 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    /* --analyze: estimaciones desde el histograma, sin comprimir ni borrar los .txt */
+    if (analyze)
+    {
+        int rc = hfa_analyze(files.paths, files.len, max_bits, (uint32_t)block_kib * 1024);
+        if (rc != 0)
+            WARN("No se pudo analizar %s", dir);
+        sv_free(&files);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("Tiempo de análisis: %ld ms\n", elapsed_ms(t0, t1));
+        return rc != 0;
+    }
+
+    /* --train: tabla estática desde el histograma conjunto, sin comprimir ni borrar los .txt */
+    if (train_path)
+    {
+        int rc = hfa_train_table(files.paths, files.len, max_bits, train_path);
+        if (rc != 0)
+            WARN("No se pudo entrenar %s", train_path);
+        sv_free(&files);
+        return rc != 0;
+    }
+
+    /* --append sobre un .hfa existente: comprimir solo lo nuevo o cambiado */
+    char arch_path[PATH_MAX];
+    join_path(dir, outname, arch_path);
+    if (append && access(arch_path, F_OK) != 0)
+        append = false;
+    if (append)
+    {
+        long skipped = select_changed(arch_path, &files);
+        if (skipped < 0)
+            DIE("No se pudo indexar %s para agregar", arch_path);
+        printf("[INFO] %ld archivos sin cambios en %s\n", skipped, arch_path);
+        if (!files.len)
+        {
+            sv_free(&files);
+            return 0;
+        }
+    }
+
     thread_pool_t tp;
     if (tp_init(&tp, threads) != 0)
         DIE("pool");
-    shared_t S = {.vec = calloc(files.len, sizeof(hfa_entry_t)), .idx = 0};
+    shared_t S = {.dir = dir, .vec = calloc(files.len, sizeof(hfa_entry_t)), .done = calloc(files.len, sizeof(bool)),
+                  .pending = calloc(files.len, sizeof(uint32_t)),
+                  .opts = {.max_bits = max_bits, .streams = streams, .contexts = contexts, .words = words, .codec = codec,
+                           .level = level, .window = window, .table = table},
+                  .block_size = (uint32_t)block_kib * 1024, .sync_interval = (uint32_t)sync_kib * 1024};
     pthread_mutex_init(&S.mtx, NULL);
 
-    /* Encolar una tarea por archivo */
+    /* --shared: histogramas en paralelo y agrupamiento en a lo sumo K tablas antes de comprimir */
+    if (shared)
+    {
+        S.hist = calloc(files.len, sizeof(*S.hist));
+        S.assign = calloc(files.len, sizeof(uint32_t));
+        if (!S.hist || !S.assign)
+            DIE("Sin memoria para los histogramas");
+        for (size_t i = 0; i < files.len; i++)
+            submit_task(&tp, &S, do_histogram, files.paths[i], i, 0);
+        tp_wait(&tp);
+        if (hfa_cluster_tables((const uint64_t (*)[TAM_MAX])S.hist, files.len, shared, max_bits,
+                               &S.tables, &S.ntables, S.assign) != 0)
+            DIE("No se pudieron agrupar las tablas");
+        printf("[INFO] %u tablas compartidas para %zu archivos\n", S.ntables, files.len);
+    }
+
+    /* El .hfa se abre antes de comprimir (con las tablas compartidas ya armadas) */
+    hfa_writer_t out;
+    if (hfa_writer_open(&out, arch_path, (uint32_t)files.len, append, false, S.tables, S.ntables) != 0)
+        DIE("No se pudo abrir %s", arch_path);
+    S.out = &out;
+
+    /* Encolar una tarea por archivo, o una por bloque si el archivo supera el tamaño de bloque */
     for (size_t i = 0; i < files.len; i++)
     {
-        task_arg_t *t = calloc(1, sizeof(*t));
-        strncpy(t->path, files.paths[i], PATH_MAX - 1);
-        /* Pasar puntero compartido mediante un pequeño truco */
-        shared_t **pp = (shared_t **)&t->name[0];
-        *pp = &S;
-        tp_submit(&tp, do_compress, t);
+        hfa_entry_t *e = &S.vec[i];
+        const char *slash = strrchr(files.paths[i], '/');
+        e->name = strdup(slash ? slash + 1 : files.paths[i]);
+
+        struct stat st;
+        if (S.block_size && stat(files.paths[i], &st) == 0 && (uint64_t)st.st_size > S.block_size)
+        {
+            e->method = HFA_METHOD_HUFFMAN_BLOCKS;
+            e->txt_len = (size_t)st.st_size;
+            e->block_size = S.block_size;
+            e->nblocks = (uint32_t)((e->txt_len + S.block_size - 1) / S.block_size);
+            e->blocks = calloc(e->nblocks, sizeof(hfa_block_t));
+            S.pending[i] = e->nblocks;
+            for (uint32_t b = 0; b < e->nblocks; b++)
+                submit_task(&tp, &S, do_compress_block, files.paths[i], i, b);
+        }
+        else
+        {
+            submit_task(&tp, &S, do_compress, files.paths[i], i, 0);
+        }
     }
     tp_wait(&tp);
     tp_destroy(&tp);
 
-    /* Escribir un único .hfa y, si salió bien, borrar .txt */
-    char arch_path[PATH_MAX];
-    join_path(dir, outname, arch_path);
-    if (hfa_write(arch_path, S.vec, (uint32_t)files.len) == 0)
+    bool complete = true;
+    for (size_t i = 0; i < files.len; i++)
+    {
+        if (!S.done[i])
+        {
+            WARN("No se pudo comprimir %s", files.paths[i]);
+            complete = false;
+        }
+    }
+
+    /* Cerrar el .hfa con su directorio y, si salió bien, borrar .txt */
+    if (hfa_writer_close(&out, complete) == 0)
     {
-        printf("[OK] Se escribio %s con %zu archivos\n", arch_path, files.len);
+        printf(append ? "[OK] Se agregaron a %s %zu archivos\n" : "[OK] Se escribio %s con %zu archivos\n", arch_path, files.len);
+        if (S.penalty_bits)
+        {
+            uint64_t payload_bits = 0;
+            for (size_t i = 0; i < files.len; i++)
+                payload_bits += S.vec[i].bit_count;
+            /* el porcentaje es respecto del payload sin límite; sin ese payload solo van los bytes */
+            if (payload_bits > S.penalty_bits)
+                printf("[INFO] Límite de %d bits: +%llu bytes (%.3f%%) respecto de Huffman sin límite\n",
+                       max_bits, (unsigned long long)((S.penalty_bits + 7) / 8),
+                       100.0 * (double)S.penalty_bits / (double)(payload_bits - S.penalty_bits));
+            else
+                printf("[INFO] Límite de %d bits: +%llu bytes respecto de Huffman sin límite\n",
+                       max_bits, (unsigned long long)((S.penalty_bits + 7) / 8));
+        }
         for (size_t i = 0; i < files.len; i++)
             remove(files.paths[i]);
     }
@@ -147,19 +552,19 @@ int main(int argc, char **argv)
         WARN("No se pudo escribir %s", arch_path);
     }
 
-    /* Limpieza de memoria/estructuras */
+    /* Limpieza de archivos parciales y memoria/estructuras */
     for (size_t i = 0; i < files.len; i++)
     {
+        remove_parts(&S, i);
         free(S.vec[i].name);
-        free(S.vec[i].txt);
-        for (int k = 0; k < TAM_MAX; k++)
-            free(S.vec[i].tabla[k]);
-        free(S.vec[i].tabla);
-        free(S.vec[i].bitstr);
-        free(S.vec[i].packed);
-        liberar_arbol(S.vec[i].raiz);
+        free(S.vec[i].blocks);
     }
     free(S.vec);
+    free(S.done);
+    free(S.pending);
+    free(S.hist);
+    free(S.tables);
+    free(S.assign);
     pthread_mutex_destroy(&S.mtx);
     sv_free(&files);
     clock_gettime(CLOCK_MONOTONIC, &t1);
@@ -7,111 +7,193 @@
 #include "../include/io_utils.h"
 #include "../include/huffio.h"
 #include <time.h>
+#include <fcntl.h>
 
 /* argumentos por tarea de descompresión */
 typedef struct {
-    const char   *archive_path;  /* ruta al .hfa */
+    const hfa_archive_t *archive; /* .hfa proyectado, compartido por todas las tareas */
     const char   *dir;           /* directorio de salida */
     hfa_meta_t   *meta;          /* metadatos del archivo a extraer */
+    uint32_t      first, end;    /* tarea de tramo: segmentos [first, end) de la entrada */
+    int          *failed;        /* marca de la entrada, compartida por sus tramos (atómica) */
 } task_t;
 
 /* descomprime un archivo desde el .hfa:
- * - Reconstruye árbol desde blob en RAM
- * - Lee payload desde el .hfa
- * - Desempaqueta bits a '0'/'1'
- * - Escribe el .txt resultante */
+ * - Lee el payload desde la proyección del .hfa, sin abrirlo ni copiarlo
+ * - Decodifica con la tabla de búsqueda (árbol HFA1 o longitudes canónicas HFA2)
+ * - Escribe el .txt por trozos, sin tener nunca la entrada completa en memoria */
 static void worker(void *arg){
     task_t *t = (task_t*)arg;
     const hfa_meta_t *m = t->meta;
 
-    /* 1) Árbol desde blob en memoria */
-    FILE *ftree = fmemopen((void*)m->tree_blob, m->tree_len, "rb");
-    if (!ftree) { free(t); return; }
-    struct Nodo *raiz = deserializar_arbol(ftree);
-    fclose(ftree);
-    if (!raiz) { free(t); return; }
-
-    /* 2) Leer payload del .hfa a partir del offset */
-    FILE *f = fopen(t->archive_path, "rb");
-    if (!f) { liberar_arbol(raiz); free(t); return; }
-    if (fseek(f, m->payload_off, SEEK_SET)!=0) { fclose(f); liberar_arbol(raiz); free(t); return; }
-
-    uint8_t *payload = NULL;
-    if (m->byte_count){
-        payload = (uint8_t*)malloc((size_t)m->byte_count);
-        if (!payload){ fclose(f); liberar_arbol(raiz); free(t); return; }
-        if (fread(payload,1,(size_t)m->byte_count,f)!=(size_t)m->byte_count){
-            free(payload); fclose(f); liberar_arbol(raiz); free(t); return;
-        }
-    }
-    fclose(f);
-
-    /* 3) Desempaquetar y descomprimir */
-    char *bitstr = unpack_bits_to_bitstr(payload, (size_t)m->byte_count, m->bit_count);
-    char *texto  = descomprimir_texto(raiz, bitstr, (long)m->orig_len);
+    char out_path[PATH_MAX];
+    join_path(t->dir, m->name, out_path);
+    if (hfa_extract_entry(t->archive, m, out_path) != 0)
+        __atomic_store_n(t->failed, 1, __ATOMIC_RELAXED);
+    free(t);
+}
 
-    /* 4) Escribir .txt */
-    if (texto){
-        char out_path[PATH_MAX];
-        join_path(t->dir, m->name, out_path);
-        write_file_text(out_path, texto, (size_t)m->orig_len);
-    }
+/* descomprime un tramo de una entrada grande:
+ * - Lee solo el rango del payload que cubren sus segmentos, por trozos
+ * - Lo decodifica desde el punto de sincronía o bloque inicial
+ * - Escribe el resultado con pwrite en su región del .txt ya creado */
+static void slice_worker(void *arg){
+    task_t *t = (task_t*)arg;
+    const hfa_meta_t *m = t->meta;
 
-    /* 5) Limpieza */
-    free(texto);
-    free(bitstr);
-    free(payload);
-    liberar_arbol(raiz);
+    char out_path[PATH_MAX];
+    join_path(t->dir, m->name, out_path);
+    int out_fd = open(out_path, O_WRONLY);
+    int rc = (out_fd >= 0) ? hfa_extract_segments(t->archive, m, t->first, t->end, out_fd) : -1;
+    if (out_fd >= 0 && close(out_fd) != 0) rc = -1;
+    if (rc != 0)
+        __atomic_store_n(t->failed, 1, __ATOMIC_RELAXED);
     free(t);
 }
 
 /* imprime sintaxis del binario. */
-static void usage(const char *a){ fprintf(stderr,"Uso: %s <dir> [archivo.hfa] [hilos]\n", a); }
+static void usage(const char *a){
+    fprintf(stderr,"Uso: %s <dir> [archivo.hfa] [hilos] [--table T.hft]\n"
+                   "     %s extract <archivo.hfa> <nombre...> [--out DIR] [--table T.hft]\n", a, a);
+}
+
+/* encola la extracción de una entrada: con bloques o puntos de sincronía, un tramo por hilo sobre
+   el mismo .txt; si no, una sola tarea */
+static void submit_entry(thread_pool_t *tp, const hfa_archive_t *archive, const char *dir, hfa_meta_t *m, int threads,
+                         int *failed){
+    uint32_t nseg = hfa_segment_count(m);
+    uint32_t parts = (nseg < (uint32_t)threads) ? nseg : (uint32_t)threads;
+    char out_path[PATH_MAX];
+    join_path(dir, m->name, out_path);
+    if (parts > 1 && m->method != HFA_METHOD_HUFFMAN_STREAMS && create_file_sized(out_path, m->orig_len) == 0){
+        for (uint32_t p=0;p<parts;p++){
+            task_t *t = (task_t*)calloc(1,sizeof(task_t));
+            t->archive = archive;
+            t->dir = dir;
+            t->meta = m;
+            t->first = (uint32_t)((uint64_t)nseg * p / parts);
+            t->end   = (uint32_t)((uint64_t)nseg * (p + 1) / parts);
+            t->failed = failed;
+            tp_submit(tp, slice_worker, t);
+        }
+        return;
+    }
+
+    task_t *t = (task_t*)calloc(1,sizeof(task_t));
+    t->archive = archive;
+    t->dir = dir;
+    t->meta = m;
+    t->failed = failed;
+    tp_submit(tp, worker, t);
+}
 
 /* coordina descompresión paralela:
- * - Indexa el .hfa y obtiene metadatos
- * - Lanza tareas por archivo y espera
- * - Borra el .hfa si todo salió bien
+ * - Indexa el .hfa y lo proyecta una vez para todas las tareas
+ * - Lanza tareas por archivo (por tramos si la entrada tiene varios segmentos) y espera
+ * - Borra el .hfa solo si todas las tareas salieron bien
+ * - Con "extract" busca por nombre solo las entradas pedidas, las restaura junto al .hfa (o en --out)
+ *   y no lo borra
  * - Mide y reporta tiempo total en ms */
 int main(int argc,char **argv){
     struct timespec t0, t1;
     clock_gettime(CLOCK_MONOTONIC, &t0);
-    if (argc < 2){ usage(argv[0]); return 1; }
-    const char *dir = argv[1];
 
-    char archive_path[PATH_MAX];
-    if (argc >= 3) strncpy(archive_path, argv[2], PATH_MAX-1);
-    else           join_path(dir, "archive.hfa", archive_path);
+    /* opciones y argumentos posicionales; las tablas entrenadas se cargan antes de crear el pool */
+    int extract = (argc >= 2 && strcmp(argv[1], "extract") == 0);
+    const char *pos[3] = {0};
+    const char **names = (const char**)calloc((size_t)argc, sizeof(char*));
+    const char *out_dir = NULL;
+    int npos = 0, nnames = 0;
+    for (int i = extract ? 2 : 1; i < argc; i++){
+        if (strcmp(argv[i], "--table") == 0 && i + 1 < argc){
+            if (!hfa_load_table(argv[++i])){ WARN("No se pudo cargar la tabla %s", argv[i]); free(names); return 1; }
+        }
+        else if (extract && strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_dir = argv[++i];
+        else if (argv[i][0] == '-' || (!extract && npos == 3)){ usage(argv[0]); free(names); return 1; }
+        else if (extract && npos == 1) names[nnames++] = argv[i];
+        else pos[npos++] = argv[i];
+    }
+    if (npos < 1 || (extract && nnames == 0)){ usage(argv[0]); free(names); return 1; }
+
+    char archive_path[PATH_MAX], dir_buf[PATH_MAX];
+    const char *dir = pos[0];
+    if (extract){
+        /* extract: pos[0] es el .hfa y, sin --out, se restaura en su directorio */
+        strncpy(archive_path, pos[0], PATH_MAX-1);
+        archive_path[PATH_MAX-1] = '\0';
+        if (!out_dir){
+            strcpy(dir_buf, archive_path);
+            char *slash = strrchr(dir_buf, '/');
+            if (slash) *(slash == dir_buf ? slash + 1 : slash) = '\0';
+            else strcpy(dir_buf, ".");
+            out_dir = dir_buf;
+        }
+        dir = out_dir;
+    }
+    else if (npos >= 2) strncpy(archive_path, pos[1], PATH_MAX-1);
+    else                join_path(dir, "archive.hfa", archive_path);
 
-    int threads = (argc >= 4) ? atoi(argv[3]) : num_cpus();
+    int threads = (!extract && npos >= 3) ? atoi(pos[2]) : num_cpus();
     if (threads <= 0) threads = 2;
 
     /* 1) Indexar metadatos del archivo .hfa */
     hfa_meta_t *meta = NULL; uint32_t n = 0;
-    if (hfa_index(archive_path, &meta, &n)!=0){ WARN("No se pudo indexar %s", archive_path); return 1; }
-    if (n == 0){ WARN("Archivo vacío: %s", archive_path); hfa_free_index(meta, n); return 0; }
+    if (hfa_index(archive_path, &meta, &n)!=0){ WARN("No se pudo indexar %s", archive_path); free(names); return 1; }
+    if (n == 0 && !extract){ WARN("Archivo vacío: %s", archive_path); hfa_free_index(meta, n); free(names); return 0; }
+
+    /* extract: resolver los nombres con la tabla hash antes de tocar el .hfa */
+    uint32_t *sel = NULL, nsel = n;
+    int missing = 0;
+    if (extract){
+        hfa_lookup_t lookup;
+        sel = (uint32_t*)malloc((size_t)nnames * sizeof(uint32_t));
+        if (!sel || hfa_lookup_build(meta, n, &lookup)!=0){ WARN("Sin memoria"); free(sel); hfa_free_index(meta, n); free(names); return 1; }
+        nsel = 0;
+        for (int k=0;k<nnames;k++){
+            uint32_t i = hfa_lookup(&lookup, meta, names[k]);
+            if (i == UINT32_MAX){ WARN("%s no está en %s", names[k], archive_path); missing = 1; }
+            else sel[nsel++] = i;
+        }
+        hfa_lookup_free(&lookup);
+    }
+    free(names);
+
+    hfa_archive_t archive;
+    if (hfa_archive_open(archive_path, &archive)!=0){ WARN("No se pudo abrir %s", archive_path); free(sel); hfa_free_index(meta, n); return 1; }
 
     /* 2) Ejecutar tareas en pool */
     thread_pool_t tp;
-    if (tp_init(&tp, threads)!=0){ WARN("No se pudo crear pool"); hfa_free_index(meta, n); return 1; }
-
-    for (uint32_t i=0;i<n;i++){
-        task_t *t = (task_t*)calloc(1,sizeof(task_t));
-        t->archive_path = archive_path;
-        t->dir = dir;
-        t->meta = &meta[i];
-        tp_submit(&tp, worker, t);
-    }
+    if (tp_init(&tp, threads)!=0){ WARN("No se pudo crear pool"); hfa_archive_close(&archive); free(sel); hfa_free_index(meta, n); return 1; }
+
+    int *failed = (int*)calloc(nsel ? nsel : 1, sizeof(int));
+    if (!failed){ WARN("Sin memoria"); tp_destroy(&tp); hfa_archive_close(&archive); free(sel); hfa_free_index(meta, n); return 1; }
+    for (uint32_t k=0;k<nsel;k++)
+        submit_entry(&tp, &archive, dir, &meta[sel ? sel[k] : k], threads, &failed[k]);
 
     tp_wait(&tp);
     tp_destroy(&tp);
-
-    /* 3) Eliminar el .hfa y liberar índice */
-    remove(archive_path);
+    hfa_archive_close(&archive);
+
+    /* 3) Eliminar el .hfa (no en extract ni si alguna entrada falló) y liberar índice */
+    uint32_t restored = 0;
+    for (uint32_t k=0;k<nsel;k++)
+        if (!failed[k]) restored++;
+    free(failed);
+    if (restored < nsel){
+        WARN("No se pudieron restaurar %u entradas de %s en %s", nsel - restored, archive_path, dir);
+        missing = 1;
+    }
+    if (extract)
+        printf("[%s] Se restauraron %u de %d archivos pedidos de %s en %s\n", missing ? "WARN" : "OK",
+               restored, nnames, archive_path, dir);
+    else if (!missing){
+        remove(archive_path);
+        printf("[OK] Se restauraron %u archivos y se borro %s\n", n, archive_path);
+    }
+    free(sel);
     hfa_free_index(meta, n);
 
-    printf("[OK] Se restauraron %u archivos y se borro %s\n", n, archive_path);
     clock_gettime(CLOCK_MONOTONIC, &t1);
     printf("Tiempo de descompresión: %ld ms\n", elapsed_ms(t0,t1));
-    return 0;
+    return missing;
 }
@@ -1,16 +1,35 @@
+#define _GNU_SOURCE   /* copy_file_range */
 /* ===============================================================================================================
- * huffio.c — Implementa el formato .hfa (archivo único) y utilidades de empaquetado/desempaquetado de bits.
+ * huffio.c — Implementa el formato .hfa (archivo único): escritura HFA2 y lectura de HFA1/HFA2.
  * =============================================================================================================== */
 
 #include "../include/huffio.h"
 #include "../include/io_utils.h"
 #include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 /* helpers para escribir/leerdatos enteros en binario. */
 static void put_u16(FILE *f, uint16_t v){ fwrite(&v, sizeof(v), 1, f); }
 static void put_u64(FILE *f, uint64_t v){ fwrite(&v, sizeof(v), 1, f); }
+static void put_u8(FILE *f, uint8_t v){ fwrite(&v, sizeof(v), 1, f); }
+static void put_u32(FILE *f, uint32_t v){ fwrite(&v, sizeof(v), 1, f); }
 static uint16_t get_u16(FILE *f){ uint16_t v; fread(&v,sizeof(v),1,f); return v; }
+static uint8_t get_u8(FILE *f){ uint8_t v = 0; fread(&v,sizeof(v),1,f); return v; }
 static uint64_t get_u64(FILE *f){ uint64_t v; fread(&v,sizeof(v),1,f); return v; }
+static uint32_t get_u32(FILE *f){ uint32_t v = 0; fread(&v,sizeof(v),1,f); return v; }
+
+/* FNV-1a de 32 bits: id de las tablas y checksum del directorio central */
+#define FNV_BASE 2166136261u
+static uint32_t fnv1a(uint32_t h, const void *data, size_t n){
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i=0;i<n;i++){
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
 
 /* avanza el cursor del FILE* siguiendo el formato de serialización del árbol */
 static int skip_tree(FILE *f) {
@@ -56,42 +75,236 @@ static int read_tree_blob(FILE *f, uint8_t **out, size_t *out_len) {
     return 0;
 }
 
-/* recorre el .hfa y construye un índice con metadatos y blobs de árbol para cada archivo. */
-int hfa_index(const char *archive_path, hfa_meta_t **out_meta, uint32_t *out_nfiles) {
-    FILE *f = fopen(archive_path, "rb");
-    if (!f) return -1;
+/* lee la cabecera de longitudes de una entrada HFA2 (prefijada con su tamaño) en un buffer nuevo. */
+static int read_lengths_blob(FILE *f, uint8_t **out, size_t *out_len, size_t max_len) {
+    uint16_t len = get_u16(f);
+    if (len > max_len || (len == 0 && max_len != 0)) return -1;
+    if (len == 0){ *out = NULL; *out_len = 0; return 0; }   /* entrada almacenada: sin cabecera */
 
-    hfa_header_t hdr;
-    if (fread(&hdr,sizeof(hdr),1,f)!=1 || memcmp(hdr.magic,"HFA1",4)!=0) { fclose(f); return -1; }
+    uint8_t *buf = (uint8_t*)malloc(len);
+    if (!buf) return -1;
+    if (fread(buf,1,len,f)!=len) { free(buf); return -1; }
+
+    *out = buf; *out_len = len;
+    return 0;
+}
 
-    hfa_meta_t *M = (hfa_meta_t*)calloc(hdr.nfiles, sizeof(hfa_meta_t));
-    if (!M) { fclose(f); return -1; }
+/* lee la tabla de bloques de una entrada en modo bloques y la valida contra el tamaño original. */
+static int read_block_table(FILE *f, hfa_meta_t *m) {
+    m->block_size = get_u32(f);
+    m->nblocks    = get_u32(f);
+    if (m->block_size == 0) return -1;
+    if ((uint64_t)m->nblocks != (m->orig_len + m->block_size - 1) / m->block_size) return -1;
 
-    for (uint32_t i=0;i<hdr.nfiles;i++){
-        uint16_t name_len = get_u16(f);
-        M[i].name = (char*)malloc(name_len+1);
-        if (!M[i].name){ fclose(f); hfa_free_index(M,i); return -1; }
-        fread(M[i].name,1,name_len,f); M[i].name[name_len]='\0';
+    m->block_off = (uint64_t*)malloc(((size_t)m->nblocks + 1) * sizeof(uint64_t));
+    if (!m->block_off) return -1;
+    if (fread(m->block_off, sizeof(uint64_t), (size_t)m->nblocks + 1, f) != (size_t)m->nblocks + 1) return -1;
+    if (m->block_off[0] != 0) return -1;
+    for (uint32_t b = 0; b < m->nblocks; b++)
+        if (m->block_off[b+1] < m->block_off[b]) return -1;
+    return 0;
+}
 
-        M[i].orig_len   = get_u64(f);
+/* lee la tabla de puntos de sincronía de una entrada de flujo único; los offsets deben ser crecientes. */
+static int read_sync_table(FILE *f, hfa_meta_t *m) {
+    m->sync_interval = get_u32(f);
+    m->nsync         = get_u32(f);
+    if (m->sync_interval == 0 || m->orig_len == 0) return -1;
+    if ((uint64_t)m->nsync != (m->orig_len - 1) / m->sync_interval) return -1;
 
-        /* copiar árbol serializado como blob para reconstruirlo por hilo */
-        if (read_tree_blob(f, &M[i].tree_blob, &M[i].tree_len)!=0) {
-            fclose(f); hfa_free_index(M,i+1); return -1;
-        }
+    m->sync_bits = (uint64_t*)malloc(m->nsync ? (size_t)m->nsync * sizeof(uint64_t) : 1);
+    if (!m->sync_bits) return -1;
+    if (fread(m->sync_bits, sizeof(uint64_t), m->nsync, f) != m->nsync) return -1;
+    for (uint32_t k = 1; k < m->nsync; k++)
+        if (m->sync_bits[k] < m->sync_bits[k-1]) return -1;
+    return 0;
+}
+
+/* tablas cargadas con hfa_load_table o desde la sección de un HFA3 (hfa_index): cada una arma su
+   tabla de decodificación una vez y la comparten todas las entradas que la usan. Se cargan antes de
+   lanzar hilos o procesos y después solo se leen */
+static hfa_table_t *g_tables[HFA_TABLES_MAX];
+static uint32_t g_ntables;
+
+#define HFA_CLUSTER_ROUNDS 8   /* vueltas de refinamiento de hfa_cluster_tables */
+
+static const hfa_table_t *read_table(FILE *f);
+
+/* busca la tabla que referencia la cabecera de una entrada o bloque entrenado (el id en u32) */
+static const hfa_table_t *trained_table(const uint8_t *blob, size_t blob_len){
+    uint32_t id;
+    if (blob_len != sizeof(id)) return NULL;
+    memcpy(&id, blob, sizeof(id));
+    for (uint32_t i=0;i<g_ntables;i++)
+        if (g_tables[i]->id == id) return g_tables[i];
+    return NULL;
+}
+
+/* cabecera de una entrada o bloque entrenado: solo el id de la tabla */
+static size_t write_table_id(const hfa_table_t *t, uint8_t *out){
+    memcpy(out, &t->id, sizeof(t->id));
+    return sizeof(t->id);
+}
 
-        M[i].bit_count  = get_u64(f);
-        M[i].byte_count = get_u64(f);
-        M[i].payload_off= ftell(f);
-        if (M[i].payload_off < 0) { fclose(f); hfa_free_index(M,i+1); return -1; }
+/* lee la cabecera de una entrada HFA1/HFA2 (todo menos el payload) y deja el cursor al inicio del payload */
+static int read_entry(FILE *f, uint8_t version, hfa_meta_t *m){
+    uint16_t name_len = get_u16(f);
+    m->name = (char*)malloc(name_len+1);
+    if (!m->name) return -1;
+    if (fread(m->name,1,name_len,f)!=name_len) return -1;
+    m->name[name_len]='\0';
+
+    m->orig_len = get_u64(f);
+    m->version  = version;
+
+    /* HFA1: copiar el árbol serializado recorriéndolo; HFA2: saltar la cabecera por tamaño */
+    int rc;
+    if (version == 1) {
+        m->method = HFA_METHOD_HUFFMAN;
+        rc = read_tree_blob(f, &m->tree_blob, &m->tree_len);
+    } else {
+        uint8_t method = get_u8(f);
+        m->method = method & HFA_METHOD_MASK;
+        rc = read_lengths_blob(f, &m->tree_blob, &m->tree_len,
+                               m->method == HFA_METHOD_HUFFMAN_CONTEXT ? HUF_CABECERA_CONTEXTO_MAX :
+                               m->method == HFA_METHOD_HUFFMAN_WORDS   ? HUF_CABECERA_PALABRAS_MAX :
+                               m->method == HFA_METHOD_ANS             ? HUF_CABECERA_ANS_MAX :
+                               m->method == HFA_METHOD_STORED          ? 0 :
+                               m->method == HFA_METHOD_LZ77            ? HUF_CABECERA_LZ_MAX :
+                               m->method == HFA_METHOD_TRAINED         ? sizeof(uint32_t) : HUF_CABECERA_MAX);
+        if (rc==0 && m->method == HFA_METHOD_HUFFMAN_BLOCKS)
+            rc = read_block_table(f, m);
+        if (rc==0 && (method & HFA_FLAG_SYNC))
+            rc = (m->method == HFA_METHOD_HUFFMAN || m->method == HFA_METHOD_TRAINED)
+                     ? read_sync_table(f, m) : -1;
+    }
+    if (rc!=0) return -1;
+
+    m->bit_count  = get_u64(f);
+    m->byte_count = get_u64(f);
+    if (m->block_off && m->block_off[m->nblocks] != m->byte_count) return -1;
+    if (m->nsync && (m->sync_bits[m->nsync-1] > m->bit_count ||
+                     (m->bit_count + 7) / 8 > m->byte_count)) return -1;
+    return (feof(f) || ferror(f)) ? -1 : 0;
+}
+
+/* índice desde el directorio central: el trailer se valida contra el tamaño del archivo y el header,
+   el directorio se lee de una vez y cada registro se parsea en memoria con read_entry. Las entradas
+   deben quedar contiguas desde 'entries_off' hasta el directorio; si algo no cierra devuelve NULL y
+   hfa_index recorre el archivo */
+static hfa_meta_t *index_from_directory(FILE *f, uint8_t version, uint32_t n, long entries_off){
+    hfa_trailer_t tr;
+    if (fseek(f, 0, SEEK_END)!=0) return NULL;
+    long size = ftell(f);
+    if (size < entries_off + (long)sizeof(tr)) return NULL;
+    if (fseek(f, size - (long)sizeof(tr), SEEK_SET)!=0 || fread(&tr,sizeof(tr),1,f)!=1) return NULL;
+    if (memcmp(tr.magic,HFA_DIR_MAGIC,4)!=0 || tr.nfiles != n || tr.dir_off < (uint64_t)entries_off ||
+        tr.dir_len > (uint64_t)size || tr.dir_off + tr.dir_len + sizeof(tr) != (uint64_t)size) return NULL;
+
+    uint8_t *dir = (uint8_t*)malloc(tr.dir_len ? (size_t)tr.dir_len : 1);
+    hfa_meta_t *M = (hfa_meta_t*)calloc(n ? n : 1, sizeof(hfa_meta_t));
+    FILE *mem = NULL;
+    uint32_t i = 0;
+    int ok = dir && M && fseek(f, (long)tr.dir_off, SEEK_SET)==0 &&
+             fread(dir,1,(size_t)tr.dir_len,f)==(size_t)tr.dir_len &&
+             fnv1a(FNV_BASE, dir, (size_t)tr.dir_len) == tr.checksum &&
+             (n == 0 || (mem = fmemopen(dir, (size_t)tr.dir_len, "rb")) != NULL);
+
+    uint64_t next = (uint64_t)entries_off;   /* donde tiene que empezar la entrada siguiente */
+    for (; ok && i<n; i++){
+        uint64_t entry_off   = get_u64(mem);
+        uint64_t payload_off = get_u64(mem);
+        long start = ftell(mem);
+        ok = entry_off == next && payload_off > entry_off && read_entry(mem, version, &M[i])==0 &&
+             (uint64_t)(ftell(mem) - start) == payload_off - entry_off &&
+             M[i].byte_count <= tr.dir_off - payload_off;
+        M[i].payload_off = (long)payload_off;
+        next = payload_off + M[i].byte_count;
+    }
+    if (ok && n) ok = (uint64_t)ftell(mem) == tr.dir_len && next == tr.dir_off;
+
+    if (mem) fclose(mem);
+    free(dir);
+    if (!ok){ hfa_free_index(M, i); return NULL; }
+    return M;
+}
+
+/* índice recorriendo el archivo entrada por entrada (HFA1 o archivos sin directorio central) */
+static hfa_meta_t *index_by_scan(FILE *f, uint8_t version, uint32_t n, long entries_off){
+    hfa_meta_t *M = (hfa_meta_t*)calloc(n ? n : 1, sizeof(hfa_meta_t));
+    if (!M || fseek(f, entries_off, SEEK_SET)!=0){ free(M); return NULL; }
+
+    for (uint32_t i=0;i<n;i++){
+        if (read_entry(f, version, &M[i])!=0) { hfa_free_index(M,i+1); return NULL; }
+        M[i].payload_off = ftell(f);
+        if (M[i].payload_off < 0) { hfa_free_index(M,i+1); return NULL; }
 
         /* saltar datos de payload para ubicar siguiente entrada */
-        if (fseek(f, (long)M[i].byte_count, SEEK_CUR)!=0) { fclose(f); hfa_free_index(M,i+1); return -1; }
+        if (fseek(f, (long)M[i].byte_count, SEEK_CUR)!=0) { hfa_free_index(M,i+1); return NULL; }
+    }
+    return M;
+}
+
+/* lee el header (y la sección de tablas de un HFA3) y las entradas tal como están en el archivo:
+   desde el directorio central si lo hay, si no recorriéndolas. Deja la versión de las entradas
+   (1 o 2), la cantidad del header y el offset de la primera entrada */
+static hfa_meta_t *load_entries(FILE *f, uint8_t *version, uint32_t *n, long *entries_off){
+    hfa_header_t hdr;
+    if (fread(&hdr,sizeof(hdr),1,f)!=1) return NULL;
+    if (memcmp(hdr.magic,HFA_MAGIC_V1,4)==0)      *version = 1;
+    else if (memcmp(hdr.magic,HFA_MAGIC_V2,4)==0) *version = 2;
+    else if (memcmp(hdr.magic,HFA_MAGIC_V3,4)==0) *version = 3;
+    else return NULL;
+
+    /* HFA3: las tablas compartidas se registran (y arman) una sola vez; las entradas son de HFA2 */
+    if (*version == 3){
+        uint32_t nt = get_u32(f);
+        if (nt > HFA_TABLES_MAX) return NULL;
+        for (uint32_t j=0;j<nt;j++)
+            if (!read_table(f)) return NULL;
+        *version = 2;
     }
 
+    *n = hdr.nfiles;
+    *entries_off = ftell(f);
+    hfa_meta_t *M = (*version == 2) ? index_from_directory(f, *version, *n, *entries_off) : NULL;
+    return M ? M : index_by_scan(f, *version, *n, *entries_off);
+}
+
+/* construye el índice del .hfa con metadatos y la cabecera de códigos de cada archivo. Una entrada
+   agregada después con el mismo nombre (hfa_append_open) reemplaza a la anterior, que no aparece */
+int hfa_index(const char *archive_path, hfa_meta_t **out_meta, uint32_t *out_nfiles) {
+    FILE *f = fopen(archive_path, "rb");
+    if (!f) return -1;
+    uint8_t version; uint32_t n; long entries_off;
+    hfa_meta_t *M = load_entries(f, &version, &n, &entries_off);
     fclose(f);
+    if (!M) return -1;
+
+    hfa_lookup_t h;
+    if (hfa_lookup_build(M, n, &h)!=0){ hfa_free_index(M, n); return -1; }
+    uint32_t k = 0;
+    for (uint32_t i=0;i<n;i++){
+        if (hfa_lookup(&h, M, M[i].name) != i){
+            /* reemplazada: la tabla hash quedó apuntando a una entrada posterior */
+            free(M[i].name); free(M[i].tree_blob); free(M[i].block_off); free(M[i].sync_bits);
+            M[i].name = NULL;
+        }
+    }
+    hfa_lookup_free(&h);
+    for (uint32_t i=0;i<n;i++)
+        if (M[i].name) M[k++] = M[i];
+    n = k;
+
+    for (uint32_t i=0;i<n;i++){
+        if (M[i].method == HFA_METHOD_TRAINED && !trained_table(M[i].tree_blob, M[i].tree_len)){
+            fprintf(stderr, "%s usa una tabla entrenada que no se cargó (--table)\n", M[i].name);
+            hfa_free_index(M, n);
+            return -1;
+        }
+    }
     *out_meta   = M;
-    *out_nfiles = hdr.nfiles;
+    *out_nfiles = n;
     return 0;
 }
 
@@ -101,107 +314,1819 @@ void hfa_free_index(hfa_meta_t *M, uint32_t n){
     for (uint32_t i=0;i<n;i++){
         free(M[i].name);
         free(M[i].tree_blob);
+        free(M[i].block_off);
+        free(M[i].sync_bits);
     }
     free(M);
 }
 
-/* empaqueta un string de '0'/'1' en un buffer de bytes */
-void pack_bits_from_bitstr(const char *bitstr, uint8_t **out, size_t *out_len, uint64_t *out_bit_count){
-    uint64_t bits = (uint64_t)strlen(bitstr);
-    size_t bytes = (size_t)((bits + 7) / 8);
-    uint8_t *buf = (uint8_t*)calloc(bytes ? bytes : 1, 1);
-    uint64_t b = 0;
-    for (; bitstr[b]; ++b){
-        if (bitstr[b] == '1'){
-            size_t byte = (size_t)(b >> 3);
-            int    off  = 7 - (b & 7);
-            buf[byte] |= (1u << off);
+/* tabla hash abierta sobre los nombres del índice (FNV-1a, sondeo lineal): cada ranura guarda el
+   número de entrada + 1. Con nombres repetidos gana la última, que es la agregada más tarde */
+int hfa_lookup_build(const hfa_meta_t *M, uint32_t n, hfa_lookup_t *h){
+    uint32_t cap = 16;
+    while (cap < 2 * (uint64_t)n) cap <<= 1;
+    h->slots = (uint32_t*)calloc(cap, sizeof(uint32_t));
+    if (!h->slots) return -1;
+    h->mask = cap - 1;
+    for (uint32_t i=0;i<n;i++){
+        uint32_t s = fnv1a(FNV_BASE, M[i].name, strlen(M[i].name)) & h->mask;
+        while (h->slots[s] && strcmp(M[h->slots[s]-1].name, M[i].name) != 0) s = (s + 1) & h->mask;
+        h->slots[s] = i + 1;
+    }
+    return 0;
+}
+
+/* número de entrada con ese nombre o UINT32_MAX si no está */
+uint32_t hfa_lookup(const hfa_lookup_t *h, const hfa_meta_t *M, const char *name){
+    uint32_t s = fnv1a(FNV_BASE, name, strlen(name)) & h->mask;
+    while (h->slots[s]){
+        if (strcmp(M[h->slots[s]-1].name, name) == 0) return h->slots[s] - 1;
+        s = (s + 1) & h->mask;
+    }
+    return UINT32_MAX;
+}
+
+/* libera la tabla de hfa_lookup_build */
+void hfa_lookup_free(hfa_lookup_t *h){
+    free(h->slots);
+    h->slots = NULL;
+}
+
+/* escribe la cabecera de una entrada HFA2: todo menos los bytes del payload */
+int hfa_write_entry_header(FILE *f, const hfa_entry_t *e){
+    size_t name_len = strlen(e->name);
+    if (name_len > UINT16_MAX) return -1;
+
+    uint8_t lengths[HUF_CABECERA_PALABRAS_MAX];
+    size_t lengths_len = (e->method == HFA_METHOD_HUFFMAN_CONTEXT) ? escribir_modelo_contexto(e->model, lengths)
+                       : (e->method == HFA_METHOD_HUFFMAN_WORDS)   ? escribir_alfabeto_palabras(e->alphabet, lengths)
+                       : (e->method == HFA_METHOD_ANS)             ? escribir_modelo_ans(e->ans, lengths)
+                       : (e->method == HFA_METHOD_STORED)          ? 0
+                       : (e->method == HFA_METHOD_LZ77)            ? escribir_modelo_lz(e->lz, lengths)
+                       : (e->method == HFA_METHOD_TRAINED)         ? write_table_id(e->table, lengths)
+                                                                   : escribir_longitudes(e->code_len, lengths);
+
+    put_u16(f, (uint16_t)name_len);
+    fwrite(e->name, 1, name_len, f);
+    put_u64(f, (uint64_t)e->txt_len);
+
+    put_u8(f, e->nsync ? (uint8_t)(e->method | HFA_FLAG_SYNC) : e->method);
+    put_u16(f, (uint16_t)lengths_len);
+    fwrite(lengths, 1, lengths_len, f);
+
+    if (e->nsync){
+        /* tabla de sincronía: intervalo, cantidad y el bit de inicio de cada punto */
+        put_u32(f, e->sync_interval);
+        put_u32(f, e->nsync);
+        if (fwrite(e->sync_bits, sizeof(uint64_t), e->nsync, f)!=e->nsync) return -1;
+    }
+
+    if (e->method == HFA_METHOD_HUFFMAN_BLOCKS){
+        /* tabla de bloques: offsets acumulados relativos al inicio del payload */
+        uint64_t off = 0, bits = 0;
+        put_u32(f, e->block_size);
+        put_u32(f, e->nblocks);
+        put_u64(f, 0);
+        for (uint32_t b=0;b<e->nblocks;b++){
+            off  += e->blocks[b].len;
+            bits += e->blocks[b].bit_count;
+            put_u64(f, off);
         }
+        put_u64(f, bits);
+        put_u64(f, off);
+        return ferror(f) ? -1 : 0;
     }
-    *out = buf; *out_len = bytes; *out_bit_count = bits;
+
+    put_u64(f, e->bit_count);
+    put_u64(f, (uint64_t)e->packed_len);
+    return ferror(f) ? -1 : 0;
 }
 
-/* expande bytes a un string de '0'/'1' */
-char* unpack_bits_to_bitstr(const uint8_t *buf, size_t len, uint64_t bit_count){
-    (void)len;
-    char *s = (char*)malloc((size_t)bit_count + 1);
-    for (uint64_t b=0;b<bit_count;b++){
-        size_t byte = (size_t)(b >> 3);
-        int    off  = 7 - (b & 7);
-        s[b] = (buf[byte] & (1u << off)) ? '1' : '0';
+/* escribe una entrada HFA2 completa: cabecera y payload (o los bloques en orden) */
+int hfa_write_entry(FILE *f, const hfa_entry_t *e){
+    if (hfa_write_entry_header(f, e)!=0) return -1;
+    if (e->method == HFA_METHOD_HUFFMAN_BLOCKS){
+        for (uint32_t b=0;b<e->nblocks;b++){
+            if (fwrite(e->blocks[b].data, 1, e->blocks[b].len, f)!=e->blocks[b].len) return -1;
+        }
+    } else if (e->packed_len){
+        if (fwrite(e->packed, 1, e->packed_len, f)!=e->packed_len) return -1;
     }
-    s[bit_count] = '\0';
-    return s;
+    return ferror(f) ? -1 : 0;
 }
 
-/* escribe el archivo .hfa con N entradas */
-int hfa_write(const char *archive_path, hfa_entry_t *E, uint32_t n){
-    FILE *f = fopen(archive_path, "wb");
-    if (!f) return -1;
+/* decide si conviene la tabla entrenada: los bits salen del histograma con las longitudes de la
+   tabla y la cabecera es solo el id. Si ocupa menos que *bits / *hdr, los reemplaza y devuelve 1 */
+static int choose_trained(const uint64_t *freq, const hfa_table_t *t, uint64_t *bits, size_t *hdr){
+    uint64_t trained = 0;
+    for (int c=0;c<TAM_MAX;c++) trained += freq[c] * t->code_len[c];
+    if ((trained + 7) / 8 + sizeof(t->id) >= (*bits + 7) / 8 + *hdr) return 0;
+    *bits = trained;
+    *hdr = sizeof(t->id);
+    return 1;
+}
 
-    hfa_header_t hdr; memcpy(hdr.magic,"HFA1",4); hdr.nfiles=n;
-    fwrite(&hdr,sizeof(hdr),1,f);
+/* decide si conviene el modo de contexto de orden 1: arma el modelo desde el histograma de orden 1
+   y devuelve 1 si payload y cabecera ocupan menos que con el código único (bits0, hdr0 bytes de longitudes).
+   En *hdr deja el tamaño de la cabecera del modelo */
+static int choose_context(const uint64_t *freq1, int contexts, int max_bits, uint64_t bits0, size_t hdr0,
+                          struct ModeloContexto *model, uint64_t *bits, size_t *hdr){
+    uint8_t blob[HUF_CABECERA_CONTEXTO_MAX];
+    if (construir_modelo_contexto(freq1, contexts, max_bits, model, bits) != 0) return 0;
+    *hdr = escribir_modelo_contexto(model, blob);
+    return (*bits + 7) / 8 + *hdr < (bits0 + 7) / 8 + hdr0;
+}
 
-    for (uint32_t i=0;i<n;i++){
-        size_t name_len = strlen(E[i].name);
-        if (name_len > UINT16_MAX){ fclose(f); return -1; }
+/* decide si conviene ANS: normaliza el histograma y devuelve 1 si el tamaño estimado de payload y
+   cabecera queda por debajo del de Huffman (bits0, hdr0), o siempre con HFA_CODEC_ANS. Si lo elige
+   deja la estimación en *bytes */
+static int choose_ans(const uint64_t *freq, int codec, uint64_t bits0, size_t hdr0, struct ModeloANS *model,
+                      uint64_t *bytes){
+    uint8_t blob[HUF_CABECERA_ANS_MAX];
+    if (normalizar_modelo_ans(freq, model) != 0) return 0;
+    uint64_t est = (estimar_bits_ans(freq, model) + 7) / 8 + escribir_modelo_ans(model, blob);
+    if (codec != HFA_CODEC_ANS && est >= (bits0 + 7) / 8 + hdr0) return 0;
+    *bytes = est;
+    return 1;
+}
 
-        put_u16(f, (uint16_t)name_len);
-        fwrite(E[i].name, 1, name_len, f);
-        put_u64(f, (uint64_t)E[i].txt_len);
+/* alfabeto extendido: arma el diccionario y codifica 'data' en memoria. Devuelve 1 con el payload
+   en *packed si payload y cabecera ocupan menos que *best bytes (y deja ese total en *best), 0 si
+   no conviene y -1 si falla */
+static int try_words(const unsigned char *data, size_t len, const hfa_opts_t *o, uint64_t *best,
+                     struct AlfabetoPalabras *alphabet, uint8_t **packed, size_t *packed_len, uint64_t *bit_count){
+    uint8_t *blob = (uint8_t*)malloc(HUF_CABECERA_PALABRAS_MAX);
+    uint64_t bits;
+    int rc = -1;
+    if (blob && construir_alfabeto_palabras(data, len, o->words, o->max_bits, alphabet, &bits) == 0){
+        size_t hdr = escribir_alfabeto_palabras(alphabet, blob);
+        rc = 0;
+        if ((bits + 7) / 8 + hdr < *best){
+            *packed = codificar_palabras(data, len, alphabet, packed_len, bit_count);
+            rc = *packed ? 1 : -1;
+            if (rc == 1) *best = *packed_len + hdr;
+        }
+    }
+    free(blob);
+    return rc;
+}
+
+/* LZ77 + Huffman: codifica 'data' en memoria con el nivel y la ventana pedidos. Devuelve 1 con el
+   payload en *packed si payload y cabecera ocupan menos que *best bytes (y deja ese total en *best),
+   0 si no conviene */
+static int try_lz(const unsigned char *data, size_t len, const hfa_opts_t *o, uint64_t *best,
+                  struct ModeloLZ *model, uint8_t **packed, size_t *packed_len, uint64_t *bit_count){
+    size_t out_len;
+    uint64_t bits;
+    uint8_t *out = comprimir_lz77(data, len, o->level, o->window ? o->window : LZ_VENTANA_DEFECTO, model,
+                                  &out_len, &bits);
+    if (!out) return 0;
+    if (out_len + HUF_CABECERA_LZ_MAX >= *best){
+        free(out);
+        return 0;
+    }
+    *packed = out;
+    *packed_len = out_len;
+    *bit_count = bits;
+    *best = out_len + HUF_CABECERA_LZ_MAX;
+    return 1;
+}
 
-        /* árbol serializado */
-        serializar_arbol(E[i].raiz, f);
+/* entrada con alfabeto extendido o LZ77: el archivo se codifica en memoria (como los sub-flujos)
+   con cada etapa pedida y gana la más chica. Devuelve 1 sin escribir nada si ninguna queda más
+   chica que el código de bytes */
+static int compress_in_memory(FILE *f, const char *path, const char *name, const hfa_opts_t *o,
+                              uint64_t *bit_count, uint64_t *penalty){
+    char *txt = NULL;
+    size_t len = 0;
+    if (read_file_text(path, &txt, &len) != 0) return -1;
 
-        /* datos empaquetados */
-        put_u64(f, E[i].bit_count);
-        put_u64(f, (uint64_t)E[i].packed_len);
-        if (E[i].packed_len){
-            fwrite(E[i].packed, 1, E[i].packed_len, f);
+    uint64_t freq[TAM_MAX] = {0};
+    acumular_histograma((const unsigned char*)txt, len, freq);
+    hfa_entry_t e;
+    memset(&e, 0, sizeof(e));
+    struct TablaCodigos tabla;
+    uint8_t lengths[HUF_CABECERA_MAX];
+    struct AlfabetoPalabras *alphabet = o->words ? (struct AlfabetoPalabras*)malloc(sizeof(*alphabet)) : NULL;
+    struct ModeloLZ *lz = o->level ? (struct ModeloLZ*)malloc(sizeof(*lz)) : NULL;
+    int rc = -1;
+    if ((alphabet || !o->words) && (lz || !o->level) &&
+        generar_codigos_canonicos(freq, o->max_bits, e.code_len, &tabla, NULL) == 0){
+        uint64_t bits0 = 0;
+        for (int c=0;c<TAM_MAX;c++) bits0 += freq[c] * tabla.longitud[c];
+        uint64_t best = (bits0 + 7) / 8 + escribir_longitudes(e.code_len, lengths);
+        rc = 0;
+        if (alphabet){
+            rc = try_words((const unsigned char*)txt, len, o, &best, alphabet, &e.packed, &e.packed_len, &e.bit_count);
+            if (rc == 1) e.method = HFA_METHOD_HUFFMAN_WORDS;
         }
+        uint8_t *lz_packed = NULL;
+        size_t lz_len = 0;
+        uint64_t lz_bits = 0;
+        if (rc >= 0 && lz && try_lz((const unsigned char*)txt, len, o, &best, lz, &lz_packed, &lz_len, &lz_bits)){
+            free(e.packed);
+            e.packed = lz_packed;
+            e.packed_len = lz_len;
+            e.bit_count = lz_bits;
+            e.method = HFA_METHOD_LZ77;
+            rc = 1;
+        }
+    }
+    if (rc == 1){
+        e.name = (char*)name;
+        e.txt_len = len;
+        e.alphabet = alphabet;
+        e.lz = lz;
+        rc = (hfa_write_entry(f, &e) == 0) ? 0 : -1;
+        if (rc == 0 && bit_count) *bit_count = e.bit_count;
+        if (rc == 0 && penalty) *penalty = 0;
+    } else if (rc == 0){
+        rc = 1;
     }
+    free(e.packed);
+    free(alphabet);
+    free(lz);
+    free(txt);
+    return rc;
+}
 
-    int rc = fclose(f);
-    return (rc==0) ? 0 : -1;
+/* entrada almacenada: los bytes del archivo van tal cual como payload, copiados por trozos */
+static int store_stream(FILE *f, FILE *in, const char *name, uint64_t orig_len, unsigned char *chunk){
+    hfa_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.name = (char*)name;
+    e.txt_len = (size_t)orig_len;
+    e.method = HFA_METHOD_STORED;
+    e.packed_len = (size_t)orig_len;
+    e.bit_count = orig_len * 8;
+    if (hfa_write_entry_header(f, &e)!=0) return -1;
+
+    rewind(in);
+    uint64_t seen = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, HFA_STREAM_CHUNK, in)) > 0){
+        seen += n;
+        if (seen > orig_len || fwrite(chunk, 1, n, f)!=n) return -1;
+    }
+    return (ferror(in) || seen != orig_len || ferror(f)) ? -1 : 0;
 }
 
-/* descomprime secuencialmente un .hfa a .txt y elimina el .hfa si tuvo éxito. */
-int hfa_read_and_extract(const char *archive_path, const char *dir){
-    FILE *f = fopen(archive_path, "rb");
+/* entrada ANS: el codificador recorre los datos de atrás hacia adelante, así que el archivo
+   se codifica en memoria (como los sub-flujos) */
+static int compress_ans(FILE *f, const char *path, const char *name, const struct ModeloANS *model,
+                        uint64_t orig_len, uint64_t *bit_count){
+    char *txt = NULL;
+    size_t len = 0;
+    if (read_file_text(path, &txt, &len) != 0) return -1;
+
+    hfa_entry_t e;
+    memset(&e, 0, sizeof(e));
+    int rc = -1;
+    if ((uint64_t)len == orig_len) e.packed = codificar_ans((const unsigned char*)txt, len, model, &e.packed_len);
+    if (e.packed){
+        e.name = (char*)name;
+        e.txt_len = len;
+        e.method = HFA_METHOD_ANS;
+        e.ans = model;
+        e.bit_count = (uint64_t)e.packed_len * 8;
+        rc = (hfa_write_entry(f, &e) == 0) ? 0 : -1;
+        if (rc == 0 && bit_count) *bit_count = e.bit_count;
+    }
+    free(e.packed);
+    free(txt);
+    return rc;
+}
+
+/* destino del codificador incremental: agrega los bytes al FILE* de la entrada */
+static int write_to_file(void *ctx, const uint8_t *data, size_t n){
+    return fwrite(data, 1, n, (FILE*)ctx)==n ? 0 : -1;
+}
+
+/* comprime el archivo 'path' como una entrada HFA2 de flujo único escrita en 'f', con memoria
+   acotada: una pasada por trozos arma el histograma y otra codifica con el codificador incremental.
+   La tabla de sincronía se reserva antes del payload y se completa al final ('f' debe admitir fseek).
+   Con contexts > 1 la primera pasada arma el histograma de orden 1 y la entrada usa el modo de contexto
+   si ocupa menos (esas entradas no llevan puntos de sincronía). Con words o level se prueban antes el
+   alfabeto extendido y LZ77, que codifican en memoria. Con codec ANS o automático el histograma decide entre Huffman
+   y ANS; las entradas ANS también se codifican en memoria. Con una tabla entrenada la entrada
+   la referencia por id si así ocupa menos que con su propio código. Si la opción elegida no achica el
+   archivo, la entrada se almacena sin codificar. */
+int hfa_compress_stream(FILE *f, const char *path, const char *name, const hfa_opts_t *o,
+                        uint32_t sync_interval, uint64_t *bit_count, uint64_t *penalty){
+    if (o->words || o->level){
+        int rc = compress_in_memory(f, path, name, o, bit_count, penalty);
+        if (rc <= 0) return rc;
+    }
+    int max_bits = o->max_bits, contexts = o->contexts;
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+    unsigned char *chunk = (unsigned char*)malloc(HFA_STREAM_CHUNK);
+    struct CodificadorFlujo *cod = (struct CodificadorFlujo*)malloc(sizeof(*cod));
+    uint64_t *sync_bits = NULL;
+    uint64_t *freq1 = NULL;
+    struct ModeloContexto *model = NULL;
+    int rc = -1;
+    if (!chunk || !cod) goto out;
+    if (contexts > 1){
+        freq1 = (uint64_t*)calloc((size_t)TAM_MAX * TAM_MAX, sizeof(uint64_t));
+        model = (struct ModeloContexto*)malloc(sizeof(*model));
+        if (!freq1 || !model) goto out;
+    }
+
+    /* 1) histograma por trozos */
+    uint64_t freq[TAM_MAX] = {0};
+    uint64_t orig_len = 0;
+    unsigned char prev = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, HFA_STREAM_CHUNK, in)) > 0){
+        if (freq1) acumular_histograma_orden1(chunk, n, &prev, freq1);
+        else acumular_histograma(chunk, n, freq);
+        orig_len += n;
+    }
+    if (ferror(in)) goto out;
+    if (freq1)
+        for (size_t i=0;i<(size_t)TAM_MAX * TAM_MAX;i++) freq[i % TAM_MAX] += freq1[i];
+
+    /* 2) códigos canónicos; bits y bytes del payload salen del histograma */
+    hfa_entry_t e;
+    memset(&e, 0, sizeof(e));
+    struct TablaCodigos tabla;
+    if (generar_codigos_canonicos(freq, max_bits, e.code_len, &tabla, penalty) != 0) goto out;
+    e.name = (char*)name;
+    e.txt_len = (size_t)orig_len;
+    e.method = HFA_METHOD_HUFFMAN;
+    for (int c=0;c<TAM_MAX;c++) e.bit_count += freq[c] * tabla.longitud[c];
+    uint8_t lengths[HUF_CABECERA_MAX];
+    uint64_t ctx_bits;
+    size_t hdr = escribir_longitudes(e.code_len, lengths), ctx_hdr;
+    const struct TablaCodigos *codes = &tabla;
+    if (o->table && choose_trained(freq, o->table, &e.bit_count, &hdr)){
+        e.method = HFA_METHOD_TRAINED;
+        e.table = o->table;
+        codes = &o->table->codes;
+        if (penalty) *penalty = 0;
+    }
+    if (freq1 && choose_context(freq1, contexts, max_bits, e.bit_count, hdr, model, &ctx_bits, &ctx_hdr)){
+        e.method = HFA_METHOD_HUFFMAN_CONTEXT;
+        e.model = model;
+        e.bit_count = ctx_bits;
+        hdr = ctx_hdr;
+        if (penalty) *penalty = 0;
+    }
+    struct ModeloANS ans;
+    uint64_t coded = (e.bit_count + 7) / 8 + hdr;
+    int use_ans = o->codec != HFA_CODEC_HUFFMAN && orig_len > 0 &&
+                  choose_ans(freq, o->codec, e.bit_count, hdr, &ans, &coded);
+    if (orig_len > 0 && coded >= orig_len){
+        rc = store_stream(f, in, name, orig_len, chunk);
+        if (rc == 0 && bit_count) *bit_count = orig_len * 8;
+        if (rc == 0 && penalty) *penalty = 0;
+        goto out;
+    }
+    if (use_ans){
+        rc = compress_ans(f, path, name, &ans, orig_len, bit_count);
+        if (rc == 0 && penalty) *penalty = 0;
+        goto out;
+    }
+    e.packed_len = (size_t)((e.bit_count + 7) / 8);
+    if ((e.method == HFA_METHOD_HUFFMAN || e.method == HFA_METHOD_TRAINED) && sync_interval && orig_len > sync_interval){
+        e.sync_interval = sync_interval;
+        e.nsync = (uint32_t)((orig_len - 1) / sync_interval);
+        sync_bits = (uint64_t*)calloc(e.nsync, sizeof(uint64_t));
+        if (!sync_bits) goto out;
+        e.sync_bits = sync_bits;
+    }
+
+    /* 3) cabecera con la tabla de sincronía en cero; se recuerda dónde quedó */
+    if (hfa_write_entry_header(f, &e)!=0) goto out;
+    long payload_pos = ftell(f);
+    if (payload_pos < 0) goto out;
+
+    /* 4) segunda pasada: codificar por trozos directo al archivo */
+    codificador_iniciar(cod, codes, write_to_file, f);
+    if (e.model) codificador_contexto(cod, model);
+    if (e.nsync) codificador_sincronia(cod, sync_interval, sync_bits, e.nsync);
+    rewind(in);
+    uint64_t seen = 0;
+    while ((n = fread(chunk, 1, HFA_STREAM_CHUNK, in)) > 0){
+        seen += n;
+        if (seen > orig_len || codificador_actualizar(cod, chunk, n)!=0) goto out;
+    }
+    if (ferror(in) || seen != orig_len || codificador_terminar(cod)!=0) goto out;
+    if (cod->bits != e.bit_count || cod->n_puntos != e.nsync) goto out;
+
+    /* 5) completar la tabla de sincronía, que termina justo antes de bit_count y byte_count */
+    if (e.nsync){
+        long end = ftell(f);
+        long sync_pos = payload_pos - (long)(2 * sizeof(uint64_t)) - (long)(e.nsync * sizeof(uint64_t));
+        if (end < 0 || fseek(f, sync_pos, SEEK_SET)!=0 ||
+            fwrite(sync_bits, sizeof(uint64_t), e.nsync, f)!=e.nsync ||
+            fseek(f, end, SEEK_SET)!=0) goto out;
+    }
+    if (bit_count) *bit_count = e.bit_count;
+    rc = ferror(f) ? -1 : 0;
+
+out:
+    fclose(in);
+    free(chunk);
+    free(cod);
+    free(sync_bits);
+    free(freq1);
+    free(model);
+    return rc;
+}
+
+/* codifica un bloque independiente: histograma y códigos propios, uno o varios flujos.
+   Formato: u8 método, u16 largo de longitudes, longitudes, u64 bits, payload. */
+int hfa_encode_block(const unsigned char *data, size_t len, const hfa_opts_t *o,
+                     hfa_block_t *out, uint64_t *penalty){
+    int max_bits = o->max_bits, streams = o->streams, contexts = o->contexts;
+    uint64_t freq[TAM_MAX] = {0};
+    uint64_t *freq1 = NULL;
+    if (contexts > 1 && streams <= 1){
+        freq1 = (uint64_t*)calloc((size_t)TAM_MAX * TAM_MAX, sizeof(uint64_t));
+        if (!freq1) return -1;
+        unsigned char prev = 0;
+        acumular_histograma_orden1(data, len, &prev, freq1);
+        for (size_t i=0;i<(size_t)TAM_MAX * TAM_MAX;i++) freq[i % TAM_MAX] += freq1[i];
+    } else {
+        acumular_histograma(data, len, freq);
+    }
+
+    unsigned char code_len[TAM_MAX];
+    struct TablaCodigos tabla;
+    if (generar_codigos_canonicos(freq, max_bits, code_len, &tabla, penalty) != 0){ free(freq1); return -1; }
+
+    uint8_t *lengths = (uint8_t*)malloc(HUF_CABECERA_PALABRAS_MAX);
+    if (!lengths){ free(freq1); return -1; }
+    uint16_t lengths_len = (uint16_t)escribir_longitudes(code_len, lengths);
+    uint8_t method = (streams > 1) ? HFA_METHOD_HUFFMAN_STREAMS : HFA_METHOD_HUFFMAN;
+    size_t packed_len = 0;
+    uint64_t bit_count = 0;
+    uint8_t *packed = NULL;
+
+    uint64_t bits0 = 0;
+    for (int c=0;c<TAM_MAX;c++) bits0 += freq[c] * tabla.longitud[c];
+    size_t hdr0 = lengths_len;
+    if (o->table && streams <= 1 && choose_trained(freq, o->table, &bits0, &hdr0)){
+        method = HFA_METHOD_TRAINED;
+        lengths_len = (uint16_t)write_table_id(o->table, lengths);
+        if (penalty) *penalty = 0;
+    }
+    uint64_t best = (bits0 + 7) / 8 + lengths_len;
+
+    /* alfabeto extendido: solo si el bloque queda más chico que con el código de bytes */
+    if (o->words && streams <= 1){
+        struct AlfabetoPalabras *alphabet = (struct AlfabetoPalabras*)malloc(sizeof(*alphabet));
+        int rc = alphabet ? try_words(data, len, o, &best, alphabet, &packed, &packed_len, &bit_count) : -1;
+        if (rc == 1){
+            method = HFA_METHOD_HUFFMAN_WORDS;
+            lengths_len = (uint16_t)escribir_alfabeto_palabras(alphabet, lengths);
+            if (penalty) *penalty = 0;
+        }
+        free(alphabet);
+        if (rc < 0){ free(freq1); free(lengths); return -1; }
+    }
+
+    /* LZ77: solo si el bloque queda más chico que con lo elegido hasta acá */
+    if (o->level && streams <= 1){
+        struct ModeloLZ *lz = (struct ModeloLZ*)malloc(sizeof(*lz));
+        uint8_t *lz_packed = NULL;
+        size_t lz_len = 0;
+        uint64_t lz_bits = 0;
+        if (!lz){ free(packed); free(freq1); free(lengths); return -1; }
+        if (try_lz(data, len, o, &best, lz, &lz_packed, &lz_len, &lz_bits)){
+            free(packed);
+            packed = lz_packed;
+            packed_len = lz_len;
+            bit_count = lz_bits;
+            method = HFA_METHOD_LZ77;
+            lengths_len = (uint16_t)escribir_modelo_lz(lz, lengths);
+            if (penalty) *penalty = 0;
+        }
+        free(lz);
+    }
+
+    /* modo de contexto: solo si el bloque queda más chico que con el código único */
+    struct ModeloContexto *model = NULL;
+    if (freq1 && !packed){
+        uint64_t ctx_bits;
+        size_t ctx_hdr;
+        model = (struct ModeloContexto*)malloc(sizeof(*model));
+        if (model && choose_context(freq1, contexts, max_bits, bits0, lengths_len, model, &ctx_bits, &ctx_hdr)){
+            method = HFA_METHOD_HUFFMAN_CONTEXT;
+            lengths_len = (uint16_t)escribir_modelo_contexto(model, lengths);
+            bits0 = ctx_bits;
+            if (penalty) *penalty = 0;
+        }
+        if (!model){ free(freq1); free(lengths); return -1; }
+    }
+    free(freq1);
+
+    /* ANS: si el tamaño estimado queda por debajo del de Huffman (o si se pidió siempre ANS) */
+    struct ModeloANS ans;
+    uint64_t ans_bytes;
+    if (o->codec != HFA_CODEC_HUFFMAN && !packed && streams <= 1 && len > 0 &&
+        choose_ans(freq, o->codec, bits0, lengths_len, &ans, &ans_bytes)){
+        method = HFA_METHOD_ANS;
+        lengths_len = (uint16_t)escribir_modelo_ans(&ans, lengths);
+        if (penalty) *penalty = 0;
+    }
+
+    if (!packed)
+        packed = (method == HFA_METHOD_HUFFMAN_STREAMS)
+                     ? codificar_flujos(data, len, &tabla, streams, &packed_len, &bit_count)
+                 : (method == HFA_METHOD_HUFFMAN_CONTEXT)
+                     ? codificar_contexto(data, len, model, &packed_len, &bit_count)
+                 : (method == HFA_METHOD_ANS)
+                     ? codificar_ans(data, len, &ans, &packed_len)
+                 : (method == HFA_METHOD_TRAINED)
+                     ? codificar_bits(data, len, &o->table->codes, &packed_len, &bit_count)
+                     : codificar_bits(data, len, &tabla, &packed_len, &bit_count);
+    free(model);
+    if (!packed){ free(lengths); return -1; }
+    if (method == HFA_METHOD_ANS) bit_count = (uint64_t)packed_len * 8;
+
+    /* almacenado: si la codificación no achica el bloque, sus bytes van tal cual */
+    if (packed_len + lengths_len >= len){
+        free(packed);
+        packed = NULL;
+        method = HFA_METHOD_STORED;
+        lengths_len = 0;
+        packed_len = len;
+        bit_count = (uint64_t)len * 8;
+        if (penalty) *penalty = 0;
+    }
+
+    size_t hdr = 1 + sizeof(uint16_t) + lengths_len + sizeof(uint64_t);
+    uint8_t *buf = (uint8_t*)malloc(hdr + packed_len);
+    if (!buf){ free(packed); free(lengths); return -1; }
+    buf[0] = method;
+    memcpy(buf + 1, &lengths_len, sizeof(uint16_t));
+    memcpy(buf + 3, lengths, lengths_len);
+    memcpy(buf + 3 + lengths_len, &bit_count, sizeof(uint64_t));
+    if (packed_len) memcpy(buf + hdr, packed ? packed : data, packed_len);
+    free(packed);
+    free(lengths);
+
+    out->data = buf;
+    out->len = hdr + packed_len;
+    out->bit_count = bit_count;
+    return 0;
+}
+
+/* decodifica en memoria un payload de contexto de orden 1, de alfabeto extendido, LZ77 o ANS;
+   'blob' es la cabecera del modelo o del alfabeto */
+static int decode_modeled(uint8_t method, const uint8_t *blob, size_t blob_len, const uint8_t *payload,
+                          size_t n_bytes, uint64_t bit_count, unsigned char *out, size_t out_len){
+    int rc = -1;
+    if (method == HFA_METHOD_HUFFMAN_CONTEXT){
+        struct ModeloContexto *model = (struct ModeloContexto*)malloc(sizeof(*model));
+        if (model && leer_modelo_contexto(blob, blob_len, model) == (int)blob_len)
+            rc = descomprimir_contexto_en(model, payload, n_bytes, bit_count, out, out_len);
+        free(model);
+    } else if (method == HFA_METHOD_HUFFMAN_WORDS){
+        struct AlfabetoPalabras *alphabet = (struct AlfabetoPalabras*)malloc(sizeof(*alphabet));
+        if (alphabet && leer_alfabeto_palabras(blob, blob_len, alphabet) == (int)blob_len)
+            rc = descomprimir_palabras_en(alphabet, payload, n_bytes, bit_count, out, out_len);
+        free(alphabet);
+    } else if (method == HFA_METHOD_LZ77){
+        struct ModeloLZ *lz = (struct ModeloLZ*)malloc(sizeof(*lz));
+        if (lz && leer_modelo_lz(blob, blob_len, lz) == (int)blob_len)
+            rc = descomprimir_lz77_en(lz, payload, n_bytes, bit_count, out, out_len);
+        free(lz);
+    } else if (method == HFA_METHOD_ANS){
+        struct ModeloANS model;
+        if (leer_modelo_ans(blob, blob_len, &model) == (int)blob_len && bit_count == (uint64_t)n_bytes * 8)
+            rc = descomprimir_ans_en(&model, payload, n_bytes, out, out_len);
+    }
+    return rc;
+}
+
+/* decodifica un bloque escrito por hfa_encode_block en exactamente out_len bytes de 'out'. */
+int hfa_decode_block(const uint8_t *block, size_t block_len, unsigned char *out, size_t out_len){
+    if (block_len < 1 + sizeof(uint16_t)) return -1;
+    uint8_t method = block[0];
+    uint16_t lengths_len;
+    memcpy(&lengths_len, block + 1, sizeof(uint16_t));
+
+    size_t hdr = 1 + sizeof(uint16_t) + (size_t)lengths_len + sizeof(uint64_t);
+    if (block_len < hdr) return -1;
+
+    uint64_t bit_count;
+    memcpy(&bit_count, block + 3 + lengths_len, sizeof(uint64_t));
+
+    if (method == HFA_METHOD_STORED){
+        if (block_len - hdr != out_len) return -1;
+        if (out_len) memcpy(out, block + hdr, out_len);
+        return 0;
+    }
+    if (method == HFA_METHOD_HUFFMAN_CONTEXT || method == HFA_METHOD_HUFFMAN_WORDS || method == HFA_METHOD_ANS ||
+        method == HFA_METHOD_LZ77)
+        return decode_modeled(method, block + 3, lengths_len, block + hdr, block_len - hdr, bit_count, out, out_len);
+    if (method == HFA_METHOD_TRAINED){
+        const hfa_table_t *t = trained_table(block + 3, lengths_len);
+        return t ? decodificar_bits(t->decode, block + hdr, block_len - hdr, bit_count, out, out_len) : -1;
+    }
+
+    unsigned char code_len[TAM_MAX];
+    if (leer_longitudes(block + 3, lengths_len, code_len) != (int)lengths_len) return -1;
+
+    if (method == HFA_METHOD_HUFFMAN)
+        return descomprimir_canonico_en(code_len, block + hdr, block_len - hdr, bit_count, out, out_len);
+    if (method == HFA_METHOD_HUFFMAN_STREAMS)
+        return descomprimir_canonico_flujos_en(code_len, block + hdr, block_len - hdr, bit_count, out, out_len);
+    return -1;
+}
+
+/* bit donde empieza el segmento k de una entrada con puntos de sincronía (nsync+1 = final) */
+static uint64_t sync_bit(const hfa_meta_t *m, uint32_t k){
+    if (k == 0) return 0;
+    if (k > m->nsync) return m->bit_count;
+    return m->sync_bits[k-1];
+}
+
+/* cantidad de segmentos de una entrada: bloques, tramos entre puntos de sincronía o 1. */
+uint32_t hfa_segment_count(const hfa_meta_t *m){
+    if (m->method == HFA_METHOD_HUFFMAN_BLOCKS) return m->nblocks;
+    return m->nsync + 1;
+}
+
+/* rango de salida y de payload (relativo a payload_off) que cubren los segmentos [first, end). */
+void hfa_segment_range(const hfa_meta_t *m, uint32_t first, uint32_t end,
+                       uint64_t *out_off, uint64_t *out_len, uint64_t *pay_off, uint64_t *pay_len){
+    if (m->method == HFA_METHOD_HUFFMAN_BLOCKS){
+        uint64_t o_end = (end >= m->nblocks) ? m->orig_len : (uint64_t)end * m->block_size;
+        *out_off = (uint64_t)first * m->block_size;
+        *out_len = o_end - *out_off;
+        *pay_off = m->block_off[first];
+        *pay_len = m->block_off[end] - m->block_off[first];
+        return;
+    }
+    if (m->nsync == 0){
+        *out_off = 0; *out_len = m->orig_len;
+        *pay_off = 0; *pay_len = m->byte_count;
+        return;
+    }
+    uint64_t o_end = (end > m->nsync) ? m->orig_len : (uint64_t)end * m->sync_interval;
+    *out_off = (uint64_t)first * m->sync_interval;
+    *out_len = o_end - *out_off;
+    *pay_off = sync_bit(m, first) / 8;
+    *pay_len = (sync_bit(m, end) + 7) / 8 - *pay_off;
+}
+
+/* decodifica los segmentos [first, end) de una entrada en 'out' (out_len bytes de hfa_segment_range).
+   'part' son los pay_len bytes del payload que empiezan en pay_off; solo HFA2. */
+int hfa_decode_segments(const hfa_meta_t *m, uint32_t first, uint32_t end,
+                        const uint8_t *part, unsigned char *out){
+    uint64_t out_off, out_len, pay_off, pay_len;
+    hfa_segment_range(m, first, end, &out_off, &out_len, &pay_off, &pay_len);
+
+    if (m->method == HFA_METHOD_HUFFMAN_BLOCKS){
+        for (uint32_t b=first;b<end;b++){
+            uint64_t start = (uint64_t)(b - first) * m->block_size;
+            uint64_t len = (out_len - start < m->block_size) ? out_len - start : m->block_size;
+            if (hfa_decode_block(part + (m->block_off[b] - m->block_off[first]),
+                                 (size_t)(m->block_off[b+1] - m->block_off[b]), out + start, (size_t)len) != 0)
+                return -1;
+        }
+        return 0;
+    }
+    if (m->version != 2 || m->nsync == 0) return -1;
+    uint64_t bit0 = sync_bit(m, first);
+    if (m->method == HFA_METHOD_TRAINED){
+        const hfa_table_t *t = trained_table(m->tree_blob, m->tree_len);
+        return t ? decodificar_bits_desde(t->decode, part, (size_t)pay_len, bit0 % 8, sync_bit(m, end) - bit0,
+                                          out, (size_t)out_len) : -1;
+    }
+    if (m->method != HFA_METHOD_HUFFMAN) return -1;
+
+    unsigned char code_len[TAM_MAX];
+    if (leer_longitudes(m->tree_blob, m->tree_len, code_len) != (int)m->tree_len) return -1;
+    return descomprimir_canonico_desde(code_len, part, (size_t)pay_len, bit0 % 8, sync_bit(m, end) - bit0,
+                                       out, (size_t)out_len);
+}
+
+/* lee exactamente 'len' bytes del descriptor en el offset 'off'. */
+static int pread_full(int fd, void *buf, size_t len, uint64_t off){
+    size_t done = 0;
+    while (done < len){
+        ssize_t rd = pread(fd, (uint8_t*)buf + done, len - done, (off_t)(off + done));
+        if (rd < 0 && errno == EINTR) continue;
+        if (rd <= 0) return -1;
+        done += (size_t)rd;
+    }
+    return 0;
+}
+
+/* escribe exactamente 'len' bytes en el descriptor en el offset 'off'. */
+static int pwrite_full(int fd, const void *buf, size_t len, uint64_t off){
+    size_t done = 0;
+    while (done < len){
+        ssize_t wr = pwrite(fd, (const uint8_t*)buf + done, len - done, (off_t)(off + done));
+        if (wr < 0 && errno == EINTR) continue;
+        if (wr <= 0) return -1;
+        done += (size_t)wr;
+    }
+    return 0;
+}
+
+/* proyecta el .hfa completo una vez: los extractores toman punteros a los payloads en lugar de
+   copiarlos con pread. Una descompresión completa recorre el archivo hacia adelante, así que se pide
+   lectura anticipada secuencial. Si mmap falla el lector sigue con pread sobre el descriptor */
+int hfa_archive_open(const char *path, hfa_archive_t *a){
+    a->map = NULL;
+    a->size = 0;
+    a->fd = open(path, O_RDONLY);
+    if (a->fd < 0) return -1;
+    struct stat st;
+    if (fstat(a->fd, &st) != 0){ close(a->fd); a->fd = -1; return -1; }
+    a->size = (uint64_t)st.st_size;
+    if (a->size > 0){
+        void *p = mmap(NULL, (size_t)a->size, PROT_READ, MAP_SHARED, a->fd, 0);
+        if (p != MAP_FAILED){
+            madvise(p, (size_t)a->size, MADV_SEQUENTIAL);
+            a->map = (const uint8_t*)p;
+        }
+    }
+    return 0;
+}
+
+/* libera la proyección y cierra el descriptor */
+void hfa_archive_close(hfa_archive_t *a){
+    if (a->map) munmap((void*)a->map, (size_t)a->size);
+    if (a->fd >= 0) close(a->fd);
+    a->map = NULL;
+    a->fd = -1;
+}
+
+/* copia [off, off+len) del .hfa en 'dst': desde la proyección o con pread */
+static int archive_read(const hfa_archive_t *a, void *dst, size_t len, uint64_t off){
+    if (!a->map) return pread_full(a->fd, dst, len, off);
+    if (off > a->size || len > a->size - off) return -1;
+    memcpy(dst, a->map + off, len);
+    return 0;
+}
+
+/* puntero a [off, off+len) del .hfa: dentro de la proyección (sin copia) o, sin proyección, en un
+   buffer leído con pread que queda en *owned para que lo libere el llamador */
+static const uint8_t *archive_bytes(const hfa_archive_t *a, uint64_t off, size_t len, uint8_t **owned){
+    *owned = NULL;
+    if (a->map) return (off <= a->size && len <= a->size - off) ? a->map + off : NULL;
+    uint8_t *buf = (uint8_t*)malloc(len ? len : 1);
+    if (!buf || pread_full(a->fd, buf, len, off) != 0){ free(buf); return NULL; }
+    *owned = buf;
+    return buf;
+}
+
+/* entrada almacenada: copia el payload al archivo de salida sin decodificar. Primero con
+   copy_file_range (sin pasar por espacio de usuario); si el sistema de archivos no lo admite,
+   con pread/pwrite por trozos */
+static int extract_stored(const hfa_archive_t *a, const hfa_meta_t *m, int out_fd){
+    if (m->byte_count != m->orig_len) return -1;
+    loff_t in_off = (loff_t)m->payload_off, out_off = 0;
+    uint64_t done = 0;
+    while (done < m->orig_len){
+        size_t want = (m->orig_len - done < (uint64_t)SSIZE_MAX) ? (size_t)(m->orig_len - done) : (size_t)SSIZE_MAX;
+        ssize_t n = copy_file_range(a->fd, &in_off, out_fd, &out_off, want, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (uint64_t)n;
+    }
+    if (done == m->orig_len) return 0;
+    if (a->map){
+        /* con proyección, una sola escritura desde la página del payload */
+        if ((uint64_t)m->payload_off + m->orig_len > a->size) return -1;
+        return pwrite_full(out_fd, a->map + m->payload_off + done, (size_t)(m->orig_len - done), done);
+    }
+
+    unsigned char *chunk = (unsigned char*)malloc(HFA_STREAM_CHUNK);
+    if (!chunk) return -1;
+    int rc = 0;
+    while (done < m->orig_len && rc == 0){
+        size_t k = (m->orig_len - done < HFA_STREAM_CHUNK) ? (size_t)(m->orig_len - done) : HFA_STREAM_CHUNK;
+        if (pread_full(a->fd, chunk, k, (uint64_t)m->payload_off + done) != 0 ||
+            pwrite_full(out_fd, chunk, k, done) != 0) rc = -1;
+        done += k;
+    }
+    free(chunk);
+    return rc;
+}
+
+/* fuente del decodificador incremental: un rango [off, end) del .hfa */
+typedef struct { const hfa_archive_t *a; uint64_t off, end; } archive_src_t;
+
+static size_t read_from_archive(void *ctx, uint8_t *dst, size_t n){
+    archive_src_t *src = (archive_src_t*)ctx;
+    if (n > src->end - src->off) n = (size_t)(src->end - src->off);
+    if (n == 0 || archive_read(src->a, dst, n, src->off) != 0) return 0;
+    src->off += n;
+    return n;
+}
+
+/* arma los códigos de una entrada desde el árbol (HFA1) o las longitudes (HFA2).
+   Devuelve 1 si el árbol es una sola hoja (el símbolo queda en *single), 0 si hay códigos, -1 si falla. */
+static int entry_codes(const hfa_meta_t *m, struct TablaCodigos *codigos, unsigned char *single){
+    if (m->version == 1){
+        FILE *ftree = fmemopen((void*)m->tree_blob, m->tree_len, "rb");
+        if (!ftree) return -1;
+        struct ArenaNodos arena;
+        int raiz = deserializar_arbol(&arena, ftree);
+        fclose(ftree);
+        if (raiz < 0) return -1;
+        if (arena.nodos[raiz].izquierda == ARENA_NULO){ *single = arena.nodos[raiz].caracter; return 1; }
+        return generar_tabla_codigos(&arena, raiz, codigos) == 0 ? 0 : -1;
+    }
+    unsigned char code_len[TAM_MAX];
+    if (leer_longitudes(m->tree_blob, m->tree_len, code_len) != (int)m->tree_len) return -1;
+    return asignar_codigos_canonicos(code_len, codigos) == 0 ? 0 : -1;
+}
+
+/* bloques [first, end): cada uno se decodifica entero desde la proyección (memoria acotada por el
+   tamaño de bloque) */
+static int extract_blocks(const hfa_archive_t *a, const hfa_meta_t *m, uint32_t first, uint32_t end, int out_fd){
+    unsigned char *out = (unsigned char*)malloc(m->block_size);
+    int rc = out ? 0 : -1;
+    for (uint32_t b=first;b<end && rc==0;b++){
+        uint64_t start = (uint64_t)b * m->block_size;
+        size_t len = (m->orig_len - start < m->block_size) ? (size_t)(m->orig_len - start) : m->block_size;
+        size_t blen = (size_t)(m->block_off[b+1] - m->block_off[b]);
+        uint8_t *owned;
+        const uint8_t *blk = archive_bytes(a, (uint64_t)m->payload_off + m->block_off[b], blen, &owned);
+        if (!blk || hfa_decode_block(blk, blen, out, len) != 0 ||
+            pwrite_full(out_fd, out, len, start) != 0) rc = -1;
+        free(owned);
+    }
+    free(out);
+    return rc;
+}
+
+/* flujo único desde el punto de sincronía de 'first' hasta el de 'end', por trozos */
+static int extract_single(const hfa_archive_t *a, const hfa_meta_t *m, uint32_t first, uint32_t end,
+                          const struct TablaDecodificacion *tabla, const struct TablasContexto *ctx, int out_fd){
+    uint64_t out_off, out_len, pay_off, pay_len;
+    hfa_segment_range(m, first, end, &out_off, &out_len, &pay_off, &pay_len);
+    uint64_t bit0 = sync_bit(m, first), bit1 = sync_bit(m, end);
+
+    archive_src_t src = {a, (uint64_t)m->payload_off + bit0 / 8, (uint64_t)m->payload_off + (bit1 + 7) / 8};
+    struct DecodificadorFlujo *d = (struct DecodificadorFlujo*)malloc(sizeof(*d));
+    unsigned char *chunk = (unsigned char*)malloc(HFA_STREAM_CHUNK);
+    int rc = (d && chunk) ? 0 : -1;
+    if (rc == 0) decodificador_iniciar(d, tabla, read_from_archive, &src, (int)(bit0 % 8));
+    if (rc == 0 && ctx) decodificador_contexto(d, ctx);
+    for (uint64_t done=0; done<out_len && rc==0; ){
+        size_t k = (out_len - done < HFA_STREAM_CHUNK) ? (size_t)(out_len - done) : HFA_STREAM_CHUNK;
+        if (decodificador_leer(d, chunk, k) != 0 || pwrite_full(out_fd, chunk, k, out_off + done) != 0) rc = -1;
+        done += k;
+    }
+    if (rc == 0) rc = decodificador_terminar(d, bit1 - bit0);
+    free(chunk);
+    free(d);
+    return rc;
+}
+
+/* contexto de orden 1: flujo único sin puntos de sincronía, la tabla sale del byte anterior */
+static int extract_context(const hfa_archive_t *a, const hfa_meta_t *m, int out_fd){
+    if (m->orig_len == 0) return 0;
+    struct ModeloContexto *model = (struct ModeloContexto*)malloc(sizeof(*model));
+    struct TablasContexto *ctx = (struct TablasContexto*)malloc(sizeof(*ctx));
+    int rc = -1;
+    if (model && ctx && leer_modelo_contexto(m->tree_blob, m->tree_len, model) == (int)m->tree_len &&
+        construir_tablas_contexto(model, ctx) == 0)
+        rc = extract_single(a, m, 0, 1, &ctx->tablas[0], ctx, out_fd);
+    free(ctx);
+    free(model);
+    return rc;
+}
+
+/* alfabeto extendido: payload y salida completos en memoria, como en la compresión
+   (también para ANS y LZ77, que se decodifican de una vez) */
+static int extract_in_memory(const hfa_archive_t *a, const hfa_meta_t *m, int out_fd){
+    if (m->orig_len == 0) return 0;
+    uint8_t *owned;
+    const uint8_t *payload = archive_bytes(a, (uint64_t)m->payload_off, (size_t)m->byte_count, &owned);
+    unsigned char *out = (unsigned char*)malloc((size_t)m->orig_len);
+    int rc = -1;
+    if (payload && out &&
+        decode_modeled(m->method, m->tree_blob, m->tree_len, payload, (size_t)m->byte_count, m->bit_count,
+                       out, (size_t)m->orig_len) == 0)
+        rc = pwrite_full(out_fd, out, (size_t)m->orig_len, 0);
+    free(out);
+    free(owned);
+    return rc;
+}
+
+/* sub-flujos intercalados: un decodificador incremental por flujo; cada trozo de salida toma
+   de cada flujo sus símbolos (i % n_flujos) y los intercala */
+static int extract_streams(const hfa_archive_t *a, const hfa_meta_t *m, const struct TablaDecodificacion *tabla, int out_fd){
+    uint8_t jump[HUF_TABLA_SALTOS(HUF_FLUJOS_MAX)];
+    if (m->byte_count < 1 || archive_read(a, jump, 1, (uint64_t)m->payload_off) != 0) return -1;
+    int n = jump[0];
+    if (n < 1 || n > HUF_FLUJOS_MAX || m->byte_count < HUF_TABLA_SALTOS(n) ||
+        archive_read(a, jump, HUF_TABLA_SALTOS(n), (uint64_t)m->payload_off) != 0) return -1;
+
+    /* validar la tabla de saltos contra el payload, como decodificar_flujos */
+    uint64_t bits[HUF_FLUJOS_MAX], pos = HUF_TABLA_SALTOS(n), total = 0;
+    archive_src_t src[HUF_FLUJOS_MAX];
+    for (int f=0;f<n;f++){
+        bits[f] = 0;
+        for (int b=0;b<8;b++) bits[f] |= (uint64_t)jump[1 + 8*f + b] << (8*b);
+        uint64_t bytes = (bits[f] + 7) / 8;
+        if (bytes > m->byte_count - pos) return -1;
+        src[f] = (archive_src_t){a, (uint64_t)m->payload_off + pos, (uint64_t)m->payload_off + pos + bytes};
+        pos += bytes;
+        total += bits[f];
+    }
+    if (pos != m->byte_count || total != m->bit_count) return -1;
+
+    size_t step = HFA_STREAM_CHUNK - HFA_STREAM_CHUNK % (size_t)n;   /* múltiplo de n: cada trozo empieza en el flujo 0 */
+    struct DecodificadorFlujo *d = (struct DecodificadorFlujo*)malloc((size_t)n * sizeof(*d));
+    unsigned char *chunk = (unsigned char*)malloc(HFA_STREAM_CHUNK);
+    unsigned char *tmp = (unsigned char*)malloc(HFA_STREAM_CHUNK + (size_t)n);
+    int rc = (d && chunk && tmp) ? 0 : -1;
+    for (int f=0;f<n && rc==0;f++) decodificador_iniciar(&d[f], tabla, read_from_archive, &src[f], 0);
+
+    for (uint64_t done=0; done<m->orig_len && rc==0; ){
+        size_t k = (m->orig_len - done < step) ? (size_t)(m->orig_len - done) : step;
+        size_t per = (k + (size_t)n - 1) / (size_t)n;
+        for (int f=0;f<n && rc==0;f++){
+            size_t cnt = ((size_t)f < k) ? (k - (size_t)f + (size_t)n - 1) / (size_t)n : 0;
+            unsigned char *t = tmp + (size_t)f * per;
+            if (decodificador_leer(&d[f], t, cnt) != 0) rc = -1;
+            for (size_t j=0;j<cnt;j++) chunk[j * (size_t)n + (size_t)f] = t[j];
+        }
+        if (rc == 0 && pwrite_full(out_fd, chunk, k, done) != 0) rc = -1;
+        done += k;
+    }
+    for (int f=0;f<n && rc==0;f++) rc = decodificador_terminar(&d[f], bits[f]);
+    free(tmp);
+    free(chunk);
+    free(d);
+    return rc;
+}
+
+/* decodifica los segmentos [first, end) de una entrada leyendo el .hfa proyectado y escribe cada
+   trozo con pwrite en su offset de 'out_fd'. La memoria no depende del tamaño de la entrada
+   (en modo bloques, del tamaño de bloque). Sub-flujos y HFA1 solo se extraen completos. */
+int hfa_extract_segments(const hfa_archive_t *a, const hfa_meta_t *m, uint32_t first, uint32_t end, int out_fd){
+    /* tramos grandes: se pide al kernel que traiga ya las páginas del rango (las chicas llegan con
+       la lectura anticipada secuencial) */
+    uint64_t out_off, out_len, pay_off, pay_len;
+    hfa_segment_range(m, first, end, &out_off, &out_len, &pay_off, &pay_len);
+    if (a->map && pay_len >= HFA_STREAM_CHUNK && (uint64_t)m->payload_off + pay_off + pay_len <= a->size){
+        uint64_t off = (uint64_t)m->payload_off + pay_off, page = (uint64_t)sysconf(_SC_PAGESIZE);
+        madvise((void*)(a->map + off - off % page), (size_t)(pay_len + off % page), MADV_WILLNEED);
+    }
+
+    if (m->method == HFA_METHOD_HUFFMAN_BLOCKS) return extract_blocks(a, m, first, end, out_fd);
+    if (m->method == HFA_METHOD_HUFFMAN_CONTEXT)
+        return (first == 0 && end == 1) ? extract_context(a, m, out_fd) : -1;
+    if (m->method == HFA_METHOD_HUFFMAN_WORDS || m->method == HFA_METHOD_ANS || m->method == HFA_METHOD_LZ77)
+        return (first == 0 && end == 1) ? extract_in_memory(a, m, out_fd) : -1;
+    if (m->method == HFA_METHOD_STORED)
+        return (first == 0 && end == 1) ? extract_stored(a, m, out_fd) : -1;
+    if (m->method == HFA_METHOD_TRAINED){
+        /* tabla entrenada: la de decodificación ya se armó al cargarla */
+        const hfa_table_t *t = trained_table(m->tree_blob, m->tree_len);
+        if (!t) return -1;
+        return m->orig_len ? extract_single(a, m, first, end, t->decode, NULL, out_fd) : 0;
+    }
+    if (m->method != HFA_METHOD_HUFFMAN && m->method != HFA_METHOD_HUFFMAN_STREAMS) return -1;
+    if (m->orig_len == 0) return 0;
+
+    struct TablaCodigos codigos;
+    unsigned char single = 0;
+    int kind = entry_codes(m, &codigos, &single);
+    if (kind < 0) return -1;
+    if (kind == 1){
+        /* árbol de una sola hoja (HFA1): la salida es el mismo byte repetido */
+        unsigned char chunk[4096];
+        memset(chunk, single, sizeof chunk);
+        for (uint64_t done=0; done<m->orig_len; ){
+            size_t k = (m->orig_len - done < sizeof chunk) ? (size_t)(m->orig_len - done) : sizeof chunk;
+            if (pwrite_full(out_fd, chunk, k, done) != 0) return -1;
+            done += k;
+        }
+        return 0;
+    }
+
+    struct TablaDecodificacion *tabla = (struct TablaDecodificacion*)malloc(sizeof(*tabla));
+    if (!tabla) return -1;
+    int rc = construir_tabla_decodificacion(&codigos, tabla);
+    if (rc == 0){
+        if (m->method == HFA_METHOD_HUFFMAN_STREAMS)
+            rc = (first == 0 && end == 1) ? extract_streams(a, m, tabla, out_fd) : -1;
+        else
+            rc = extract_single(a, m, first, end, tabla, NULL, out_fd);
+    }
+    free(tabla);
+    return rc;
+}
+
+/* crea (o trunca) 'out_path' y extrae en él la entrada completa por flujo. */
+int hfa_extract_entry(const hfa_archive_t *a, const hfa_meta_t *m, const char *out_path){
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) return -1;
+    int rc = hfa_extract_segments(a, m, 0, hfa_segment_count(m), out_fd);
+    if (close(out_fd) != 0) rc = -1;
+    return rc;
+}
+
+/* suma al total el costo de un bloque estimado desde su histograma: cabecera del bloque, su offset
+   en la tabla y el payload (o los bytes originales si el código no achica) */
+static int add_block_estimate(const uint64_t *freq, uint64_t len, int max_bits, uint64_t *total){
+    struct EstimacionHuffman est;
+    if (estimar_huffman(freq, max_bits, &est) != 0) return -1;
+    uint64_t coded = (est.bits_huffman + 7) / 8 + est.bytes_cabecera;
+    *total += 1 + 2 + 8 + 8 + (coded < len ? coded : len);
+    return 0;
+}
+
+/* estima una entrada leyendo solo su histograma (sin codificar): código único para todo el archivo
+   y, si block_size > 0, modo bloques. Si freq_sum no es NULL le suma el histograma del archivo */
+int hfa_estimate_file(const char *path, int max_bits, uint32_t block_size, uint64_t *freq_sum,
+                      hfa_estimate_t *est){
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+    unsigned char *chunk = (unsigned char*)malloc(HFA_STREAM_CHUNK);
+    if (!chunk){ fclose(in); return -1; }
+
+    uint64_t freq[TAM_MAX] = {0}, block_freq[TAM_MAX] = {0};
+    uint64_t in_block = 0;
+    int rc = 0;
+    memset(est, 0, sizeof(*est));
+    size_t n;
+    while (rc == 0 && (n = fread(chunk, 1, HFA_STREAM_CHUNK, in)) > 0){
+        acumular_histograma(chunk, n, freq);
+        est->orig_len += n;
+        /* el trozo se reparte entre los bloques que toca */
+        for (size_t off = 0; block_size && off < n && rc == 0; ){
+            size_t take = n - off;
+            if (take > block_size - in_block) take = (size_t)(block_size - in_block);
+            acumular_histograma(chunk + off, take, block_freq);
+            off += take;
+            in_block += take;
+            if (in_block == block_size){
+                rc = add_block_estimate(block_freq, in_block, max_bits, &est->block_bytes);
+                memset(block_freq, 0, sizeof(block_freq));
+                in_block = 0;
+            }
+        }
+    }
+    if (ferror(in)) rc = -1;
+    if (rc == 0 && in_block) rc = add_block_estimate(block_freq, in_block, max_bits, &est->block_bytes);
+    if (est->orig_len <= block_size) est->block_bytes = 0;   /* no se parte en bloques */
+    if (rc == 0) rc = estimar_huffman(freq, max_bits, &est->huffman);
+    if (rc == 0 && freq_sum)
+        for (int c=0;c<TAM_MAX;c++) freq_sum[c] += freq[c];
+    free(chunk);
+    fclose(in);
+    return rc;
+}
+
+/* imprime una línea del modo --analyze: entropía, Huffman con su cabecera, bloques y el método que
+   elegiría el compresor entre Huffman y almacenado. Devuelve los bytes del método elegido */
+static uint64_t print_estimate(const char *name, const hfa_estimate_t *est){
+    const struct EstimacionHuffman *h = &est->huffman;
+    uint64_t coded = (h->bits_huffman + 7) / 8 + h->bytes_cabecera;
+    double orig = est->orig_len ? (double)est->orig_len : 1.0;
+    printf("%-28s %12llu  entropía %5.3f b/B  huffman %12llu (%5.3f)",
+           name, (unsigned long long)est->orig_len, (double)h->bits_entropia / orig,
+           (unsigned long long)coded, (double)coded / orig);
+    if (est->block_bytes)
+        printf("  bloques %12llu (%5.3f)", (unsigned long long)est->block_bytes, (double)est->block_bytes / orig);
+    printf("  -> %s\n", (est->orig_len && coded < est->orig_len) ? "huffman" : "almacenado");
+    return (coded < est->orig_len) ? coded : est->orig_len;
+}
+
+/* modo --analyze: estima cada archivo desde su histograma, sin codificar ni escribir nada. Al final
+   compara los códigos por archivo con un único código compartido por todos */
+int hfa_analyze(char **paths, size_t n, int max_bits, uint32_t block_size){
+    uint64_t freq_sum[TAM_MAX] = {0};
+    uint64_t orig = 0, per_file = 0;
+    for (size_t i=0;i<n;i++){
+        hfa_estimate_t est;
+        if (hfa_estimate_file(paths[i], max_bits, block_size, freq_sum, &est) != 0) return -1;
+        const char *slash = strrchr(paths[i], '/');
+        per_file += print_estimate(slash ? slash + 1 : paths[i], &est);
+        orig += est.orig_len;
+    }
+
+    struct EstimacionHuffman shared;
+    if (estimar_huffman(freq_sum, max_bits, &shared) != 0) return -1;
+    uint64_t shared_bytes = (shared.bits_huffman + 7) / 8 + shared.bytes_cabecera;
+    double total = orig ? (double)orig : 1.0;
+    printf("%zu archivos, %llu bytes: códigos por archivo %llu (%5.3f), código compartido %llu (%5.3f), "
+           "entropía conjunta %5.3f b/B\n", n, (unsigned long long)orig,
+           (unsigned long long)per_file, (double)per_file / total,
+           (unsigned long long)shared_bytes, (double)shared_bytes / total, (double)shared.bits_entropia / total);
+    return 0;
+}
+
+/* id de una tabla: FNV-1a de sus longitudes, así la misma tabla entrenada dos veces tiene el mismo id */
+static uint32_t table_id(const unsigned char *code_len){
+    return fnv1a(FNV_BASE, code_len, TAM_MAX);
+}
+
+/* arma desde un histograma una tabla que sirve para cualquier entrada: cada byte suma 1 a su
+   frecuencia para que todos tengan código. No arma la tabla de decodificación */
+static int make_table(const uint64_t *freq, int max_bits, hfa_table_t *t){
+    uint64_t smooth[TAM_MAX];
+    for (int c=0;c<TAM_MAX;c++) smooth[c] = freq[c] + 1;
+    memset(t, 0, sizeof(*t));
+    if (generar_codigos_canonicos(smooth, max_bits, t->code_len, &t->codes, NULL) != 0) return -1;
+    t->id = table_id(t->code_len);
+    return 0;
+}
+
+/* bits del payload de un histograma codificado con una tabla */
+static uint64_t table_bits(const uint64_t *freq, const hfa_table_t *t){
+    uint64_t bits = 0;
+    for (int c=0;c<TAM_MAX;c++) bits += freq[c] * t->code_len[c];
+    return bits;
+}
+
+/* escribe una tabla: u32 id, u16 largo de longitudes y longitudes (escribir_longitudes) */
+static void write_table(FILE *f, const hfa_table_t *t){
+    uint8_t lengths[HUF_CABECERA_MAX];
+    uint16_t lengths_len = (uint16_t)escribir_longitudes(t->code_len, lengths);
+    put_u32(f, t->id);
+    put_u16(f, lengths_len);
+    fwrite(lengths, 1, lengths_len, f);
+}
+
+/* lee una tabla escrita por write_table, arma sus códigos y su tabla de decodificación y la
+   registra; si ya estaba registrada devuelve esa, sin volver a armarla. NULL si está corrupta, si
+   algún byte no tiene código o si su id choca con una tabla distinta */
+static const hfa_table_t *read_table(FILE *f){
+    uint8_t lengths[HUF_CABECERA_MAX];
+    uint32_t id = get_u32(f);
+    uint16_t lengths_len = get_u16(f);
+    if (feof(f) || lengths_len > sizeof(lengths) || fread(lengths, 1, lengths_len, f) != lengths_len) return NULL;
+
+    unsigned char code_len[TAM_MAX];
+    if (leer_longitudes(lengths, lengths_len, code_len) != (int)lengths_len || table_id(code_len) != id) return NULL;
+    for (int c=0;c<TAM_MAX;c++)
+        if (!code_len[c]) return NULL;
+    for (uint32_t i=0;i<g_ntables;i++)
+        if (g_tables[i]->id == id)
+            return memcmp(g_tables[i]->code_len, code_len, TAM_MAX) == 0 ? g_tables[i] : NULL;
+    if (g_ntables == HFA_TABLES_MAX) return NULL;
+
+    hfa_table_t *t = (hfa_table_t*)calloc(1, sizeof(*t));
+    if (t) t->decode = (struct TablaDecodificacion*)malloc(sizeof(*t->decode));
+    if (!t || !t->decode || asignar_codigos_canonicos(code_len, &t->codes) != 0 ||
+        construir_tabla_decodificacion(&t->codes, t->decode) != 0){
+        if (t) free(t->decode);
+        free(t);
+        return NULL;
+    }
+    t->id = id;
+    memcpy(t->code_len, code_len, TAM_MAX);
+    g_tables[g_ntables++] = t;
+    return t;
+}
+
+/* entrena una tabla estática con el histograma conjunto de 'paths' y la guarda en out_path.
+   Formato .hft: magic y la tabla como en write_table */
+int hfa_train_table(char **paths, size_t n, int max_bits, const char *out_path){
+    uint64_t freq[TAM_MAX] = {0};
+    for (size_t i=0;i<n;i++){
+        hfa_estimate_t est;
+        if (hfa_estimate_file(paths[i], max_bits, 0, freq, &est) != 0) return -1;
+    }
+    hfa_table_t t;
+    if (make_table(freq, max_bits, &t) != 0) return -1;
+
+    FILE *f = fopen(out_path, "wb");
     if (!f) return -1;
+    fwrite(HFA_TABLE_MAGIC, 1, 4, f);
+    write_table(f, &t);
+    int rc = ferror(f) ? -1 : 0;
+    if (fclose(f) != 0) rc = -1;
+    if (rc == 0) printf("[OK] Tabla %08x entrenada con %zu archivos en %s\n", t.id, n, out_path);
+    return rc;
+}
 
-    hfa_header_t hdr;
-    if (fread(&hdr,sizeof(hdr),1,f)!=1 || memcmp(hdr.magic,"HFA1",4)!=0){ fclose(f); return -1; }
-
-    for (uint32_t i=0;i<hdr.nfiles;i++){
-        uint16_t name_len = get_u16(f);
-        char *name = (char*)malloc(name_len+1);
-        fread(name,1,name_len,f); name[name_len]='\0';
-        uint64_t orig_len = get_u64(f);
-
-        struct Nodo *raiz = deserializar_arbol(f);
-        if (!raiz){ free(name); fclose(f); return -1; }
-
-        uint64_t bit_count = get_u64(f);
-        uint64_t byte_count= get_u64(f);
-        uint8_t *payload = NULL;
-        if (byte_count){
-            payload = (uint8_t*)malloc((size_t)byte_count);
-            if (fread(payload,1,(size_t)byte_count,f)!=(size_t)byte_count){
-                free(payload); liberar_arbol(raiz); free(name); fclose(f); return -1;
+/* lee una tabla .hft y la registra para que las entradas que la referencian se puedan descomprimir.
+   Devuelve la tabla (válida hasta el final del proceso) o NULL. No es segura entre hilos: se llama
+   antes de lanzarlos */
+const hfa_table_t *hfa_load_table(const char *path){
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    char magic[4];
+    const hfa_table_t *t = NULL;
+    if (fread(magic, 1, 4, f) == 4 && memcmp(magic, HFA_TABLE_MAGIC, 4) == 0) t = read_table(f);
+    fclose(f);
+    return t;
+}
+
+/* reconstruye cada tabla desde la suma de los histogramas de sus archivos y descarta las que se
+   quedaron sin archivos o repiten el id de otra; renumera assign. Devuelve la cantidad de tablas */
+static int rebuild_tables(const uint64_t (*hist)[TAM_MAX], size_t n, int max_bits, hfa_table_t *T,
+                          uint32_t t, uint32_t *assign, uint64_t (*sum)[TAM_MAX]){
+    uint32_t remap[HFA_SHARED_MAX];
+    memset(sum, 0, (size_t)t * sizeof(*sum));
+    for (uint32_t j=0;j<t;j++) remap[j] = UINT32_MAX;
+    for (size_t i=0;i<n;i++){
+        for (int c=0;c<TAM_MAX;c++) sum[assign[i]][c] += hist[i][c];
+        remap[assign[i]] = 0;
+    }
+
+    uint32_t used = 0;
+    for (uint32_t j=0;j<t;j++){
+        if (remap[j] == UINT32_MAX) continue;
+        if (make_table(sum[j], max_bits, &T[used]) != 0) return -1;
+        remap[j] = used;
+        for (uint32_t d=0;d<used;d++)
+            if (T[d].id == T[used].id && memcmp(T[d].code_len, T[used].code_len, TAM_MAX) == 0) remap[j] = d;
+        if (remap[j] == used) used++;
+    }
+    for (size_t i=0;i<n;i++) assign[i] = remap[assign[i]];
+    return (int)used;
+}
+
+/* agrupa los histogramas de n archivos en a lo sumo k tablas compartidas, con el costo real en bits.
+   La primera semilla es el histograma conjunto; cada nueva es el archivo que más bits pierde con su
+   mejor tabla respecto de su entropía, mientras lo que ahorran todos los archivos con ella supere
+   lo que ocupa una tabla más en la sección. Después se
+   alternan reconstrucción (cada tabla desde la suma de sus archivos) y asignación (cada archivo a la
+   tabla con la que ocupa menos) hasta que nada cambia. Deja en assign[i] la tabla del archivo i; las
+   tablas se devuelven en *out (sin tabla de decodificación) */
+int hfa_cluster_tables(const uint64_t (*hist)[TAM_MAX], size_t n, int k, int max_bits,
+                       hfa_table_t **out, uint32_t *ntables, uint32_t *assign){
+    if (k < 1 || k > HFA_SHARED_MAX) return -1;
+    hfa_table_t *T = (hfa_table_t*)calloc((size_t)k, sizeof(*T));
+    uint64_t (*sum)[TAM_MAX] = (uint64_t (*)[TAM_MAX])calloc((size_t)k, sizeof(*sum));
+    uint64_t *best = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    uint64_t *floor_bits = (uint64_t*)malloc((n ? n : 1) * sizeof(uint64_t));
+    int rc = -1;
+    uint32_t t = 0;
+    if (!T || !sum || !best || !floor_bits) goto out;
+
+    for (size_t i=0;i<n;i++){
+        floor_bits[i] = bits_entropia(hist[i]);
+        for (int c=0;c<TAM_MAX;c++) sum[0][c] += hist[i][c];
+    }
+    if (make_table(sum[0], max_bits, &T[0]) != 0) goto out;
+    t = 1;
+    for (size_t i=0;i<n;i++){
+        best[i] = table_bits(hist[i], &T[0]);
+        assign[i] = 0;
+    }
+
+    /* semillas */
+    while ((int)t < k){
+        size_t worst = 0;
+        uint64_t loss = 0;
+        for (size_t i=0;i<n;i++){
+            uint64_t l = (best[i] > floor_bits[i]) ? best[i] - floor_bits[i] : 0;
+            if (l > loss){ loss = l; worst = i; }
+        }
+        if (loss == 0 || make_table(hist[worst], max_bits, &T[t]) != 0) break;
+        uint64_t gain = 0;
+        for (size_t i=0;i<n;i++){
+            uint64_t b = table_bits(hist[i], &T[t]);
+            if (b < best[i]) gain += best[i] - b;
+        }
+        if (gain <= 8 * (uint64_t)HUF_CABECERA_MAX) break;
+        for (size_t i=0;i<n;i++){
+            uint64_t b = table_bits(hist[i], &T[t]);
+            if (b < best[i]){ best[i] = b; assign[i] = t; }
+        }
+        t++;
+    }
+
+    /* refinamiento */
+    for (int round=0; round<HFA_CLUSTER_ROUNDS; round++){
+        int used = rebuild_tables(hist, n, max_bits, T, t, assign, sum);
+        if (used < 0) goto out;
+        t = (uint32_t)used;
+        int changed = 0;
+        for (size_t i=0;i<n;i++){
+            uint32_t a = assign[i];
+            uint64_t b = table_bits(hist[i], &T[a]);
+            for (uint32_t j=0;j<t;j++){
+                uint64_t bj = table_bits(hist[i], &T[j]);
+                if (bj < b){ b = bj; a = j; }
             }
+            if (a != assign[i]){ assign[i] = a; changed = 1; }
         }
+        if (!changed) break;
+    }
+    /* la última asignación puede haber vaciado alguna tabla */
+    int used = rebuild_tables(hist, n, max_bits, T, t, assign, sum);
+    if (used < 0) goto out;
+    t = (uint32_t)used;
+    rc = 0;
 
-        char *bitstr = unpack_bits_to_bitstr(payload, (size_t)byte_count, bit_count);
-        char *texto  = descomprimir_texto(raiz, bitstr, (long)orig_len);
-        char out_path[PATH_MAX]; join_path(dir, name, out_path);
+out:
+    free(sum);
+    free(best);
+    free(floor_bits);
+    if (rc != 0){ free(T); return -1; }
+    *out = T;
+    *ntables = t;
+    return 0;
+}
+
+/* sección de tablas compartidas de un HFA3 (va justo después del header): u32 cantidad y las tablas */
+int hfa_write_tables(FILE *f, const hfa_table_t *tables, uint32_t n){
+    put_u32(f, n);
+    for (uint32_t j=0;j<n;j++) write_table(f, &tables[j]);
+    return ferror(f) ? -1 : 0;
+}
+
+/* abre un HFA2/HFA3 para agregarle entradas: las existentes quedan donde están (son contiguas, así
+   que cada una empieza donde termina el payload anterior), se corta el directorio viejo y el archivo
+   queda posicionado al final del último payload. 'entry_off' sale con lugar para 'extra' entradas más.
+   El header conserva la cantidad vieja hasta hfa_append_close: si el proceso se corta antes, el
+   archivo se sigue leyendo recorriendo las entradas viejas */
+int hfa_append_open(const char *archive_path, uint32_t extra, FILE **out, uint64_t **entry_off, uint32_t *n){
+    FILE *f = fopen(archive_path, "r+b");
+    if (!f) return -1;
+    uint8_t version; uint32_t cnt; long entries_off;
+    hfa_meta_t *M = load_entries(f, &version, &cnt, &entries_off);
+    uint64_t *off = M ? (uint64_t*)malloc(((size_t)cnt + extra) * sizeof(uint64_t) + 1) : NULL;
+    if (!M || !off || version != 2){
+        if (M && version != 2) fprintf(stderr, "%s es HFA1: no admite entradas agregadas\n", archive_path);
+        free(off); hfa_free_index(M, M ? cnt : 0); fclose(f);
+        return -1;
+    }
+
+    uint64_t end = (uint64_t)entries_off;
+    for (uint32_t i=0;i<cnt;i++){
+        off[i] = end;
+        end = (uint64_t)M[i].payload_off + M[i].byte_count;
+    }
+    hfa_free_index(M, cnt);
+    if (fflush(f)!=0 || ftruncate(fileno(f), (off_t)end)!=0 || fseek(f, (long)end, SEEK_SET)!=0){
+        free(off); fclose(f);
+        return -1;
+    }
+    *out = f;
+    *entry_off = off;
+    *n = cnt;
+    return 0;
+}
+
+/* cierra un .hfa abierto con hfa_append_open: directorio con las n entradas (viejas y nuevas) y,
+   al final, la cantidad del header */
+int hfa_append_close(FILE *f, const uint64_t *entry_off, uint32_t n){
+    int rc = hfa_write_directory(f, entry_off, n);
+    if (rc==0 && (fflush(f)!=0 || fseek(f, (long)offsetof(hfa_header_t, nfiles), SEEK_SET)!=0 ||
+                  fwrite(&n, sizeof(n), 1, f)!=1)) rc = -1;
+    if (fclose(f)!=0) rc = -1;
+    return rc;
+}
+
+/* agrega el directorio central y el trailer al final de un .hfa recién escrito (abierto en "w+b"):
+   relee la cabecera de cada entrada desde su offset y la copia al registro junto a los offsets */
+int hfa_write_directory(FILE *f, const uint64_t *entry_off, uint32_t n){
+    if (fseek(f, 0, SEEK_END)!=0) return -1;
+    long dir_off = ftell(f);
+    if (dir_off < 0) return -1;
+
+    char *dir = NULL; size_t dir_len = 0;
+    FILE *mem = open_memstream(&dir, &dir_len);
+    if (!mem) return -1;
+    int rc = 0;
+    for (uint32_t i=0;i<n && rc==0;i++){
+        hfa_meta_t m = {0};
+        rc = (fseek(f, (long)entry_off[i], SEEK_SET)==0 && read_entry(f, 2, &m)==0) ? 0 : -1;
+        long payload_off = ftell(f);
+        size_t len = (size_t)(payload_off - (long)entry_off[i]);
+        uint8_t *hdr = (rc==0 && payload_off > 0) ? (uint8_t*)malloc(len) : NULL;
+        if (!hdr || fseek(f, (long)entry_off[i], SEEK_SET)!=0 || fread(hdr,1,len,f)!=len) rc = -1;
+        if (rc==0){
+            put_u64(mem, entry_off[i]);
+            put_u64(mem, (uint64_t)payload_off);
+            fwrite(hdr, 1, len, mem);
+        }
+        free(hdr);
+        free(m.name); free(m.tree_blob); free(m.block_off); free(m.sync_bits);
+    }
+    if (fclose(mem)!=0) rc = -1;
+
+    if (rc==0){
+        hfa_trailer_t tr;
+        tr.dir_off  = (uint64_t)dir_off;
+        tr.dir_len  = dir_len;
+        tr.nfiles   = n;
+        tr.checksum = fnv1a(FNV_BASE, dir, dir_len);
+        memcpy(tr.magic, HFA_DIR_MAGIC, 4);
+        if (fseek(f, dir_off, SEEK_SET)!=0 || fwrite(dir,1,dir_len,f)!=dir_len || fwrite(&tr,sizeof(tr),1,f)!=1) rc = -1;
+    }
+    free(dir);
+    return (rc==0 && !ferror(f)) ? 0 : -1;
+}
+
+/* escribe el archivo .hfa (HFA2) con N entradas */
+int hfa_write(const char *archive_path, hfa_entry_t *E, uint32_t n){
+    FILE *f = fopen(archive_path, "w+b");
+    uint64_t *off = (uint64_t*)malloc(n ? n * sizeof(uint64_t) : 1);
+    if (!f || !off){ if (f) fclose(f); free(off); return -1; }
+
+    hfa_header_t hdr; memcpy(hdr.magic,HFA_MAGIC_V2,4); hdr.nfiles=n;
+    int rc = (fwrite(&hdr,sizeof(hdr),1,f)==1) ? 0 : -1;
+
+    for (uint32_t i=0;i<n && rc==0;i++){
+        off[i] = (uint64_t)ftell(f);
+        rc = hfa_write_entry(f, &E[i]);
+    }
+    if (rc==0) rc = hfa_write_directory(f, off, n);
+
+    free(off);
+    if (fclose(f)!=0) rc = -1;
+    return rc;
+}
+
+/* estado compartido de la escritura posicional (página MAP_SHARED, la ven también los hijos de un
+   fork). El lock solo cubre la asignación de offsets: nunca se hace E/S con él tomado */
+struct hfa_writer_shared {
+    uint64_t lock;
+    uint64_t tail;         /* próximo byte libre */
+    uint64_t turn;         /* primera entrada nueva sin región */
+    uint64_t failed;       /* alguna escritura falló */
+    uint64_t parked_mem;   /* bytes estacionados en memoria */
+    uint64_t v[];          /* offsets (base + extra) y, por entrada nueva, tamaño + 1 si está lista (0 = pendiente) */
+};
+
+static void writer_lock(struct hfa_writer_shared *sh){
+    while (__atomic_exchange_n(&sh->lock, 1, __ATOMIC_ACQUIRE)) sched_yield();
+}
+
+static void writer_unlock(struct hfa_writer_shared *sh){
+    __atomic_store_n(&sh->lock, 0, __ATOMIC_RELEASE);
+}
+
+static uint64_t *writer_ready(hfa_writer_t *w){
+    return w->shared->v + w->base + w->extra;
+}
+
+/* con el lock tomado: da región, en el orden de las entradas, a las listas desde el turno y devuelve
+   el turno nuevo */
+static uint32_t writer_advance(hfa_writer_t *w){
+    struct hfa_writer_shared *sh = w->shared;
+    uint64_t *ready = writer_ready(w);
+    while (sh->turn < w->extra && ready[sh->turn]){
+        sh->v[w->base + sh->turn] = sh->tail;
+        sh->tail += ready[sh->turn] - 1;
+        sh->turn++;
+    }
+    return (uint32_t)sh->turn;
+}
+
+static int park_path(const hfa_writer_t *w, uint32_t k, char out[PATH_MAX]){
+    int n = snprintf(out, PATH_MAX, "%s.%u.park", w->path, k);
+    return (n < 0 || n >= PATH_MAX) ? -1 : 0;
+}
+
+/* abre el .hfa para escritura posicional: sin --append escribe el header (y las tablas de un HFA3)
+   en un archivo aparte que se renombra al cerrar; con --append deja el .hfa sin directorio. Con
+   'procs' escriben procesos hijos y lo estacionado va a disco en lugar de a la memoria del proceso */
+int hfa_writer_open(hfa_writer_t *w, const char *path, uint32_t extra, bool append, bool procs,
+                    const hfa_table_t *tables, uint32_t ntables){
+    memset(w, 0, sizeof(*w));
+    w->append = append;
+    w->procs = procs;
+    w->extra = extra;
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    snprintf(w->tmp, sizeof(w->tmp), "%s.part", path);
+
+    uint64_t *old = NULL;
+    int rc = 0;
+    if (append) rc = hfa_append_open(path, extra, &w->f, &old, &w->base);
+    else {
+        w->f = fopen(w->tmp, "w+b");
+        hfa_header_t hdr; memcpy(hdr.magic, tables ? HFA_MAGIC_V3 : HFA_MAGIC_V2, 4); hdr.nfiles = extra;
+        rc = (w->f && fwrite(&hdr,sizeof(hdr),1,w->f)==1) ? 0 : -1;
+        if (rc==0 && tables) rc = hfa_write_tables(w->f, tables, ntables);
+    }
+    long start = (rc==0 && fflush(w->f)==0) ? ftell(w->f) : -1;
+    if (start >= 0 && !procs && !(w->parked = (hfa_slot_t*)calloc(extra ? extra : 1, sizeof(hfa_slot_t)))) start = -1;
+
+    w->shared_len = sizeof(struct hfa_writer_shared) + ((size_t)w->base + 2 * (size_t)extra) * sizeof(uint64_t);
+    void *p = (start >= 0) ? mmap(NULL, w->shared_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0) : MAP_FAILED;
+    if (p == MAP_FAILED){
+        free(old);
+        free(w->parked);
+        if (w->f) fclose(w->f);
+        if (!append) remove(w->tmp);
+        return -1;
+    }
+    w->shared = (struct hfa_writer_shared*)p;   /* la página anónima arranca en cero */
+    w->shared->tail = w->start = (uint64_t)start;
+    if (old) memcpy(w->shared->v, old, (size_t)w->base * sizeof(uint64_t));
+    free(old);
+    w->fd = fileno(w->f);
+    return 0;
+}
+
+/* copia un archivo parcial de 'len' bytes en una región ya asignada: con copy_file_range y, si el
+   sistema de archivos no lo admite, con pread/pwrite por trozos */
+static int writer_copy(hfa_writer_t *w, uint64_t off, const char *path, uint64_t len){
+    int in = open(path, O_RDONLY);
+    if (in < 0) return -1;
+    loff_t in_off = 0, out_off = (loff_t)off;
+    uint64_t done = 0;
+    while (done < len){
+        size_t want = (len - done < (uint64_t)SSIZE_MAX) ? (size_t)(len - done) : (size_t)SSIZE_MAX;
+        ssize_t n = copy_file_range(in, &in_off, w->fd, &out_off, want, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (uint64_t)n;
+    }
+
+    int rc = 0;
+    unsigned char *chunk = (done < len) ? (unsigned char*)malloc(HFA_STREAM_CHUNK) : NULL;
+    if (done < len && !chunk) rc = -1;
+    while (done < len && rc == 0){
+        size_t k = (len - done < HFA_STREAM_CHUNK) ? (size_t)(len - done) : HFA_STREAM_CHUNK;
+        if (pread_full(in, chunk, k, done) != 0 || pwrite_full(w->fd, chunk, k, off + done) != 0) rc = -1;
+        done += k;
+    }
+    free(chunk);
+    close(in);
+    return rc;
+}
+
+/* libera un destino; con 'drop' borra además sus archivos parciales */
+static void slot_release(hfa_slot_t *s, bool drop){
+    for (uint32_t i = 0; i < s->nparts; i++){
+        if (drop) remove(s->parts[i]);
+        free(s->parts[i]);
+    }
+    free(s->parts);
+    free(s->part_len);
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+}
+
+/* escribe un destino cerrado a partir de 'off' (buf y después los archivos parciales) y lo libera */
+static int slot_write(hfa_writer_t *w, uint64_t off, hfa_slot_t *s){
+    int rc = pwrite_full(w->fd, s->buf, s->len, off);
+    off += s->len;
+    for (uint32_t i = 0; i < s->nparts && rc == 0; i++){
+        rc = writer_copy(w, off, s->parts[i], s->part_len[i]);
+        off += s->part_len[i];
+    }
+    slot_release(s, true);
+    return rc;
+}
+
+/* estaciona la entrada k, terminada antes que alguna anterior, para quien le dé región: en la
+   memoria del proceso o, si escriben procesos hijos o lo estacionado en memoria pasa de
+   HFA_PARKED_MEM_MAX, en <path>.<k>.park */
+static int writer_park(hfa_writer_t *w, uint32_t k, hfa_slot_t *s){
+    bool mem = (s->nparts == 0);
+    if (mem && !w->procs &&
+        __atomic_add_fetch(&w->shared->parked_mem, s->len, __ATOMIC_RELAXED) <= HFA_PARKED_MEM_MAX){
+        w->parked[k] = *s;
+        memset(s, 0, sizeof(*s));
+        return 0;
+    }
+    if (mem && !w->procs) __atomic_sub_fetch(&w->shared->parked_mem, s->len, __ATOMIC_RELAXED);
+
+    char park[PATH_MAX];
+    if (park_path(w, k, park) != 0) return -1;
+    if (mem){
+        if (write_file_text(park, s->buf, s->len) != 0 || hfa_slot_add_part(s, park, s->len) != 0) return -1;
+        free(s->buf);
+        s->buf = NULL;
+        s->len = 0;
+    } else if (w->procs){
+        /* un hijo deja un solo archivo con la entrada entera y con nombre conocido */
+        if (s->len != 0 || s->nparts != 1 || rename(s->parts[0], park) != 0) return -1;
+        slot_release(s, false);
+        return 0;
+    }
+    if (!w->procs){
+        w->parked[k] = *s;
+        memset(s, 0, sizeof(*s));
+    }
+    return 0;
+}
+
+/* escribe la entrada estacionada j en su región ya asignada */
+static int write_parked(hfa_writer_t *w, uint32_t j){
+    hfa_slot_t s = {0};
+    if (w->procs){
+        char park[PATH_MAX];
+        if (park_path(w, j, park) != 0) return -1;
+        if (hfa_slot_add_part(&s, park, writer_ready(w)[j] - 1) != 0){ remove(park); return -1; }
+    } else {
+        s = w->parked[j];
+        memset(&w->parked[j], 0, sizeof(s));
+        if (s.nparts == 0) __atomic_sub_fetch(&w->shared->parked_mem, s.len, __ATOMIC_RELAXED);
+    }
+    return slot_write(w, w->shared->v[w->base + j], &s);
+}
+
+/* cierra el .hfa: las entradas quedaron contiguas y en orden, así que los offsets van tal cual al
+   directorio. Con ok = false (o si alguna entrada no llegó) el .hfa queda como estaba: sin --append
+   se borra el archivo aparte, con --append se recortan las entradas nuevas */
+int hfa_writer_close(hfa_writer_t *w, bool ok){
+    struct hfa_writer_shared *sh = w->shared;
+    uint64_t *off = sh->v;
+    uint32_t n = (uint32_t)sh->turn;
+    int rc = (ok && !sh->failed && n == w->extra) ? 0 : -1;
+
+    /* lo estacionado detrás de una entrada que falló nunca recibió región */
+    for (uint32_t j = n; j < w->extra; j++){
+        if (!writer_ready(w)[j]) continue;
+        if (w->procs){
+            char park[PATH_MAX];
+            if (park_path(w, j, park) == 0) remove(park);
+        } else slot_release(&w->parked[j], true);
+    }
+    free(w->parked);
+    w->parked = NULL;
+
+    if (w->append){
+        if (rc != 0){
+            /* se recortan las entradas nuevas: el directorio vuelve a tener solo las previas */
+            n = 0;
+            if (fflush(w->f) != 0 || ftruncate(w->fd, (off_t)w->start) != 0)
+                fprintf(stderr, "No se pudieron recortar las entradas nuevas de %s\n", w->path);
+        }
+        if (hfa_append_close(w->f, off, w->base + n) != 0) rc = -1;
+    } else {
+        if (rc == 0) rc = hfa_write_directory(w->f, off, n);
+        if (fclose(w->f) != 0) rc = -1;
+        if (rc == 0 && rename(w->tmp, w->path) != 0) rc = -1;
+        if (rc != 0) remove(w->tmp);
+    }
+    munmap(sh, w->shared_len);
+    w->shared = NULL;
+    w->f = NULL;
+    return rc;
+}
+
+/* abre el destino de una entrada antes de conocer su tamaño: en memoria si la fuente no pasa de
+   HFA_BLOCK_SIZE_DEFAULT, si no en el archivo parcial 'part' (la memoria no depende del tamaño) */
+FILE *hfa_slot_open(hfa_slot_t *s, const char *part, uint64_t src_len){
+    memset(s, 0, sizeof(*s));
+    if (src_len <= HFA_BLOCK_SIZE_DEFAULT){
+        s->mem = true;
+        s->f = open_memstream(&s->buf, &s->len);
+    } else if (hfa_slot_add_part(s, part, 0) == 0 && !(s->f = fopen(part, "w+b"))) slot_release(s, false);
+    return s->f;
+}
+
+/* agrega al destino un archivo parcial de 'len' bytes que va después de lo ya escrito */
+int hfa_slot_add_part(hfa_slot_t *s, const char *path, uint64_t len){
+    char **parts = (char**)realloc(s->parts, (s->nparts + 1) * sizeof(char*));
+    if (parts) s->parts = parts;
+    uint64_t *lens = parts ? (uint64_t*)realloc(s->part_len, (s->nparts + 1) * sizeof(uint64_t)) : NULL;
+    if (lens) s->part_len = lens;
+    char *dup = lens ? strdup(path) : NULL;
+    if (!dup) return -1;
+    s->parts[s->nparts] = dup;
+    s->part_len[s->nparts++] = len;
+    return 0;
+}
+
+/* cierra el destino de la entrada nueva k y, si 'rc' es 0, la entrega al .hfa sin esperar a las
+   anteriores: si ya les tocó a todas, la entrada recibe su región y se escribe; si no, queda
+   estacionada. Quien avanza el turno escribe además las siguientes que estaban estacionadas, así
+   el .hfa sale en el orden de las entradas (igual en cada corrida) y ninguna tarea se bloquea.
+   Si falla, la entrada nunca recibe región y el cierre deja el .hfa como estaba */
+int hfa_slot_commit(hfa_writer_t *w, uint32_t k, hfa_slot_t *s, int rc){
+    if (s->f){
+        long len = s->mem ? 0 : ((fseek(s->f, 0, SEEK_END)==0) ? ftell(s->f) : -1);
+        if (fclose(s->f) != 0 || len < 0) rc = -1;
+        else if (!s->mem) s->part_len[s->nparts - 1] = (uint64_t)len;
+        s->f = NULL;
+    }
+    uint64_t total = s->len;
+    for (uint32_t i = 0; i < s->nparts; i++) total += s->part_len[i];
+    if (rc != 0 || k >= w->extra){
+        slot_release(s, true);
+        return -1;
+    }
+
+    struct hfa_writer_shared *sh = w->shared;
+    uint64_t *ready = writer_ready(w);
+    writer_lock(sh);
+    uint32_t first = (uint32_t)sh->turn, end = first;
+    if (first == k){
+        ready[k] = total + 1;
+        end = writer_advance(w);
+    }
+    writer_unlock(sh);
+
+    if (first == k){
+        rc = slot_write(w, sh->v[w->base + k], s);
+        first++;
+    } else {
+        if (writer_park(w, k, s) != 0){
+            slot_release(s, true);
+            return -1;
+        }
+        /* pudo tocarle mientras se estacionaba: quien avanzó el turno no la vio lista */
+        writer_lock(sh);
+        ready[k] = total + 1;
+        first = (uint32_t)sh->turn;
+        end = (first == k) ? writer_advance(w) : first;
+        writer_unlock(sh);
+    }
+    for (uint32_t j = first; j < end; j++){
+        if (write_parked(w, j) == 0) continue;
+        __atomic_store_n(&sh->failed, 1, __ATOMIC_RELEASE);
+        if (j == k) rc = -1;
+    }
+    if (rc != 0) __atomic_store_n(&sh->failed, 1, __ATOMIC_RELEASE);
+    return rc;
+}
+
+/* decodifica el payload de una entrada según la versión: HFA1 reconstruye el árbol,
+   HFA2 arma los códigos canónicos directo desde las longitudes (por bloque en modo bloques) */
+unsigned char *hfa_decode_payload(const hfa_meta_t *m, const uint8_t *payload){
+    if (m->method == HFA_METHOD_HUFFMAN_BLOCKS){
+        unsigned char *out = (unsigned char*)malloc((size_t)m->orig_len + 1);
+        if (!out) return NULL;
+        out[m->orig_len] = '\0';
+        if (m->nblocks && hfa_decode_segments(m, 0, m->nblocks, payload, out) != 0){
+            free(out);
+            return NULL;
+        }
+        return out;
+    }
+    if (m->method == HFA_METHOD_STORED){
+        if (m->byte_count != m->orig_len) return NULL;
+        unsigned char *out = (unsigned char*)malloc((size_t)m->orig_len + 1);
+        if (!out) return NULL;
+        memcpy(out, payload, (size_t)m->orig_len);
+        out[m->orig_len] = '\0';
+        return out;
+    }
+    if (m->method == HFA_METHOD_HUFFMAN_CONTEXT || m->method == HFA_METHOD_HUFFMAN_WORDS || m->method == HFA_METHOD_ANS ||
+        m->method == HFA_METHOD_LZ77){
+        unsigned char *out = (unsigned char*)malloc((size_t)m->orig_len + 1);
+        if (!out) return NULL;
+        out[m->orig_len] = '\0';
+        if (decode_modeled(m->method, m->tree_blob, m->tree_len, payload, (size_t)m->byte_count, m->bit_count,
+                           out, (size_t)m->orig_len) != 0){
+            free(out);
+            return NULL;
+        }
+        return out;
+    }
+    if (m->method == HFA_METHOD_TRAINED){
+        const hfa_table_t *t = trained_table(m->tree_blob, m->tree_len);
+        unsigned char *out = t ? (unsigned char*)malloc((size_t)m->orig_len + 1) : NULL;
+        if (!out) return NULL;
+        out[m->orig_len] = '\0';
+        if (decodificar_bits(t->decode, payload, (size_t)m->byte_count, m->bit_count, out, (size_t)m->orig_len) != 0){
+            free(out);
+            return NULL;
+        }
+        return out;
+    }
+    if (m->method != HFA_METHOD_HUFFMAN && m->method != HFA_METHOD_HUFFMAN_STREAMS) return NULL;
+
+    if (m->version == 1){
+        FILE *ftree = fmemopen((void*)m->tree_blob, m->tree_len, "rb");
+        if (!ftree) return NULL;
+        struct ArenaNodos arena;   /* en la pila de la tarea: sin malloc por nodo */
+        int raiz = deserializar_arbol(&arena, ftree);
+        fclose(ftree);
+        if (raiz < 0) return NULL;
+        return descomprimir_empaquetado(&arena, raiz, payload, (size_t)m->byte_count,
+                                        m->bit_count, (size_t)m->orig_len);
+    }
+
+    unsigned char code_len[TAM_MAX];
+    if (leer_longitudes(m->tree_blob, m->tree_len, code_len) != (int)m->tree_len) return NULL;
+    if (m->method == HFA_METHOD_HUFFMAN_STREAMS)
+        return descomprimir_canonico_flujos(code_len, payload, (size_t)m->byte_count, m->bit_count, (size_t)m->orig_len);
+    return descomprimir_canonico(code_len, payload, (size_t)m->byte_count, m->bit_count, (size_t)m->orig_len);
+}
+
+/* descomprime secuencialmente un .hfa a .txt y elimina el .hfa si tuvo éxito. */
+int hfa_read_and_extract(const char *archive_path, const char *dir){
+    hfa_meta_t *M = NULL; uint32_t n = 0;
+    if (hfa_index(archive_path, &M, &n)!=0) return -1;
+
+    hfa_archive_t a;
+    if (hfa_archive_open(archive_path, &a)!=0){ hfa_free_index(M,n); return -1; }
+
+    for (uint32_t i=0;i<n;i++){
+        uint8_t *owned;
+        const uint8_t *payload = archive_bytes(&a, (uint64_t)M[i].payload_off, (size_t)M[i].byte_count, &owned);
+        if (!payload){ hfa_archive_close(&a); hfa_free_index(M,n); return -1; }
+
+        unsigned char *texto = hfa_decode_payload(&M[i], payload);
+        char out_path[PATH_MAX]; join_path(dir, M[i].name, out_path);
         FILE *fo = fopen(out_path, "wb");
-        if (fo){ fwrite(texto,1,(size_t)orig_len,fo); fclose(fo); }
+        if (fo){ if (texto) fwrite(texto,1,(size_t)M[i].orig_len,fo); fclose(fo); }
 
-        free(texto); free(bitstr); free(payload); liberar_arbol(raiz); free(name);
+        free(texto); free(owned);
     }
 
-    fclose(f);
+    hfa_archive_close(&a);
+    hfa_free_index(M,n);
     remove(archive_path);
     return 0;
 }
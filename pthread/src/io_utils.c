@@ -4,6 +4,7 @@
 
 #include "../include/io_utils.h"
 #include <sys/types.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -75,6 +76,59 @@ int write_file_text(const char *path, const char *buf, size_t len)
     return wr == len ? 0 : -1;
 }
 
+/* lee exactamente 'len' bytes desde el offset 'off' con pread (seguro entre hilos). */
+int read_file_range(const char *path, uint64_t off, char *buf, size_t len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t rd = pread(fd, buf + done, len - done, (off_t)(off + done));
+        if (rd < 0 && errno == EINTR)
+            continue;
+        if (rd <= 0)
+            break;
+        done += (size_t)rd;
+    }
+    close(fd);
+    return done == len ? 0 : -1;
+}
+
+/* crea (o trunca) el archivo destino con 'len' bytes para que varias tareas escriban sus rangos. */
+int create_file_sized(const char *path, uint64_t len)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int rc = ftruncate(fd, (off_t)len);
+    if (close(fd) != 0)
+        rc = -1;
+    return rc == 0 ? 0 : -1;
+}
+
+/* escribe exactamente 'len' bytes en el offset 'off' con pwrite (seguro entre hilos). */
+int write_file_range(const char *path, uint64_t off, const char *buf, size_t len)
+{
+    int fd = open(path, O_WRONLY);
+    if (fd < 0)
+        return -1;
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t wr = pwrite(fd, buf + done, len - done, (off_t)(off + done));
+        if (wr < 0 && errno == EINTR)
+            continue;
+        if (wr <= 0)
+            break;
+        done += (size_t)wr;
+    }
+    if (close(fd) != 0)
+        return -1;
+    return done == len ? 0 : -1;
+}
+
 /* lista archivos con el sufijo dado en 'dir' y los agrega a 'out'. */
 int list_files_with_suffix(const char *dir, const char *suffix, strvec_t *out)
 {
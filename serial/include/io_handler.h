@@ -1,9 +1,17 @@
 #ifndef IO_HANDLER_H
 #define IO_HANDLER_H
 
+#include <stdio.h>
 #include "../../huffman/include/huffman.h"
+#include "../../huffman/include/codigos.h"
 
-int comprimir_archivo(const char* nombre_archivo, struct Nodo* raiz, char** tabla_codigos, FILE* archivo_salida);
+// Marca y versión del formato .huf, al principio del archivo. HUF2 guarda por archivo los bits
+// válidos y los bytes empaquetados; los .huf anteriores no tienen marca y se rechazan
+#define HUF_MAGIC     "HUF"
+#define HUF_VERSION   '2'
+#define HUF_MAGIC_LEN 4
+
+int comprimir_archivo(const char* nombre_archivo, const struct TablaCodigos* tabla_codigos, FILE* archivo_salida);
 int descomprimir_archivo(FILE* archivo_entrada, const char* directorio_salida);
 int comprimir_directorio(const char* directorio_entrada, const char* archivo_salida);
 int descomprimir_archivo_completo(const char* archivo_entrada, const char* directorio_salida);
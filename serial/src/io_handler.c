@@ -7,10 +7,17 @@
 #include "../include/io_handler.h"
 #include "../../huffman/include/arbol.h"
 #include "../../huffman/include/frecuencias.h"
+#include "../../huffman/include/decodificador.h"
 
-// Función para comprimir un solo archivo y agregarlo al archivo de salida
-int comprimir_archivo(const char* nombre_archivo, struct Nodo* raiz, char** tabla_codigos, FILE* archivo_salida) {
-    FILE* archivo_entrada = fopen(nombre_archivo, "r");
+// Destino del codificador incremental: agrega los bytes empaquetados al archivo de salida
+static int escribir_en_archivo(void* contexto, const uint8_t* datos, size_t n) {
+    return fwrite(datos, 1, n, (FILE*)contexto) == n ? 0 : -1;
+}
+
+// Función para comprimir un solo archivo y agregarlo al archivo de salida.
+// El archivo se lee y se codifica por bloques, así la memoria no depende de su tamaño.
+int comprimir_archivo(const char* nombre_archivo, const struct TablaCodigos* tabla_codigos, FILE* archivo_salida) {
+    FILE* archivo_entrada = fopen(nombre_archivo, "rb");
     if (!archivo_entrada) {
         printf("Error al abrir archivo de entrada: %s\n", nombre_archivo);
         return 0;
@@ -21,33 +28,13 @@ int comprimir_archivo(const char* nombre_archivo, struct Nodo* raiz, char** tabl
     long tamaño_archivo = ftell(archivo_entrada);
     fseek(archivo_entrada, 0, SEEK_SET);
 
-    // Leer el contenido del archivo
-    char* contenido = (char*)malloc(tamaño_archivo + 1);
-    if (!contenido) {
-        fclose(archivo_entrada);
-        printf("Error de memoria al leer: %s\n", nombre_archivo);
-        return 0;
-    }
-
-    size_t leidos = fread(contenido, 1, tamaño_archivo, archivo_entrada);
-    if (leidos != tamaño_archivo) {
+    struct CodificadorFlujo* codificador = (struct CodificadorFlujo*)malloc(sizeof(struct CodificadorFlujo));
+    if (tamaño_archivo < 0 || !codificador) {
         printf("Error al leer archivo: %s\n", nombre_archivo);
-        free(contenido);
+        free(codificador);
         fclose(archivo_entrada);
         return 0;
     }
-    
-    contenido[tamaño_archivo] = '\0';
-    fclose(archivo_entrada);
-
-    // Comprimir el contenido
-    char* texto_comprimido = comprimir_texto(contenido, tabla_codigos);
-    free(contenido);
-
-    if (!texto_comprimido) {
-        printf("Error al comprimir: %s\n", nombre_archivo);
-        return 0;
-    }
 
     // Escribir metadatos del archivo
     int longitud_nombre = strlen(nombre_archivo);
@@ -55,12 +42,45 @@ int comprimir_archivo(const char* nombre_archivo, struct Nodo* raiz, char** tabl
     fwrite(nombre_archivo, 1, longitud_nombre, archivo_salida);
     fwrite(&tamaño_archivo, sizeof(long), 1, archivo_salida);
 
-    // Escribir contenido comprimido
-    int longitud_comprimida = strlen(texto_comprimido);
-    fwrite(&longitud_comprimida, sizeof(int), 1, archivo_salida);
-    fwrite(texto_comprimido, 1, longitud_comprimida, archivo_salida);
+    // Reservar los bits válidos y bytes empaquetados: se completan al terminar de codificar
+    uint64_t bits_comprimidos = 0;
+    uint64_t bytes_comprimidos = 0;
+    long posicion_tamaños = ftell(archivo_salida);
+    fwrite(&bits_comprimidos, sizeof(uint64_t), 1, archivo_salida);
+    fwrite(&bytes_comprimidos, sizeof(uint64_t), 1, archivo_salida);
+
+    // Codificar el contenido por bloques directo al archivo de salida
+    codificador_iniciar(codificador, tabla_codigos, escribir_en_archivo, archivo_salida);
+    unsigned char buffer[65536];
+    size_t leidos;
+    uint64_t total = 0;
+    int ok = 1;
+    while (ok && (leidos = fread(buffer, 1, sizeof(buffer), archivo_entrada)) > 0) {
+        total += leidos;
+        ok = codificador_actualizar(codificador, buffer, leidos) == 0;
+    }
+    ok = ok && !ferror(archivo_entrada) && total == (uint64_t)tamaño_archivo &&
+         codificador_terminar(codificador) == 0;
+    fclose(archivo_entrada);
+
+    if (!ok) {
+        printf("Error al comprimir: %s\n", nombre_archivo);
+        free(codificador);
+        return 0;
+    }
 
-    free(texto_comprimido);
+    // Completar bits válidos y bytes empaquetados, y volver al final del payload
+    bits_comprimidos = codificador->bits;
+    bytes_comprimidos = codificador->entregados;
+    free(codificador);
+    long fin = ftell(archivo_salida);
+    if (posicion_tamaños < 0 || fin < 0 || fseek(archivo_salida, posicion_tamaños, SEEK_SET) != 0 ||
+        fwrite(&bits_comprimidos, sizeof(uint64_t), 1, archivo_salida) != 1 ||
+        fwrite(&bytes_comprimidos, sizeof(uint64_t), 1, archivo_salida) != 1 ||
+        fseek(archivo_salida, fin, SEEK_SET) != 0) {
+        printf("Error al escribir: %s\n", nombre_archivo);
+        return 0;
+    }
     return 1;
 }
 
@@ -79,8 +99,17 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
         return 0;
     }
 
+    // Marca y versión del formato
+    const char marca[HUF_MAGIC_LEN] = {HUF_MAGIC[0], HUF_MAGIC[1], HUF_MAGIC[2], HUF_VERSION};
+    if (fwrite(marca, 1, HUF_MAGIC_LEN, archivo_comprimido) != HUF_MAGIC_LEN) {
+        printf("Error al escribir la cabecera de: %s\n", archivo_salida);
+        closedir(dir);
+        fclose(archivo_comprimido);
+        return 0;
+    }
+
     // Primero, leer todos los archivos y calcular frecuencias globales
-    int frecuencias[TAM_MAX] = {0};
+    uint64_t frecuencias[TAM_MAX] = {0};
     struct dirent* entrada;
     char ruta_completa[1024];
 
@@ -89,14 +118,14 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
         if (entrada->d_type == DT_REG) {
             snprintf(ruta_completa, sizeof(ruta_completa), "%s/%s", directorio_entrada, entrada->d_name);
             
-            FILE* archivo = fopen(ruta_completa, "r");
+            FILE* archivo = fopen(ruta_completa, "rb");
             if (archivo) {
                 printf("Procesando: %s\n", entrada->d_name);
-                char buffer[1024];
-                while (fgets(buffer, sizeof(buffer), archivo)) {
-                    for (int i = 0; buffer[i] != '\0'; i++) {
-                        frecuencias[(unsigned char)buffer[i]]++;
-                    }
+                // Leer por bloques binarios (no por líneas) para contar también los bytes '\0'
+                unsigned char buffer[65536];
+                size_t leidos;
+                while ((leidos = fread(buffer, 1, sizeof(buffer), archivo)) > 0) {
+                    acumular_histograma(buffer, leidos, frecuencias);
                 }
                 fclose(archivo);
             }
@@ -106,22 +135,23 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
 
     // Construir árbol de Huffman global
     printf("Construyendo árbol de Huffman...\n");
-    struct ListaNodos lista_nodos = crear_lista_nodos(frecuencias);
-    struct Nodo* raiz = construir_arbol_huffman(lista_nodos);
+    struct ArenaNodos arena;
+    int raiz = arena_construir_arbol(&arena, frecuencias);
     
     // Generar tabla de códigos
     printf("Generando códigos...\n");
-    char* tabla_codigos[TAM_MAX] = {NULL};
-    char codigo_actual[TAM_MAX];
-    generar_codigos_huffman(raiz, codigo_actual, 0, tabla_codigos);
+    struct TablaCodigos tabla_codigos;
+    if (raiz < 0 || generar_tabla_codigos(&arena, raiz, &tabla_codigos) != 0) {
+        printf("Error al generar la tabla de códigos\n");
+        fclose(archivo_comprimido);
+        return 0;
+    }
 
     // Serializar y guardar el árbol en el archivo comprimido
     printf("Guardando árbol...\n");
-    if (!serializar_arbol(raiz, archivo_comprimido)) {
+    if (!serializar_arbol(&arena, raiz, archivo_comprimido)) {
         printf("Error al serializar el árbol\n");
         fclose(archivo_comprimido);
-        liberar_arbol(raiz);
-        for (int i = 0; i < TAM_MAX; i++) free(tabla_codigos[i]);
         return 0;
     }
 
@@ -130,8 +160,6 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
     if (!dir) {
         printf("Error al reabrir directorio: %s\n", directorio_entrada);
         fclose(archivo_comprimido);
-        liberar_arbol(raiz);
-        for (int i = 0; i < TAM_MAX; i++) free(tabla_codigos[i]);
         return 0;
     }
 
@@ -147,8 +175,6 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
         printf("Error al escribir número de archivos\n");
         closedir(dir);
         fclose(archivo_comprimido);
-        liberar_arbol(raiz);
-        for (int i = 0; i < TAM_MAX; i++) free(tabla_codigos[i]);
         return 0;
     }
 
@@ -159,7 +185,7 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
             snprintf(ruta_completa, sizeof(ruta_completa), "%s/%s", directorio_entrada, entrada->d_name);
             printf("Comprimiendo: %s\n", entrada->d_name);
             
-            if (comprimir_archivo(ruta_completa, raiz, tabla_codigos, archivo_comprimido)) {
+            if (comprimir_archivo(ruta_completa, &tabla_codigos, archivo_comprimido)) {
                 archivos_comprimidos++;
             } else {
                 printf("Error al comprimir archivo: %s\n", entrada->d_name);
@@ -173,14 +199,6 @@ int comprimir_directorio(const char* directorio_entrada, const char* archivo_sal
     closedir(dir);
     fclose(archivo_comprimido);
 
-    // Primero liberar la tabla de códigos
-    for (int i = 0; i < TAM_MAX; i++) {
-        if (tabla_codigos[i]) free(tabla_codigos[i]);
-    }
-
-    // Luego liberar el árbol (que incluye todos los nodos)
-    liberar_arbol(raiz);
-
     return 1;
 }
 
@@ -229,21 +247,49 @@ int descomprimir_archivo_completo(const char* archivo_entrada, const char* direc
         }
     }
 
+    // Verificar marca y versión antes de interpretar el resto
+    char marca[HUF_MAGIC_LEN];
+    if (fread(marca, 1, HUF_MAGIC_LEN, archivo_comprimido) != HUF_MAGIC_LEN ||
+        memcmp(marca, HUF_MAGIC, HUF_MAGIC_LEN - 1) != 0) {
+        printf("Error: %s no es un .huf de esta versión (sin cabecera %s%c)\n", archivo_entrada, HUF_MAGIC, HUF_VERSION);
+        fclose(archivo_comprimido);
+        return 0;
+    }
+    if (marca[HUF_MAGIC_LEN - 1] != HUF_VERSION) {
+        printf("Error: versión %c de .huf no soportada en %s (se espera %c)\n", marca[HUF_MAGIC_LEN - 1],
+               archivo_entrada, HUF_VERSION);
+        fclose(archivo_comprimido);
+        return 0;
+    }
+
     // Deserializar el árbol de Huffman
     printf("Cargando árbol de Huffman...\n");
-    struct Nodo* raiz = deserializar_arbol(archivo_comprimido);
-    if (!raiz) {
+    struct ArenaNodos arena;
+    int raiz = deserializar_arbol(&arena, archivo_comprimido);
+    if (raiz < 0) {
         printf("Error al deserializar el árbol\n");
         fclose(archivo_comprimido);
         return 0;
     }
 
+    // Construir una sola vez la tabla de búsqueda para el árbol global
+    struct TablaCodigos codigos;
+    struct TablaDecodificacion* tabla = (struct TablaDecodificacion*)malloc(sizeof(struct TablaDecodificacion));
+    int hoja_unica = (arena.nodos[raiz].izquierda == ARENA_NULO);
+    if (!tabla || generar_tabla_codigos(&arena, raiz, &codigos) != 0 ||
+        (!hoja_unica && construir_tabla_decodificacion(&codigos, tabla) != 0)) {
+        printf("Error al construir la tabla de decodificación\n");
+        free(tabla);
+        fclose(archivo_comprimido);
+        return 0;
+    }
+
     // Leer número de archivos
     int numero_archivos;
     if (fread(&numero_archivos, sizeof(int), 1, archivo_comprimido) != 1) {
         printf("Error al leer número de archivos\n");
+        free(tabla);
         fclose(archivo_comprimido);
-        liberar_arbol(raiz);
         return 0;
     }
 
@@ -277,30 +323,38 @@ int descomprimir_archivo_completo(const char* archivo_entrada, const char* direc
             break;
         }
         
-        int longitud_comprimida;
-        if (fread(&longitud_comprimida, sizeof(int), 1, archivo_comprimido) != 1) {
+        uint64_t bits_comprimidos, bytes_comprimidos;
+        if (fread(&bits_comprimidos, sizeof(uint64_t), 1, archivo_comprimido) != 1 ||
+            fread(&bytes_comprimidos, sizeof(uint64_t), 1, archivo_comprimido) != 1) {
             printf("Error al leer longitud comprimida del archivo %d\n", i);
             break;
         }
         
-        // Leer contenido comprimido
-        char* texto_comprimido = (char*)malloc(longitud_comprimida + 1);
-        if (!texto_comprimido) {
+        // Leer contenido comprimido (bits empaquetados)
+        uint8_t* empaquetado = (uint8_t*)malloc(bytes_comprimidos ? bytes_comprimidos : 1);
+        if (!empaquetado) {
             printf("Error de memoria para archivo %d\n", i);
             break;
         }
         
-        if (fread(texto_comprimido, 1, longitud_comprimida, archivo_comprimido) != longitud_comprimida) {
+        if (fread(empaquetado, 1, bytes_comprimidos, archivo_comprimido) != bytes_comprimidos) {
             printf("Error al leer contenido comprimido del archivo %d\n", i);
-            free(texto_comprimido);
+            free(empaquetado);
             break;
         }
-        texto_comprimido[longitud_comprimida] = '\0';
-        
-        // Descomprimir contenido
+        // Descomprimir contenido directo desde los bits empaquetados
         printf("Descomprimiendo: %s (tamaño: %ld bytes)\n", nombre_archivo, tamaño_original);
-        char* texto_original = descomprimir_texto(raiz, texto_comprimido, tamaño_original);
-        free(texto_comprimido);
+        unsigned char* texto_original = (unsigned char*)malloc((size_t)tamaño_original + 1);
+        if (texto_original) {
+            if (hoja_unica) {
+                memset(texto_original, arena.nodos[raiz].caracter, (size_t)tamaño_original);
+            } else if (decodificar_bits(tabla, empaquetado, (size_t)bytes_comprimidos, bits_comprimidos,
+                                        texto_original, (size_t)tamaño_original) != 0) {
+                free(texto_original);
+                texto_original = NULL;
+            }
+        }
+        free(empaquetado);
         
         if (!texto_original) {
             printf("Error al descomprimir: %s\n", nombre_archivo);
@@ -342,7 +396,7 @@ int descomprimir_archivo_completo(const char* archivo_entrada, const char* direc
         free(texto_original);
     }
 
-    liberar_arbol(raiz);
+    free(tabla);
     fclose(archivo_comprimido);
     return 1;
 }
\ No newline at end of file